@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Path.h"
+#include "parser.h"
+
+// Measures arcs_to_curves against the converter it replaced, on random arcs
+// written into one reused path, then the parsing of the arc heavy document
+// given, whose path data is mostly `A` and `a` commands
+
+constexpr uint32_t BENCH_ARCS = 200000;
+constexpr int BENCH_ROUNDS = 7;
+
+// Control points of the two converters further apart than this, relative
+// to the radii, fail the run
+constexpr double BENCH_MAX_ERROR = 1e-9;
+
+struct Arc {
+  Point start;
+  Point end;
+  double rx;
+  double ry;
+  double angle;
+  int large_arc;
+  int sweep;
+};
+
+// Returns the angle that turns `u` onto `v`, from 0 to a full turn
+static double vector_angle(Point u, Point v) {
+  double ta = std::atan2(u[1], u[0]);
+  double tb = std::atan2(v[1], v[0]);
+  if (tb >= ta) return tb - ta;
+  return 2 * PI - (ta - tb);
+}
+
+// The converter before the rotation recurrence: the angles of the ends come
+// from atan2, each segment pays its own sines and cosines, and the curves
+// are returned in a list of their own that the path then copies
+static ArrayList<BezierCurve> trig_arc_to_curves(const Arc &arc) {
+  ArrayList<BezierCurve> curves;
+  if (arc.start[0] == arc.end[0] && arc.start[1] == arc.end[1]) return curves;
+
+  double rx = std::abs(arc.rx);
+  double ry = std::abs(arc.ry);
+  double sin_phi = std::sin(arc.angle * PI / 180);
+  double cos_phi = std::cos(arc.angle * PI / 180);
+
+  double x1_dash = cos_phi * (arc.start[0] - arc.end[0]) / 2 + sin_phi * (arc.start[1] - arc.end[1]) / 2;
+  double y1_dash = -sin_phi * (arc.start[0] - arc.end[0]) / 2 + cos_phi * (arc.start[1] - arc.end[1]) / 2;
+  double numerator = rx * rx * ry * ry - rx * rx * y1_dash * y1_dash - ry * ry * x1_dash * x1_dash;
+
+  double root = 0;
+  if (numerator < 0) {
+    double s = std::sqrt(1 - numerator / (rx * rx * ry * ry));
+    rx *= s;
+    ry *= s;
+  } else {
+    root = (arc.large_arc == arc.sweep ? -1.0 : 1.0)
+         * std::sqrt(numerator / (rx * rx * y1_dash * y1_dash + ry * ry * x1_dash * x1_dash));
+  }
+
+  double cx_dash = root * rx * y1_dash / ry;
+  double cy_dash = -root * ry * x1_dash / rx;
+  double cx = cos_phi * cx_dash - sin_phi * cy_dash + (arc.start[0] + arc.end[0]) / 2;
+  double cy = sin_phi * cx_dash + cos_phi * cy_dash + (arc.start[1] + arc.end[1]) / 2;
+
+  Point u = {(x1_dash - cx_dash) / rx, (y1_dash - cy_dash) / ry};
+  Point v = {(-x1_dash - cx_dash) / rx, (-y1_dash - cy_dash) / ry};
+  double theta1 = vector_angle(Point {1, 0}, u);
+  double dtheta = vector_angle(u, v);
+  if (arc.sweep == 0 && dtheta > 0) dtheta -= 2 * PI;
+  else if (arc.sweep == 1 && dtheta < 0) dtheta += 2 * PI;
+
+  int segments = std::max((int)std::ceil(std::abs(dtheta) / (PI / 2) - 1e-9), 1);
+  double delta = dtheta / segments;
+  double t = 8.0 / 3.0 * std::sin(delta / 4) * std::sin(delta / 4) / std::sin(delta / 2);
+
+  Point start = arc.start;
+  for (int i = 0; i < segments; ++i) {
+    double cos_theta1 = std::cos(theta1);
+    double sin_theta1 = std::sin(theta1);
+    double theta2 = theta1 + delta;
+    double cos_theta2 = std::cos(theta2);
+    double sin_theta2 = std::sin(theta2);
+
+    Point end = {
+      cos_phi * rx * cos_theta2 - sin_phi * ry * sin_theta2 + cx,
+      sin_phi * rx * cos_theta2 + cos_phi * ry * sin_theta2 + cy,
+    };
+    if (i == segments - 1) end = arc.end;
+
+    Point arm_start = {
+      t * (-cos_phi * rx * sin_theta1 - sin_phi * ry * cos_theta1),
+      t * (-sin_phi * rx * sin_theta1 + cos_phi * ry * cos_theta1),
+    };
+    Point arm_end = {
+      t * (cos_phi * rx * sin_theta2 + sin_phi * ry * cos_theta2),
+      t * (sin_phi * rx * sin_theta2 - cos_phi * ry * cos_theta2),
+    };
+    curves.push(BezierCurve {start, end, start + arm_start, end + arm_end});
+
+    theta1 = theta2;
+    start = end;
+  }
+  return curves;
+}
+
+// Returns the fastest of the rounds of `run`, in seconds
+template<typename Run>
+static double time_rounds(Run run) {
+  double best = INFINITY;
+  for (int round = 0; round < BENCH_ROUNDS; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fputs("usage: bench_arc <arc heavy svg file>\n", stderr);
+    return 2;
+  }
+
+  // Radii from well under to well over half the chord, so both the scaled
+  // up and the exact case are taken, and a third of the arcs unrotated
+  std::mt19937_64 random {4};
+  std::uniform_real_distribution<double> coordinate {-100, 100};
+  std::uniform_real_distribution<double> radius {0.5, 150};
+  std::uniform_real_distribution<double> angle {-180, 180};
+  std::vector<Arc> arcs(BENCH_ARCS);
+  for (Arc &arc : arcs) {
+    arc.start = Point {coordinate(random), coordinate(random)};
+    arc.end = Point {coordinate(random), coordinate(random)};
+    arc.rx = radius(random);
+    arc.ry = radius(random);
+    arc.angle = random() % 3 ? angle(random) : 0;
+    arc.large_arc = (int)(random() % 2);
+    arc.sweep = (int)(random() % 2);
+  }
+
+  PathData path;
+  double worst = 0;
+  for (const Arc &arc : arcs) {
+    path.clear();
+    path.move_to(arc.start);
+    arcs_to_curves(&path, arc.start, arc.end, arc.rx, arc.ry, arc.angle, arc.large_arc, arc.sweep);
+    ArrayList<BezierCurve> curves = trig_arc_to_curves(arc);
+    if (path.points.len() != curves.len() * 3 + 1) {
+      fputs("bench_arc: the converters split an arc differently\n", stderr);
+      return 1;
+    }
+
+    double scale = std::max(arc.rx, arc.ry);
+    for (uint32_t i = 0; i < curves.len(); ++i) {
+      Point expected[3] = {curves[i].control_start, curves[i].control_end, curves[i].end};
+      for (int k = 0; k < 3; ++k) {
+        Point error = expected[k] - path.points[1 + 3 * i + k];
+        worst = std::max(worst, std::hypot(error[0], error[1]) / scale);
+      }
+    }
+  }
+  if (!(worst <= BENCH_MAX_ERROR)) {
+    fprintf(stderr, "bench_arc: the converters differ by %g of the radius\n", worst);
+    return 1;
+  }
+
+  volatile uint64_t points = 0;
+  double trig_time = time_rounds([&] {
+    for (const Arc &arc : arcs) {
+      path.clear();
+      path.move_to(arc.start);
+      ArrayList<BezierCurve> curves = trig_arc_to_curves(arc);
+      for (const BezierCurve &curve : curves) path.cubic_to(curve.control_start, curve.control_end, curve.end);
+      points = points + path.points.len();
+    }
+  });
+  double rotation_time = time_rounds([&] {
+    for (const Arc &arc : arcs) {
+      path.clear();
+      path.move_to(arc.start);
+      arcs_to_curves(&path, arc.start, arc.end, arc.rx, arc.ry, arc.angle, arc.large_arc, arc.sweep);
+      points = points + path.points.len();
+    }
+  });
+
+  printf("%u random arcs, converters within %.1e of the radius\n", BENCH_ARCS, worst);
+  printf("%-15s %7.1f ns/arc\n", "trig arcs", trig_time / BENCH_ARCS * 1e9);
+  printf("%-15s %7.1f ns/arc\n", "arcs_to_curves", rotation_time / BENCH_ARCS * 1e9);
+
+  std::ifstream stream {argv[1]};
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  std::string text = buffer.str();
+  if (text.empty()) {
+    fprintf(stderr, "bench_arc: cannot read `%s`\n", argv[1]);
+    return 1;
+  }
+
+  size_t shapes = 0;
+  double parse_time = time_rounds([&] {
+    ParseResult result = parse_xml(std::string_view {text});
+    for (const BaseShape *shape = result.shapes; shape; shape = shape->next) ++shapes;
+  });
+  double megabytes = text.size() / 1e6;
+  printf("%s: %.2f MB, %zu shapes, parse %.2f ms, %.1f MB/s\n",
+    argv[1], megabytes, shapes / BENCH_ROUNDS, parse_time * 1e3, megabytes / parse_time);
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "InverseIndex.h"
+
+// Measures InverseIndex against the open addressing table it replaced, on
+// the keys of every table of the sources. Tables are read from the .cpp
+// files of the directory given, so new ones are measured as they are added.
+// Lookups go through InverseIndex<0>, which shares its builder and its probe
+// with the tables built at compile time
+
+// Lookups timed per round, and rounds of which the fastest counts
+constexpr uint32_t BENCH_LOOKUPS = 1 << 21;
+constexpr int BENCH_ROUNDS = 7;
+
+// The table before the perfect hashes: FNV-1a into a power of two of slots,
+// probed linearly with a full compare at each step
+class ProbeIndex {
+public:
+  ProbeIndex(const std::string_view *map, uint32_t count) : idx_map{map}, size{1}, keys{} {
+    while (this->size < count) this->size <<= 1;
+    this->keys = std::make_unique<int[]>(this->size);
+
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t h = this->slot(map[i]);
+      while (this->keys[h]) h = (h + 1) & (this->size - 1);
+      this->keys[h] = i + 1;
+    }
+  }
+
+  // Only for keys of the table, a full table never ends the probe of others
+  int operator[](std::string_view sv) const {
+    uint32_t h = this->slot(sv);
+    while (this->keys[h] && this->idx_map[this->keys[h] - 1] != sv) {
+      h = (h + 1) & (this->size - 1);
+    }
+    return this->keys[h] - 1;
+  }
+private:
+  uint32_t slot(std::string_view sv) const {
+    return (uint32_t)(((uint64_t)hash32(sv.data(), sv.size(), 0x811c9dc5) * this->size) >> 32);
+  }
+
+  const std::string_view *idx_map;
+  uint32_t size;
+  std::unique_ptr<int[]> keys;
+};
+
+struct Table {
+  std::string name;
+  std::deque<std::string> storage;
+  std::vector<std::string_view> keys;
+};
+
+// Skips the string literal starting at `i`, returns the index past it
+static size_t skip_literal(const std::string &text, size_t i, std::string *out) {
+  for (++i; i < text.size() && text[i] != '"'; ++i) {
+    if (text[i] == '\\' && i + 1 < text.size()) ++i;
+    if (out) out->push_back(text[i]);
+  }
+  return i + 1;
+}
+
+// Finds the string_view arrays of `text` that an InverseIndex is built from
+static void read_tables(const std::filesystem::path &file, std::deque<Table> *tables) {
+  std::ifstream stream {file};
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  std::string text = buffer.str();
+
+  constexpr std::string_view declaration = "std::string_view ";
+  size_t at = 0;
+  while ((at = text.find(declaration, at)) != std::string::npos) {
+    at += declaration.size();
+    size_t name_end = at;
+    while (name_end < text.size() && (isalnum(text[name_end]) || text[name_end] == '_')) ++name_end;
+    if (name_end == at || name_end == text.size() || text[name_end] != '[') continue;
+
+    std::string name = text.substr(at, name_end - at);
+    if (text.find("{&" + name + "}") == std::string::npos) continue;
+
+    size_t open = text.find('{', name_end);
+    if (open == std::string::npos) break;
+
+    Table table;
+    table.name = file.filename().string() + " " + name;
+    size_t i = open + 1;
+    while (i < text.size() && text[i] != '}') {
+      if (text[i] == '"') {
+        std::string key;
+        i = skip_literal(text, i, &key);
+        table.storage.push_back(std::move(key));
+        table.keys.push_back(table.storage.back());
+      } else {
+        ++i;
+      }
+    }
+    at = i;
+    if (!table.keys.empty()) tables->push_back(std::move(table));
+  }
+}
+
+// Returns the fastest round of lookups of `order` through `index`, in ns per
+// lookup
+template<typename Index>
+static double time_lookups(const Index &index, const std::vector<std::string_view> &order) {
+  double best = INFINITY;
+  volatile uint64_t sink = 0;
+  for (int round = 0; round < BENCH_ROUNDS; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < BENCH_LOOKUPS; ++i) {
+      sum += (uint32_t)index[order[i % order.size()]];
+    }
+    sink = sink + sum;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, ns / BENCH_LOOKUPS);
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fputs("usage: bench_inverse_index <source directory>\n", stderr);
+    return 2;
+  }
+
+  std::vector<std::filesystem::path> files;
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(argv[1], error)) {
+    if (entry.path().extension() == ".cpp") files.push_back(entry.path());
+  }
+  std::sort(files.begin(), files.end());
+
+  std::deque<Table> tables;
+  for (const std::filesystem::path &file : files) {
+    read_tables(file, &tables);
+  }
+  if (tables.empty()) {
+    fprintf(stderr, "bench_inverse_index: no tables in `%s`\n", argv[1]);
+    return 1;
+  }
+
+  printf("%-40s %6s %10s %10s\n", "table", "keys", "probe ns", "perfect ns");
+  std::mt19937 random {1};
+  for (const Table &table : tables) {
+    uint32_t count = (uint32_t)table.keys.size();
+    ProbeIndex probe {table.keys.data(), count};
+    InverseIndex<0> perfect {table.keys.data(), count};
+
+    // Hits only, in a shuffled order so the branches can't learn it
+    std::vector<std::string_view> order = table.keys;
+    while (order.size() < 4096) order.insert(order.end(), table.keys.begin(), table.keys.end());
+    std::shuffle(order.begin(), order.end(), random);
+
+    for (uint32_t i = 0; i < count; ++i) {
+      if (probe[table.keys[i]] != (int)i || perfect[table.keys[i]] != (int)i) {
+        fprintf(stderr, "bench_inverse_index: `%s` misses a key of %s\n", std::string(table.keys[i]).c_str(), table.name.c_str());
+        return 1;
+      }
+    }
+
+    double probe_ns = time_lookups(probe, order);
+    double perfect_ns = time_lookups(perfect, order);
+    printf("%-40s %6u %10.1f %10.1f\n", table.name.c_str(), count, probe_ns, perfect_ns);
+  }
+
+  return 0;
+}
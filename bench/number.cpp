@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Number.h"
+
+// Measures parse_number against strtod on the numbers of the path data and
+// point lists of every .svg file of the directory given. Commands and
+// separators are blanked out first, so both read the same numbers from the
+// same text and only the conversions are compared
+
+constexpr int BENCH_ROUNDS = 7;
+
+// Appends the values of the `d` and `points` attributes of `text` to `out`,
+// with everything but numbers turned into spaces
+static void gather_numbers(const std::string &text, std::string *out) {
+  for (std::string_view attribute : {" d=\"", " points=\""}) {
+    size_t at = 0;
+    while ((at = text.find(attribute, at)) != std::string::npos) {
+      at += attribute.size();
+      size_t end = text.find('"', at);
+      if (end == std::string::npos) break;
+
+      for (size_t i = at; i < end; ++i) {
+        char c = text[i];
+        bool number = (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E';
+        out->push_back(number ? c : ' ');
+      }
+      out->push_back(' ');
+      at = end;
+    }
+  }
+}
+
+// Returns the fastest of the rounds of `read`, in seconds
+template<typename Read>
+static double time_rounds(Read read) {
+  double best = INFINITY;
+  for (int round = 0; round < BENCH_ROUNDS; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    read();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fputs("usage: bench_number <directory of svg files>\n", stderr);
+    return 2;
+  }
+
+  std::vector<std::filesystem::path> files;
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(argv[1], error)) {
+    if (entry.path().extension() == ".svg") files.push_back(entry.path());
+  }
+  std::sort(files.begin(), files.end());
+
+  std::string all;
+  for (const std::filesystem::path &file : files) {
+    std::ifstream stream {file};
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    gather_numbers(buffer.str(), &all);
+  }
+
+  std::vector<double> parsed;
+  std::vector<double> expected;
+  double parse_time = time_rounds([&] {
+    parsed.clear();
+    std::string_view rest = all;
+    while (true) {
+      size_t start = rest.find_first_not_of(' ');
+      if (start == std::string_view::npos) break;
+      rest.remove_prefix(start);
+
+      double value;
+      size_t read = parse_number(rest, &value);
+      if (!read) read = 1;
+      else parsed.push_back(value);
+      rest.remove_prefix(read);
+    }
+  });
+
+  double strtod_time = time_rounds([&] {
+    expected.clear();
+    const char *p = all.c_str();
+    const char *end = p + all.size();
+    while (p != end) {
+      if (*p == ' ') {
+        ++p;
+        continue;
+      }
+
+      char *next;
+      double value = strtod(p, &next);
+      if (next == p) {
+        ++p;
+        continue;
+      }
+      expected.push_back(value);
+      p = next;
+    }
+  });
+
+  if (parsed.size() != expected.size() ||
+      memcmp(parsed.data(), expected.data(), parsed.size() * sizeof(double)) != 0) {
+    fputs("bench_number: parse_number and strtod read different numbers\n", stderr);
+    return 1;
+  }
+
+  double megabytes = all.size() / 1e6;
+  printf("%zu files, %.2f MB of numbers, %zu numbers\n", files.size(), megabytes, parsed.size());
+  printf("parse_number %8.1f MB/s %8.1f Mnumbers/s\n", megabytes / parse_time, parsed.size() / parse_time / 1e6);
+  printf("strtod       %8.1f MB/s %8.1f Mnumbers/s\n", megabytes / strtod_time, expected.size() / strtod_time / 1e6);
+  return 0;
+}
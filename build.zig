@@ -76,4 +76,138 @@ pub fn build(b: *std.Build) !void {
 
   const run_step = b.step("run", "Run the app");
   run_step.dependOn(&run_cmd.step);
+
+  // The headless renderer, for the host unless -Dtarget says otherwise. It
+  // takes every source but the Windows viewer and its GDI+ backend
+  const cli_target = b.standardTargetOptions(.{});
+
+  const cli_mod = b.createModule(.{
+    .target = cli_target,
+    .optimize = optimize,
+    .strip = b.release_mode != .off,
+  });
+
+  // The portable sources, shared with the benchmarks
+  var core_files: std.ArrayList([]const u8) = .empty;
+  defer core_files.deinit(b.allocator);
+
+  for (source_files.items) |file| {
+    const name = std.fs.path.basename(file);
+    if (std.mem.eql(u8, name, "main.cpp") or std.mem.startsWith(u8, name, "Gdiplus")) {
+      continue;
+    }
+    try core_files.append(b.allocator, file);
+  }
+
+  cli_mod.addIncludePath(b.path(src));
+  cli_mod.addCSourceFiles(.{
+    .files = core_files.items,
+    .flags = &.{ "-Werror", "-Wall", "-Wextra", "-std=c++20", "-pedantic" },
+  });
+  cli_mod.addCSourceFiles(.{
+    .files = &.{ "cli/main.cpp" },
+    .flags = &.{ "-Werror", "-Wall", "-Wextra", "-std=c++20", "-pedantic" },
+  });
+
+  const cli = b.addExecutable(.{
+    .name = "svgrender",
+    .root_module = cli_mod,
+  });
+  cli.linkLibCpp();
+
+  const install_cli = b.addInstallArtifact(cli, .{});
+  const cli_step = b.step("cli", "Build the headless renderer");
+  cli_step.dependOn(&install_cli.step);
+
+  const run_cli = b.addRunArtifact(cli);
+  run_cli.step.dependOn(&install_cli.step);
+
+  if (b.args) |args| {
+    run_cli.addArgs(args);
+  }
+
+  const render_step = b.step("render", "Render files with the headless renderer");
+  render_step.dependOn(&run_cli.step);
+
+  // Microbenchmarks for the host, always optimized. Each is run on the
+  // directory or the file of the tree it reads its inputs from
+  const Bench = struct {
+    name: []const u8,
+    source: []const u8,
+    input: []const u8,
+    input_is_file: bool = false,
+  };
+  const benches = [_]Bench{
+    .{ .name = "bench_inverse_index", .source = "bench/inverse_index.cpp", .input = src },
+    .{ .name = "bench_number", .source = "bench/number.cpp", .input = "examples" },
+    .{ .name = "bench_arc", .source = "bench/arc.cpp", .input = "examples/svg-19.svg", .input_is_file = true },
+  };
+
+  const bench_step = b.step("bench", "Run the microbenchmarks");
+  for (benches) |bench| {
+    const bench_mod = b.createModule(.{
+      .target = cli_target,
+      .optimize = .ReleaseFast,
+    });
+    bench_mod.addIncludePath(b.path(src));
+    bench_mod.addCSourceFiles(.{
+      .files = core_files.items,
+      .flags = &.{ "-Werror", "-Wall", "-Wextra", "-std=c++20", "-pedantic" },
+    });
+    bench_mod.addCSourceFiles(.{
+      .files = &.{ bench.source },
+      .flags = &.{ "-Werror", "-Wall", "-Wextra", "-std=c++20", "-pedantic" },
+    });
+
+    const bench_exe = b.addExecutable(.{
+      .name = bench.name,
+      .root_module = bench_mod,
+    });
+    bench_exe.linkLibCpp();
+
+    const run_bench = b.addRunArtifact(bench_exe);
+    if (bench.input_is_file) {
+      run_bench.addFileArg(b.path(bench.input));
+    } else {
+      run_bench.addDirectoryArg(b.path(bench.input));
+    }
+    bench_step.dependOn(&run_bench.step);
+  }
+
+  // Checks of what the viewer cannot show, for the host. Each exits with
+  // nonzero on a failure
+  const Check = struct {
+    name: []const u8,
+    source: []const u8,
+  };
+  const checks = [_]Check{
+    .{ .name = "check_push_styles", .source = "check/push_styles.cpp" },
+  };
+
+  const check_step = b.step("check", "Run the checks");
+  for (checks) |check| {
+    const check_mod = b.createModule(.{
+      .target = cli_target,
+      .optimize = optimize,
+    });
+    check_mod.addIncludePath(b.path(src));
+    check_mod.addCSourceFiles(.{
+      .files = core_files.items,
+      .flags = &.{ "-Werror", "-Wall", "-Wextra", "-std=c++20", "-pedantic" },
+    });
+    check_mod.addCSourceFiles(.{
+      .files = &.{ check.source },
+      .flags = &.{ "-Werror", "-Wall", "-Wextra", "-std=c++20", "-pedantic" },
+    });
+
+    const check_exe = b.addExecutable(.{
+      .name = check.name,
+      .root_module = check_mod,
+    });
+    check_exe.linkLibCpp();
+
+    const run_check = b.addRunArtifact(check_exe);
+    run_check.expectExitCode(0);
+    check_step.dependOn(&run_check.step);
+  }
 }
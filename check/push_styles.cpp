@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "parser.h"
+
+// Feeds a PushParser shapes whose computed styles refer to text of their own
+// tags, which the parser releases once each shape is reported. The pool must
+// still read the styles it interned from the earlier shapes, and hand out
+// views that outlive them. Run under a sanitizer to catch reads of released
+// memory, the checks below catch the ones that read wrong text
+
+// Padding for the first shape, larger than an arena block so its tag copy
+// goes in a block of its own that is freed with it
+constexpr size_t CHECK_PADDING = 256 * 1024;
+
+static int failures = 0;
+
+static void expect(bool condition, const char *what) {
+  if (condition) return;
+  fprintf(stderr, "check_push_styles: %s\n", what);
+  ++failures;
+}
+
+static std::string_view url_of(const Paint &paint) {
+  if (paint.type != PAINT_URL) return std::string_view {};
+  return std::string_view {paint.variants.url_paint.data, (size_t)paint.variants.url_paint.len};
+}
+
+int main() {
+  std::string document =
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"100\" height=\"100\">"
+    "<linearGradient id=\"g\"><stop offset=\"0\" stop-color=\"red\"/></linearGradient>"
+    "<rect data-padding=\"" + std::string(CHECK_PADDING, 'x') + "\" width=\"10\" height=\"10\" fill=\"url(#g)\" font-family=\"Serif\"/>"
+    "<rect width=\"20\" height=\"20\" fill=\"url(#g)\" font-family=\"Serif\"/>"
+    "<g fill=\"url(#h)\" font-family=\"Sans\"><rect width=\"30\" height=\"30\"/></g>"
+    "<rect width=\"40\" height=\"40\" fill=\"url(#g)\" font-family=\"Serif\"/>"
+    "</svg>";
+
+  uint32_t styles[4];
+  int shapes = 0;
+  PushCallbacks callbacks;
+  callbacks.on_shape = [&](const BaseShape *shape) {
+    if (shape->kind == SHAPE_KIND_RECT && shapes < 4) styles[shapes++] = shape->style;
+  };
+
+  // Fed in small chunks, as a stream would arrive
+  PushParser parser {callbacks};
+  for (size_t at = 0; at < document.size(); at += 4096) {
+    parser.feed(std::string_view {document}.substr(at, 4096));
+  }
+  parser.finish();
+
+  const StylePool &pool = *parser.styles();
+  expect(parser.done(), "the document did not end");
+  expect(shapes == 4, "not every rect was reported");
+  expect(styles[0] == styles[1] && styles[1] == styles[3], "equal styles were interned apart");
+  expect(styles[0] != styles[2], "different styles were interned together");
+  expect(url_of(pool[styles[0]].fill) == "#g", "the pooled fill lost its url");
+  expect(pool[styles[0]].font_family == "Serif", "the pooled font family lost its text");
+  expect(url_of(pool[styles[2]].fill) == "#h", "the inherited fill lost its url");
+  expect(pool[styles[2]].font_family == "Sans", "the inherited font family lost its text");
+
+  if (failures) return 1;
+  puts("check_push_styles: ok");
+  return 0;
+}
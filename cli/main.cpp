@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DisplayList.h"
+#include "ImageEncoder.h"
+#include "InverseIndex.h"
+#include "TileRenderer.h"
+#include "parser.h"
+
+// Renders SVG files into images without a window, for batch jobs. Each file
+// is mapped, parsed, compiled into a display list and drawn by the tile
+// renderer, several files at once. Text is not drawn, see `Rasterizer`
+
+enum ExitCode {
+  EXIT_CODE_OK = 0,
+  EXIT_CODE_FAILED_FILES,
+  EXIT_CODE_USAGE,
+  EXIT_CODE_COUNT,
+};
+
+// The largest side of an image, beyond it a file is taken as a mistake
+constexpr uint32_t RENDER_MAX_SIZE = 16384;
+
+// The bytes of pixels all jobs hold at once, a job waits for others to
+// finish before going over. Enough for one image of the largest size
+constexpr size_t RENDER_PIXEL_BUDGET = (size_t)RENDER_MAX_SIZE * RENDER_MAX_SIZE * 4;
+
+constexpr InverseIndex<IMAGE_FORMAT_COUNT> inv_image_format = {&image_format_name};
+
+constexpr const char *usage =
+  "usage: svgrender [options] <file or directory>...\n"
+  "Renders each file, and each .svg file of each directory, into an image.\n"
+  "\n"
+  "  -o <directory>  write the images there, next to their files otherwise\n"
+  "  -w <pixels>     fit the images into this width\n"
+  "  -h <pixels>     fit the images into this height\n"
+  "  -s <scale>      scale the images from the size of their documents, 1 by default\n"
+  "  -f png|ppm      the format of the images, png by default\n"
+  "  -j <count>      files rendered at once, 0 for every hardware thread (default)\n"
+  "  -t <count>      threads rendering each file, 1 by default\n"
+  "\n"
+  "Exits with 1 when a file could not be rendered and with 2 on bad arguments.\n";
+
+struct Options {
+  std::filesystem::path output_directory;
+  uint32_t width;
+  uint32_t height;
+  double scale;
+  ImageFormat format;
+  uint32_t jobs;
+  uint32_t threads;
+};
+
+// What became of a file, times are in milliseconds
+struct FileReport {
+  size_t bytes;
+  uint32_t width;
+  uint32_t height;
+  double parse_time;
+  double prepare_time;
+  double render_time;
+  double write_time;
+  const char *error;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Shares `RENDER_PIXEL_BUDGET` between the jobs. A job alone may take more,
+// an image as large as the budget still renders once the others are done
+class PixelBudget {
+public:
+  PixelBudget() : lock{}, released{}, used{0} {}
+
+  // Waits until `bytes` fit and takes them
+  void take(size_t bytes) {
+    std::unique_lock<std::mutex> guard {this->lock};
+    this->released.wait(guard, [&] { return this->used == 0 || this->used + bytes <= RENDER_PIXEL_BUDGET; });
+    this->used += bytes;
+  }
+
+  void give_back(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> guard {this->lock};
+      this->used -= bytes;
+    }
+    this->released.notify_all();
+  }
+private:
+  std::mutex lock;
+  std::condition_variable released;
+  size_t used;
+};
+
+// Holds bytes of a `PixelBudget` for as long as it lives
+class PixelLease {
+public:
+  PixelLease(PixelBudget *budget, size_t bytes) : budget{budget}, bytes{bytes} {
+    budget->take(bytes);
+  }
+  ~PixelLease() {
+    this->budget->give_back(this->bytes);
+  }
+
+  PixelLease(const PixelLease&) = delete;
+  PixelLease &operator=(const PixelLease&) = delete;
+private:
+  PixelBudget *budget;
+  size_t bytes;
+};
+
+static double elapsed_ms(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+static bool parse_count(const char *text, uint32_t *out) {
+  char *end;
+  unsigned long value = strtoul(text, &end, 10);
+  if (end == text || *end || text[0] == '-' || value > UINT32_MAX) return false;
+  *out = (uint32_t)value;
+  return true;
+}
+
+// Finds the part of the world a document shows and its pixels per world
+// unit. The viewBox is shown at the width and height of the root, or one
+// pixel per unit without them. A document with neither shows its items
+static bool frame_document(const ParseResult &svg, const DisplayList &list, AABB *view, double *unit) {
+  const SVGShapes::SVG *root = svg.root;
+  *unit = 1;
+
+  if (root->view_width > 0 && root->view_height > 0) {
+    *view = AABB {root->view_min, root->view_min + Point {root->view_width, root->view_height}};
+    if (root->width > 0 && root->height > 0) {
+      *unit = std::min(root->width / root->view_width, root->height / root->view_height);
+    }
+    return true;
+  }
+
+  if (root->width > 0 && root->height > 0) {
+    *view = AABB {Point {0, 0}, Point {root->width, root->height}};
+    return true;
+  }
+
+  *view = AABB {Point {INFINITY, INFINITY}, Point {-INFINITY, -INFINITY}};
+  for (const DisplayItem &item : list.items) {
+    view->min = Point {std::min(view->min[0], item.bounds.min[0]), std::min(view->min[1], item.bounds.min[1])};
+    view->max = Point {std::max(view->max[0], item.bounds.max[0]), std::max(view->max[1], item.bounds.max[1])};
+  }
+  return view->max[0] > view->min[0] && view->max[1] > view->min[1];
+}
+
+// Renders the file at `input` into `output`, the renderer is the worker's
+// and the pixels come out of `budget`
+static FileReport render_file(
+  const std::filesystem::path &input, const std::filesystem::path &output,
+  const Options &options, TileRenderer *renderer, PixelBudget *budget
+) {
+  FileReport report = {};
+
+  Clock::time_point start = Clock::now();
+  Optional<DocumentSource> source = DocumentSource::map_file(input.string().c_str());
+  if (!source.has_value) {
+    report.error = "cannot be opened";
+    return report;
+  }
+  report.bytes = source.data.view().size();
+  ParseResult svg = parse_xml(std::move(source.data));
+  report.parse_time = elapsed_ms(start);
+  if (!svg.root) {
+    report.error = "has no svg element";
+    return report;
+  }
+
+  start = Clock::now();
+  Scene scene = build_scene(&svg);
+  DisplayList list = compile_display_list(&scene);
+  report.prepare_time = elapsed_ms(start);
+
+  AABB view;
+  double unit;
+  if (!frame_document(svg, list, &view, &unit)) {
+    report.error = "has no size";
+    return report;
+  }
+
+  // Fitting into a box keeps the proportions, the tighter side wins
+  double view_width = view.max[0] - view.min[0];
+  double view_height = view.max[1] - view.min[1];
+  double scale = unit * options.scale;
+  if (options.width || options.height) {
+    scale = INFINITY;
+    if (options.width) scale = std::min(scale, options.width / view_width);
+    if (options.height) scale = std::min(scale, options.height / view_height);
+  }
+
+  double width = std::max(std::round(view_width * scale), 1.0);
+  double height = std::max(std::round(view_height * scale), 1.0);
+  if (!(width <= RENDER_MAX_SIZE && height <= RENDER_MAX_SIZE)) {
+    report.error = "is too large at this scale";
+    return report;
+  }
+  report.width = (uint32_t)width;
+  report.height = (uint32_t)height;
+
+  size_t stride = (size_t)report.width * 4;
+  PixelLease lease {budget, stride * report.height};
+
+  start = Clock::now();
+  std::unique_ptr<uint8_t[]> pixels {new uint8_t[stride * report.height]()};
+  RasterTarget target = {pixels.get(), 0, 0, report.width, report.height, stride};
+
+  Transform transform = Transform::identity();
+  transform.m[0][0] = scale;
+  transform.m[1][1] = scale;
+  transform.d = Point {-view.min[0] * scale, -view.min[1] * scale};
+  renderer->render(&list, transform, target);
+  report.render_time = elapsed_ms(start);
+
+  start = Clock::now();
+  ArrayList<uint8_t> encoded;
+  encode_image(target, options.format, &encoded);
+  FILE *file = fopen(output.string().c_str(), "wb");
+  bool written = file && fwrite(encoded.begin(), 1, encoded.len(), file) == encoded.len();
+  if (file && fclose(file) != 0) written = false;
+  report.write_time = elapsed_ms(start);
+  if (!written) report.error = "cannot be written";
+
+  return report;
+}
+
+int main(int argc, char **argv) {
+  Options options = {{}, 0, 0, 1, IMAGE_FORMAT_PNG, 0, 1};
+  std::vector<std::filesystem::path> inputs;
+
+  bool options_ended = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (options_ended || arg.size() < 2 || arg[0] != '-') {
+      std::error_code error;
+      if (std::filesystem::is_directory(arg, error)) {
+        // Directories are read in name order, so runs are repeatable
+        size_t first = inputs.size();
+        for (const auto &entry : std::filesystem::directory_iterator(arg, error)) {
+          if (entry.is_regular_file(error) && entry.path().extension() == ".svg") {
+            inputs.push_back(entry.path());
+          }
+        }
+        std::sort(inputs.begin() + first, inputs.end());
+      } else {
+        inputs.emplace_back(arg);
+      }
+      continue;
+    }
+
+    if (arg == "--") {
+      options_ended = true;
+      continue;
+    }
+    if (arg == "--help") {
+      fputs(usage, stdout);
+      return EXIT_CODE_OK;
+    }
+
+    // Every option takes a value
+    if (arg.size() != 2 || !strchr("owhsfjt", arg[1])) {
+      fprintf(stderr, "svgrender: unknown option `%s`\n\n%s", argv[i], usage);
+      return EXIT_CODE_USAGE;
+    }
+    if (i + 1 == argc) {
+      fprintf(stderr, "svgrender: `%s` needs a value\n\n%s", argv[i], usage);
+      return EXIT_CODE_USAGE;
+    }
+
+    const char *value = argv[i + 1];
+    bool valid = true;
+    switch (arg[1]) {
+      case 'o': {
+        options.output_directory = value;
+      } break;
+      case 'w': {
+        valid = parse_count(value, &options.width);
+      } break;
+      case 'h': {
+        valid = parse_count(value, &options.height);
+      } break;
+      case 's': {
+        char *end;
+        options.scale = strtod(value, &end);
+        valid = end != value && !*end && options.scale > 0 && std::isfinite(options.scale);
+      } break;
+      case 'f': {
+        int format = inv_image_format[value];
+        valid = format >= 0;
+        if (valid) options.format = (ImageFormat)format;
+      } break;
+      case 'j': {
+        valid = parse_count(value, &options.jobs);
+      } break;
+      case 't': {
+        valid = parse_count(value, &options.threads);
+      } break;
+    }
+
+    if (!valid) {
+      fprintf(stderr, "svgrender: bad value for `%s`\n\n%s", argv[i], usage);
+      return EXIT_CODE_USAGE;
+    }
+    ++i;
+  }
+
+  if (inputs.empty()) {
+    fprintf(stderr, "svgrender: no files to render\n\n%s", usage);
+    return EXIT_CODE_USAGE;
+  }
+
+  if (!options.output_directory.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(options.output_directory, error);
+    if (error) {
+      fprintf(stderr, "svgrender: cannot create `%s`\n", options.output_directory.string().c_str());
+      return EXIT_CODE_USAGE;
+    }
+  }
+
+  // Two inputs written to one image would race, both are refused up front
+  std::vector<std::filesystem::path> outputs;
+  for (const std::filesystem::path &input : inputs) {
+    std::filesystem::path output = options.output_directory.empty()
+      ? input
+      : options.output_directory / input.filename();
+    output.replace_extension(image_format_name[options.format]);
+    outputs.push_back(std::move(output));
+  }
+
+  std::vector<std::filesystem::path> keys;
+  for (const std::filesystem::path &output : outputs) {
+    std::error_code error;
+    std::filesystem::path key = std::filesystem::weakly_canonical(output, error);
+    keys.push_back(error ? output.lexically_normal() : key);
+  }
+  std::vector<size_t> order(inputs.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+  for (size_t i = 1; i < order.size(); ++i) {
+    if (keys[order[i - 1]] != keys[order[i]]) continue;
+    fprintf(
+      stderr, "svgrender: `%s` and `%s` would both be written to `%s`\n",
+      inputs[order[i - 1]].string().c_str(), inputs[order[i]].string().c_str(), outputs[order[i]].string().c_str()
+    );
+    return EXIT_CODE_USAGE;
+  }
+
+  uint32_t jobs = options.jobs ? options.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+  jobs = std::min(jobs, (uint32_t)inputs.size());
+
+  // Files are handed out one at a time, a worker done with a small one takes
+  // the next while the others are still busy with large ones
+  std::atomic<size_t> next {0};
+  std::atomic<size_t> failures {0};
+  std::atomic<size_t> total_bytes {0};
+  std::mutex print_lock;
+  PixelBudget budget;
+
+  auto work = [&](TileRenderer *renderer) {
+    size_t index;
+    while ((index = next.fetch_add(1, std::memory_order_relaxed)) < inputs.size()) {
+      const std::filesystem::path &input = inputs[index];
+
+      // A file too large for memory fails alone, the others go on
+      FileReport report;
+      try {
+        report = render_file(input, outputs[index], options, renderer, &budget);
+      } catch (const std::bad_alloc &) {
+        report = {};
+        report.error = "cannot be rendered";
+      }
+      total_bytes.fetch_add(report.bytes, std::memory_order_relaxed);
+
+      std::lock_guard<std::mutex> lock {print_lock};
+      if (report.error) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+        fprintf(stderr, "svgrender: `%s` %s\n", input.string().c_str(), report.error);
+        continue;
+      }
+      printf(
+        "%s: %zu bytes, %ux%u, parse %.2f ms, prepare %.2f ms, render %.2f ms, write %.2f ms\n",
+        input.string().c_str(), report.bytes, report.width, report.height,
+        report.parse_time, report.prepare_time, report.render_time, report.write_time
+      );
+    }
+  };
+
+  Clock::time_point start = Clock::now();
+  std::deque<TileRenderer> renderers;
+  for (uint32_t i = 0; i < jobs; ++i) {
+    renderers.emplace_back(options.threads, 0);
+  }
+
+  std::vector<std::thread> helpers;
+  for (uint32_t i = 1; i < jobs; ++i) {
+    helpers.emplace_back(work, &renderers[i]);
+  }
+  work(&renderers[0]);
+  for (std::thread &helper : helpers) {
+    helper.join();
+  }
+  double seconds = elapsed_ms(start) / 1000;
+
+  double megabytes = total_bytes.load() / 1e6;
+  printf(
+    "%zu files, %zu failed, %.2f MB in %.3f s, %.2f MB/s on %u jobs\n",
+    inputs.size(), failures.load(), megabytes, seconds, megabytes / seconds, jobs
+  );
+
+  return failures.load() ? EXIT_CODE_FAILED_FILES : EXIT_CODE_OK;
+}
@@ -0,0 +1,101 @@
+#include "Arena.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// Blocks start small so that tiny documents stay cheap, and double up to a
+// cap so that huge ones only need a handful of them
+constexpr size_t ARENA_FIRST_BLOCK = 64 * 1024;
+constexpr size_t ARENA_MAX_BLOCK = 16 * 1024 * 1024;
+
+struct ArenaBlock {
+  ArenaBlock *prev;
+  size_t size;
+};
+
+Arena::Arena() :
+  block{nullptr},
+  cursor{nullptr},
+  limit{nullptr} {}
+
+Arena::Arena(Arena &&other) :
+  block{other.block},
+  cursor{other.cursor},
+  limit{other.limit} {
+  other.block = nullptr;
+  other.cursor = nullptr;
+  other.limit = nullptr;
+}
+
+Arena &Arena::operator=(Arena &&other) {
+  if (this != &other) {
+    this->release_blocks(nullptr);
+    this->block = other.block;
+    this->cursor = other.cursor;
+    this->limit = other.limit;
+
+    other.block = nullptr;
+    other.cursor = nullptr;
+    other.limit = nullptr;
+  }
+  return *this;
+}
+
+Arena::~Arena() {
+  this->release_blocks(nullptr);
+}
+
+void Arena::release_blocks(ArenaBlock *until) {
+  while (this->block != until) {
+    ArenaBlock *prev = this->block->prev;
+    std::free(this->block);
+    this->block = prev;
+  }
+}
+
+void *Arena::alloc_slow(size_t size, size_t align) {
+  size_t block_size = ARENA_FIRST_BLOCK;
+  if (this->block) {
+    block_size = this->block->size * 2;
+    if (block_size > ARENA_MAX_BLOCK) block_size = ARENA_MAX_BLOCK;
+  }
+  size_t needed = sizeof(ArenaBlock) + size + align;
+  if (block_size < needed) block_size = needed;
+
+  ArenaBlock *next = (ArenaBlock*)std::malloc(block_size);
+  if (next == nullptr) throw std::bad_alloc {};
+  next->prev = this->block;
+  next->size = block_size;
+
+  this->block = next;
+  this->cursor = (char*)(next + 1);
+  this->limit = (char*)next + block_size;
+  return this->alloc(size, align);
+}
+
+void *Arena::grow(void *ptr, size_t old_size, size_t new_size, size_t align) {
+  if (ptr && (char*)ptr + old_size == this->cursor && (char*)ptr + new_size <= this->limit) {
+    this->cursor = (char*)ptr + new_size;
+    return ptr;
+  }
+
+  void *result = this->alloc(new_size, align);
+  if (ptr) memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+  return result;
+}
+
+ArenaMark Arena::mark() const {
+  return ArenaMark {this->block, this->cursor};
+}
+
+void Arena::rewind(ArenaMark mark) {
+  this->release_blocks(mark.block);
+  this->cursor = mark.cursor;
+  this->limit = mark.block ? (char*)mark.block + mark.block->size : nullptr;
+}
+
+size_t Arena::reserved() const {
+  size_t total = 0;
+  for (ArenaBlock *it = this->block; it; it = it->prev) total += it->size;
+  return total;
+}
@@ -0,0 +1,75 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+struct ArenaBlock;
+
+// A position in an arena, everything allocated after it can be released at
+// once with `Arena::rewind`
+struct ArenaMark {
+  ArenaBlock *block;
+  char *cursor;
+};
+
+// A bump allocator that releases all of its memory at once. Allocations are
+// carved out of large blocks, so freeing an arena costs one release per
+// block regardless of how many objects it holds. Destructors of objects made
+// in an arena are never run, they must not own memory outside of it
+class Arena {
+public:
+  Arena();
+  Arena(Arena &&other);
+  Arena &operator=(Arena &&other);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena &operator=(const Arena&) = delete;
+
+  // Returns `size` bytes aligned to `align`, which must be a power of two
+  void *alloc(size_t size, size_t align) {
+    uintptr_t start = ((uintptr_t)this->cursor + (align - 1)) & ~(uintptr_t)(align - 1);
+    if (this->cursor == nullptr || start + size > (uintptr_t)this->limit) {
+      return this->alloc_slow(size, align);
+    }
+    this->cursor = (char*)(start + size);
+    return (void*)start;
+  }
+
+  // Resizes an allocation of `old_size` bytes, in place when it is the most
+  // recent one, otherwise by copying it to a new allocation
+  void *grow(void *ptr, size_t old_size, size_t new_size, size_t align);
+
+  // Returns uninitialized storage for `count` values of `T`
+  template<typename T>
+  T *alloc_array(size_t count) {
+    return (T*)this->alloc(count * sizeof(T), alignof(T));
+  }
+
+  // Constructs a `T` in the arena
+  template<typename T, typename... Args>
+  T *make(Args&&... args) {
+    return new (this->alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Returns the current position, for releasing in stack order
+  ArenaMark mark() const;
+
+  // Releases everything allocated since `mark` was taken
+  void rewind(ArenaMark mark);
+
+  // Returns the number of bytes reserved from the system
+  size_t reserved() const;
+private:
+  void *alloc_slow(size_t size, size_t align);
+  void release_blocks(ArenaBlock *until);
+
+  ArenaBlock *block;
+  char *cursor;
+  char *limit;
+};
+
+#endif
@@ -8,23 +8,55 @@
 #include <cstring>
 
 #include "utils.h"
+#include "Arena.h"
 
 // A contiguous growable array type that support efficiently inserting and
 // concatenating to the end
 template<typename T>
 class ArrayList {
 public:
+  ArrayList() = default;
+
+  // Creates an empty list whose elements are allocated from `arena`, which
+  // must outlive it
+  explicit ArrayList(Arena *arena) : arena{arena} {}
+
+  ArrayList(ArrayList &&other) :
+    data{other.data},
+    size{other.size},
+    capacity{other.capacity},
+    arena{other.arena} {
+    other.data = nullptr;
+    other.size = 0;
+    other.capacity = 0;
+  }
+
+  ArrayList &operator=(ArrayList &&other) {
+    if (this != &other) {
+      this->release();
+      this->data = other.data;
+      this->size = other.size;
+      this->capacity = other.capacity;
+      this->arena = other.arena;
+
+      other.data = nullptr;
+      other.size = 0;
+      other.capacity = 0;
+    }
+    return *this;
+  }
+
+  ~ArrayList() {
+    this->release();
+  }
+
+  ArrayList(const ArrayList&) = delete;
+  ArrayList &operator=(const ArrayList&) = delete;
+
   // Adds an element to the end of the list
   void push(T value) {
     if (this->size == this->capacity) {
-      if (this->capacity != 0) {
-        this->capacity <<= 1;
-      } else {
-        this->capacity = 1;
-      }
-      std::unique_ptr<T[]> next_data = std::make_unique<T[]>(this->capacity);
-      memcpy(next_data.get(), this->data.get(), this->size * sizeof(T));
-      this->data.swap(next_data);
+      this->reallocate(this->capacity != 0 ? this->capacity << 1 : 1);
     }
     this->data[this->size++] = value;
   }
@@ -38,10 +70,7 @@ public:
   // Reserves capacity for at least `additional` more elements to be inserted
   void reserve(uint32_t additional) {
     if (additional > this->capacity) {
-      this->capacity = (uint32_t)1 << (32 - std::countl_zero(additional - 1));
-      std::unique_ptr<T[]> next_data = std::make_unique<T[]>(this->capacity);
-      memcpy(next_data.get(), this->data.get(), this->size * sizeof(T));
-      this->data.swap(next_data);
+      this->reallocate((uint32_t)1 << (32 - std::countl_zero(additional - 1)));
     }
   }
 
@@ -53,9 +82,10 @@ public:
 
   // Appends all `size` elements from `data` to the list
   void extend(const T *data, uint32_t size) {
+    if (size == 0) return;
     uint32_t next_size = this->size + size;
     this->reserve(next_size);
-    memcpy(this->data.get() + this->size, data, size * sizeof(T));
+    memcpy(this->data + this->size, data, size * sizeof(T));
     this->size = next_size;
   }
 
@@ -66,13 +96,15 @@ public:
     return this->extend(it, std::cend(x) - it);
   }
 
-  // Returns a new list with elements copied from the original list
+  // Returns a new list with elements copied from the original list. The copy
+  // is always heap allocated, even if the original lives in an arena
   ArrayList clone() const {
     ArrayList result;
-    result.data = std::make_unique<T[]>(this->capacity);
-    memcpy(result.data.get(), this->data.get(), this->size * sizeof(T));
-    result.size = this->size;
-    result.capacity = this->capacity;
+    if (this->size) {
+      result.reserve(this->size);
+      memcpy(result.data, this->data, this->size * sizeof(T));
+      result.size = this->size;
+    }
     return result;
   }
 
@@ -82,18 +114,39 @@ public:
   T &operator[](uint32_t idx) { return this->data[idx]; }
   const T &operator[](uint32_t idx) const { return this->data[idx]; }
 
-  T *begin() { return this->data.get(); }
-  T *end() { return this->data.get() + this->size; }
-  const T *begin() const { return this->data.get(); }
-  const T *end() const { return this->data.get() + this->size; }
+  T *begin() { return this->data; }
+  T *end() { return this->data + this->size; }
+  const T *begin() const { return this->data; }
+  const T *end() const { return this->data + this->size; }
 
 private:
   static_assert(std::is_trivially_copyable<T>::value,
                 "zds::ArrayList only supports trivially copiable items");
 
-  std::unique_ptr<T[]> data = nullptr;
+  void reallocate(uint32_t next_capacity) {
+    if (this->arena) {
+      this->data = (T*)this->arena->grow(
+        this->data, this->capacity * sizeof(T), next_capacity * sizeof(T), alignof(T)
+      );
+    } else {
+      T *next_data = new T[next_capacity]();
+      if (this->size) memcpy(next_data, this->data, this->size * sizeof(T));
+      delete[] this->data;
+      this->data = next_data;
+    }
+    this->capacity = next_capacity;
+  }
+
+  // Arena storage is released with the arena itself
+  void release() {
+    if (this->arena == nullptr) delete[] this->data;
+    this->data = nullptr;
+  }
+
+  T *data = nullptr;
   uint32_t size = 0;
   uint32_t capacity = 0;
+  Arena *arena = nullptr;
 };
 
 #endif
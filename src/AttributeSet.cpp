@@ -0,0 +1,58 @@
+#include "AttributeSet.h"
+#include "InverseIndex.h"
+
+constexpr std::string_view element_attr_name[ELEMENT_ATTR_COUNT] = {
+  "visibility",
+  "fill",
+  "stroke",
+  "font-size",
+  "opacity",
+  "fill-opacity",
+  "stroke-opacity",
+  "stroke-width",
+  "stroke-dashoffset",
+  "stroke-dasharray",
+  "stroke-linejoin",
+  "stroke-linecap",
+  "stroke-miterlimit",
+  "fill-rule",
+  "font-style",
+  "font-weight",
+  "font-family",
+
+  "class",
+  "transform",
+  "style",
+  "xml:space",
+
+  "x",
+  "y",
+  "width",
+  "height",
+  "rx",
+  "ry",
+  "cx",
+  "cy",
+  "r",
+  "x1",
+  "y1",
+  "x2",
+  "y2",
+  "d",
+  "points",
+  "dx",
+  "dy",
+  "text-anchor",
+  "viewBox",
+  "preserveAspectRatio",
+};
+
+constexpr InverseIndex<ELEMENT_ATTR_COUNT> inv_element_attribute {&element_attr_name};
+
+void AttributeSet::add(std::string_view key, std::string_view value) {
+  int attr = inv_element_attribute[key];
+  if (attr == -1) return;
+
+  this->present |= 1ull << attr;
+  this->values[attr] = value;
+}
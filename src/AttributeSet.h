@@ -0,0 +1,87 @@
+#ifndef ATTRIBUTE_SET_H
+#define ATTRIBUTE_SET_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "common.h"
+
+// Every attribute read by a shape. The presentation attributes come first,
+// in the order of the style properties they set
+enum ElementAttr {
+  ELEMENT_ATTR_VISIBILITY = 0,
+  ELEMENT_ATTR_FILL,
+  ELEMENT_ATTR_STROKE,
+  ELEMENT_ATTR_FONT_SIZE,
+  ELEMENT_ATTR_OPACITY,
+  ELEMENT_ATTR_FILL_OPACITY,
+  ELEMENT_ATTR_STROKE_OPACITY,
+  ELEMENT_ATTR_STROKE_WIDTH,
+  ELEMENT_ATTR_STROKE_DASH_OFFSET,
+  ELEMENT_ATTR_STROKE_DASH_ARRAY,
+  ELEMENT_ATTR_STROKE_LINE_JOIN,
+  ELEMENT_ATTR_STROKE_LINE_CAP,
+  ELEMENT_ATTR_MITER_LIMIT,
+  ELEMENT_ATTR_FILL_RULE,
+  ELEMENT_ATTR_FONT_STYLE,
+  ELEMENT_ATTR_FONT_WEIGHT,
+  ELEMENT_ATTR_FONT_FAMILY,
+
+  ELEMENT_ATTR_CLASS,
+  ELEMENT_ATTR_TRANSFORM,
+  ELEMENT_ATTR_STYLE,
+  ELEMENT_ATTR_XML_SPACE,
+
+  ELEMENT_ATTR_X,
+  ELEMENT_ATTR_Y,
+  ELEMENT_ATTR_WIDTH,
+  ELEMENT_ATTR_HEIGHT,
+  ELEMENT_ATTR_RX,
+  ELEMENT_ATTR_RY,
+  ELEMENT_ATTR_CX,
+  ELEMENT_ATTR_CY,
+  ELEMENT_ATTR_R,
+  ELEMENT_ATTR_X1,
+  ELEMENT_ATTR_Y1,
+  ELEMENT_ATTR_X2,
+  ELEMENT_ATTR_Y2,
+  ELEMENT_ATTR_D,
+  ELEMENT_ATTR_POINTS,
+  ELEMENT_ATTR_DX,
+  ELEMENT_ATTR_DY,
+  ELEMENT_ATTR_TEXT_ANCHOR,
+  ELEMENT_ATTR_VIEWBOX,
+  ELEMENT_ATTR_PRESERVE_ASPECT_RATIO,
+  ELEMENT_ATTR_COUNT,
+};
+
+static_assert(ELEMENT_ATTR_COUNT <= 64, "AttributeSet keeps one presence bit per attribute");
+
+constexpr uint64_t ELEMENT_ATTR_PRESENTATION = (1ull << (ELEMENT_ATTR_FONT_FAMILY + 1)) - 1;
+
+// The attributes of one element, classified once when the tag is read. Each
+// known attribute has a slot and a presence bit, the slot is only meaningful
+// while the bit is set. Unknown attributes are dropped, a repeated one keeps
+// its last value
+class AttributeSet {
+public:
+  // One bit per `ElementAttr`
+  uint64_t present;
+
+  AttributeSet() : present{0} {}
+
+  // Forgets every attribute, the slots are reused for the next element
+  void clear() { this->present = 0; }
+
+  // Classifies one attribute of the element
+  void add(std::string_view key, std::string_view value);
+
+  bool has(ElementAttr attr) const { return (this->present >> attr) & 1; }
+
+  // Returns the value of `attr`, which must be present
+  std::string_view operator[](ElementAttr attr) const { return this->values[attr]; }
+private:
+  std::string_view values[ELEMENT_ATTR_COUNT];
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+static AABB empty_box() {
+  AABB box;
+  box.min[0] = std::numeric_limits<double>::max();
+  box.min[1] = std::numeric_limits<double>::max();
+  box.max[0] = std::numeric_limits<double>::lowest();
+  box.max[1] = std::numeric_limits<double>::lowest();
+  return box;
+}
+
+// Grows `box` to hold `other`
+static void add_box(AABB *box, const AABB &other) {
+  for (int j = 0; j < 2; ++j) {
+    box->min[j] = std::min(box->min[j], other.min[j]);
+    box->max[j] = std::max(box->max[j], other.max[j]);
+  }
+}
+
+// The half perimeter, which stands in for the surface area in 2D
+static double box_area(const AABB &box) {
+  double width = box.max[0] - box.min[0];
+  double height = box.max[1] - box.min[1];
+  if (!(width >= 0 && height >= 0)) return 0;
+  return width + height;
+}
+
+static bool boxes_touch(const AABB &a, const AABB &b) {
+  return a.min[0] <= b.max[0] && b.min[0] <= a.max[0]
+      && a.min[1] <= b.max[1] && b.min[1] <= a.max[1];
+}
+
+struct BVHBin {
+  AABB bounds;
+  uint32_t count;
+};
+
+// An item while the tree is built. Splitting moves these around rather than
+// indices into the boxes, so every pass over a node reads memory in order
+struct BVHRef {
+  AABB bounds;
+  Point centroid;
+  uint32_t item;
+};
+
+// A node whose items are still to be split
+struct BVHTask {
+  uint32_t node;
+  uint32_t begin;
+  uint32_t end;
+};
+
+BVH::BVH() :
+  item_count{0} {}
+
+void BVH::build(const AABB *bounds, uint32_t count) {
+  this->clear();
+  this->item_count = count;
+
+  ArrayList<BVHRef> refs;
+  refs.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    const AABB &box = bounds[i];
+    if (box.min[0] <= box.max[0] && box.min[1] <= box.max[1]) {
+      refs.push(BVHRef {box, (box.min + box.max) / 2, i});
+    }
+  }
+  count = refs.len();
+  if (count == 0) return;
+
+  this->nodes.push(BVHNode {empty_box(), 0, 0, 0});
+  ArrayList<BVHTask> tasks;
+  tasks.push(BVHTask {0, 0, count});
+
+  while (tasks.len()) {
+    BVHTask task = *tasks.pop();
+    BVHRef *first = refs.begin() + task.begin;
+    BVHRef *last = refs.begin() + task.end;
+    uint32_t ref_count = task.end - task.begin;
+
+    AABB node_bounds = empty_box();
+    AABB centroid_bounds = {first->centroid, first->centroid};
+    for (BVHRef *ref = first; ref != last; ++ref) {
+      add_box(&node_bounds, ref->bounds);
+      add_box(&centroid_bounds, AABB {ref->centroid, ref->centroid});
+    }
+
+    this->nodes[task.node] = BVHNode {node_bounds, task.begin, ref_count, 0};
+    if (ref_count <= BVH_LEAF_SIZE) continue;
+
+    Point extent = centroid_bounds.max - centroid_bounds.min;
+    int axis = extent[1] > extent[0] ? 1 : 0;
+    BVHRef *middle = first;
+
+    if (extent[axis] > 0) {
+      BVHBin bins[BVH_BINS];
+      for (BVHBin &bin : bins) {
+        bin = BVHBin {empty_box(), 0};
+      }
+
+      double origin = centroid_bounds.min[axis];
+      double bin_scale = BVH_BINS / extent[axis];
+      auto bin_of = [&](const BVHRef &ref) {
+        return std::min((uint32_t)((ref.centroid[axis] - origin) * bin_scale), BVH_BINS - 1);
+      };
+
+      for (BVHRef *ref = first; ref != last; ++ref) {
+        BVHBin *bin = &bins[bin_of(*ref)];
+        add_box(&bin->bounds, ref->bounds);
+        bin->count += 1;
+      }
+
+      // Costs of every split, the right side summed from the end first
+      double right_cost[BVH_BINS];
+      AABB right = empty_box();
+      uint32_t right_count = 0;
+      for (uint32_t i = BVH_BINS - 1; i > 0; --i) {
+        add_box(&right, bins[i].bounds);
+        right_count += bins[i].count;
+        right_cost[i] = box_area(right) * right_count;
+      }
+
+      uint32_t best_split = 0;
+      double best_cost = std::numeric_limits<double>::infinity();
+      AABB left = empty_box();
+      uint32_t left_count = 0;
+      for (uint32_t i = 1; i < BVH_BINS; ++i) {
+        add_box(&left, bins[i - 1].bounds);
+        left_count += bins[i - 1].count;
+        double cost = box_area(left) * left_count + right_cost[i];
+        if (left_count && left_count < ref_count && cost < best_cost) {
+          best_cost = cost;
+          best_split = i;
+        }
+      }
+
+      if (best_split) {
+        middle = std::partition(first, last, [&](const BVHRef &ref) {
+          return bin_of(ref) < best_split;
+        });
+      }
+    }
+
+    // Every centroid in the same place or the same bin, halving keeps the
+    // tree shallow all the same
+    if (middle == first || middle == last) {
+      middle = first + ref_count / 2;
+      std::nth_element(first, middle, last, [&](const BVHRef &a, const BVHRef &b) {
+        return a.centroid[axis] < b.centroid[axis];
+      });
+    }
+
+    uint32_t children = this->nodes.len();
+    uint32_t split = task.begin + (uint32_t)(middle - first);
+    this->nodes[task.node].child = children;
+    this->nodes.push(BVHNode {empty_box(), 0, 0, 0});
+    this->nodes.push(BVHNode {empty_box(), 0, 0, 0});
+    tasks.push(BVHTask {children, task.begin, split});
+    tasks.push(BVHTask {children + 1, split, task.end});
+  }
+
+  this->items.resize(count);
+  this->boxes.resize(count);
+  for (uint32_t k = 0; k < count; ++k) {
+    this->items[k] = refs[k].item;
+    this->boxes[k] = refs[k].bounds;
+  }
+}
+
+void BVH::refit(const AABB *bounds) {
+  // Children always come after their parent, so walking backwards visits
+  // them first
+  for (uint32_t i = this->nodes.len(); i-- > 0;) {
+    BVHNode *node = &this->nodes[i];
+    AABB node_bounds = empty_box();
+    if (node->child == 0) {
+      for (uint32_t k = node->first; k < node->first + node->count; ++k) {
+        this->boxes[k] = bounds[this->items[k]];
+        add_box(&node_bounds, this->boxes[k]);
+      }
+    } else {
+      add_box(&node_bounds, this->nodes[node->child].bounds);
+      add_box(&node_bounds, this->nodes[node->child + 1].bounds);
+    }
+    node->bounds = node_bounds;
+  }
+}
+
+// Returns whether `inner` lies entirely in `outer`
+static bool box_contains(const AABB &outer, const AABB &inner) {
+  return outer.min[0] <= inner.min[0] && inner.max[0] <= outer.max[0]
+      && outer.min[1] <= inner.min[1] && inner.max[1] <= outer.max[1];
+}
+
+void BVH::query(const AABB &area, ArrayList<uint32_t> *out) const {
+  if (this->nodes.len() == 0) return;
+
+  uint32_t start = out->len();
+  ArrayList<uint32_t> stack;
+  stack.push(0);
+  while (stack.len()) {
+    const BVHNode &node = this->nodes[*stack.pop()];
+    if (!boxes_touch(node.bounds, area)) continue;
+
+    // Every item of a node inside the area touches it
+    bool inside = box_contains(area, node.bounds);
+    if (node.child && !inside) {
+      stack.push(node.child + 1);
+      stack.push(node.child);
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+      if (inside || boxes_touch(this->boxes[k], area)) out->push(this->items[k]);
+    }
+  }
+
+  // Few items are sorted, many are marked in a mask that is read back in
+  // order, which costs a word per 64 items however many were found
+  uint32_t found = out->len() - start;
+  uint32_t words = (this->item_count + 63) / 64;
+  if (found < 2 || (uint64_t)found * (uint32_t)std::bit_width(found) < words) {
+    std::sort(out->begin() + start, out->end());
+    return;
+  }
+
+  ArrayList<uint64_t> mask;
+  mask.resize(words);
+  std::fill(mask.begin(), mask.end(), 0);
+  for (uint32_t k = start; k < out->len(); ++k) {
+    uint32_t item = (*out)[k];
+    mask[item / 64] |= (uint64_t)1 << (item % 64);
+  }
+
+  out->resize(start);
+  for (uint32_t word = 0; word < words; ++word) {
+    for (uint64_t bits = mask[word]; bits; bits &= bits - 1) {
+      out->push(word * 64 + (uint32_t)std::countr_zero(bits));
+    }
+  }
+}
+
+void BVH::clear() {
+  this->nodes.resize(0);
+  this->items.resize(0);
+  this->boxes.resize(0);
+  this->item_count = 0;
+}
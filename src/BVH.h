@@ -0,0 +1,57 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstdint>
+
+#include "ArrayList.h"
+#include "Bounds.h"
+
+// Items stop being split once a node holds this many
+constexpr uint32_t BVH_LEAF_SIZE = 4;
+
+// How many buckets the centroids are sorted into when looking for a split
+constexpr uint32_t BVH_BINS = 16;
+
+// One box of the tree, over the items `items[first .. first + count)` whose
+// boxes are in `boxes` at the same indices. Inner nodes have their children
+// at `child` and `child + 1`, leaves have a `child` of 0, which is the root
+struct BVHNode {
+  AABB bounds;
+  uint32_t first;
+  uint32_t count;
+  uint32_t child;
+};
+
+// A bounding volume hierarchy over a list of boxes, which answers which of
+// them touch a rectangle in time that grows with the answer rather than with
+// the list. Splits are chosen by the surface area heuristic over binned
+// centroids
+class BVH {
+public:
+  BVH();
+
+  // Rebuilds the tree over the `count` boxes of `bounds`, item `i` being
+  // `bounds[i]`. Empty boxes, with their min above their max, are left out
+  // and never found
+  void build(const AABB *bounds, uint32_t count);
+
+  // Updates the boxes of the nodes after the items moved, `bounds` having the
+  // same items as the last `build`. The tree keeps its shape, so queries stay
+  // correct but get slower the further the items move. Items left out by
+  // `build` stay out
+  void refit(const AABB *bounds);
+
+  // Appends the items whose box touches `area` to `out`, in increasing order
+  void query(const AABB &area, ArrayList<uint32_t> *out) const;
+
+  void clear();
+private:
+  ArrayList<BVHNode> nodes;
+  ArrayList<uint32_t> items;
+  ArrayList<AABB> boxes;
+
+  // The `count` of the last `build`, empty items included
+  uint32_t item_count;
+};
+
+#endif
@@ -1,100 +1,16 @@
 #include "BaseShape.h"
 #include "InverseIndex.h"
+#include <bit>
 #include <cmath>
 #include <cctype>
 #include "common.h"
 #include "Transform.h"
+#include "Number.h"
 
 
-struct QuadraticRoots {
-  double roots[2];
-  int roots_len;
-};
-
-static QuadraticRoots find_solution_quadratic(double p0, double p1, double p2, double p3) {
-  QuadraticRoots result;
-
-  double a = 9 * (p1 - p2) + 3 * (p3 - p0);
-  double b = 6 * (p0 + p2 - 2 * p1);
-  double c = 3 * (p1 - p0);
-        
-  double delta= b * b - 4 * a * c;
-
-  if (a == 0) {
-    if (b != 0) {
-      result.roots[0] = -c / b;
-      result.roots_len = 1; 
-    } else {
-      if (c == 0) {
-        result.roots_len = -1;
-      } else {
-        result.roots_len = 0;
-      }
-    }
-  } else {
-    if (delta < 0) {
-      result.roots_len = 0;
-    } else if (delta == 0){
-      result.roots[0] = (-b + std::sqrt(delta)) / (2 * a);
-      result.roots_len = 1; 
-    } else {
-      result.roots[0] = (-b + std::sqrt(delta)) / (2 * a);
-      result.roots[1] = (-b - std::sqrt(delta)) / (2 * a);
-      result.roots_len = 2; 
-    }
-  }
-
-  return result;
-}
-
 AABB BaseShape::get_bounding() const {
-  ArrayList<BezierCurve> beziers = this->get_beziers();
-
-  AABB size;
-  size.min[0] = std::numeric_limits<double>::max();
-  size.min[1] = std::numeric_limits<double>::max();
-  size.max[0] = std::numeric_limits<double>::min();
-  size.max[1] = std::numeric_limits<double>::min();
-          
-  for (size_t i = 0; i < beziers.len(); i++) {
-    for (int j = 0; j < 2; j++) {
-
-      size.min[j] = std::min(size.min[j], std::min(beziers[i].start[j], beziers[i].end[j]));
-      size.max[j] = std::max(size.max[j], std::max(beziers[i].start[j], beziers[i].end[j]));
-
-      double p0 = beziers[i].start[j];
-      double p1 = beziers[i].control_start[j];
-      double p2 = beziers[i].control_end[j];
-      double p3 = beziers[i].end[j];
-
-      QuadraticRoots result = find_solution_quadratic(p0, p1, p2, p3);
-      if (result.roots_len == -1) { 
-        double t = 0.5;
-        if (t <= 1 && t >= -1) {
-          double ans = p0 + 3 * (p1 - p0) * t + 3 * (p0 + p2 - 2 * p1) * t * t
-                      + (3 * (p1 - p2) + p3 - p0) * t * t * t;
-
-          size.min[j] = std::min(size.min[j], ans);
-          size.max[j] = std::max(size.max[j], ans);
-        }
-      }
-
-      for (int k = 0; k < result.roots_len; k++) {
-        double t = result.roots[k];
-        if (t <= 1 && t >= -1) {
-          double ans = p0 + 3 * (p1 - p0) * t + 3 * (p0 + p2 - 2 * p1) * t * t
-                      + (3 * (p1 - p2) + p3 - p0) * t * t * t;
-
-          size.min[j] = std::min(size.min[j], ans);
-          size.max[j] = std::max(size.max[j], ans);
-        }
-      }
-    }
-  }
-
-  return size;
+  return path_bounds(this->path());
 }
-    
 
 enum FontWeight {
   FONTWEIGHT_NORMAL = 0,
@@ -191,242 +107,274 @@ constexpr std::string_view style_name[STYLE_COUNT] = {
 constexpr InverseIndex<STYLE_COUNT> inv_style = {&style_name};
 
 
-enum AttributeType {
-  ATTRIBUTE_TRANSFORM = 0,
-  ATTRIBUTE_STYLE, 
-  ATTRIBUTE_XML_SPACE,
-  ATTRIBUTE_COUNT,
-};
-
-constexpr std::string_view attribute_name[ATTRIBUTE_COUNT] = {
-  "transform",
-  "style",
-  "xml:space",
-};
-
-constexpr InverseIndex<ATTRIBUTE_COUNT> inv_attribute{&attribute_name};
-
-static void apply_style(BaseShape *shape, BaseShape *parent, Attribute *attrs, int attrs_count) {
-  for (int i = 0; i < attrs_count; i++) {
-    std::string_view key = attrs[i].key;
-    std::string_view value = attrs[i].value;
-
-    switch ((StyleType) inv_style[key]) {
-      case STYLE_VISIBLE: {
-        if (value != "visible") shape->visible = false;
-      } break;
-
-      case STYLE_FILL: {
-        shape->fill = read_paint(value);
-      } break;
-
-      case STYLE_STROKE: {
-        if (value != "") shape->stroke = read_paint(value);
-      } break;
-
-      case STYLE_FONT_SIZE: {
-        shape->font_size = strtod(value.data(), nullptr);
-      } break;
-
-      case STYLE_OPACITY: {
-        shape->opacity = convert_percent(value);
-      } break;
-
-      case STYLE_FILL_OPACITY: {
-        shape->fill_opacity = convert_percent(value);
-      } break;
-
-      case STYLE_STROKE_OPACITY: {
-        shape->stroke_opacity = convert_percent(value);
-      } break;
-
-      case STYLE_STROKE_WIDTH: {
-        shape->stroke_width = strtod(value.data(), nullptr);
-      } break;
-
-      case STYLE_STROKE_DASH_OFFSET: {
-        shape->stroke_dash_offset = strtod(value.data(), nullptr);
-      } break;
-
-      case STYLE_STROKE_DASH_ARRAY: {
-        if (value != "none")
-          convert_array(value, shape->stroke_dash_array, &shape->stroke_dash_count);
-      } break;
-
-      case STYLE_STROKE_LINE_JOIN: {
-        int type = inv_linejoin[value];
-        if (type != -1) shape->stroke_line_join = (StrokeLineJoin) type;
-      } break;
-
-      case STYLE_STROKE_LINE_CAP: {
-        int type = inv_linecap[value];
-        if (type != -1) shape->stroke_line_cap = (StrokeLineCap)type;
-      } break;
-
-      case STYLE_MITER_LIMIT: {
-        shape->miter_limit = strtod(value.data(), nullptr);
-      } break;
-
-      case STYLE_FILL_RULE: {
-        int type = inv_fillrule[value];
-        if (type != -1) shape->fill_rule = (FillRule)type;
-      } break;
-
-      case STYLE_FONT_STYLE: {
-        int type = inv_fontstyle[value];
-        if (type != - 1) shape->font_style = (FontStyle)type;
-      } break;
-
-      case STYLE_FONT_WEIGHT: {
-        int type = inv_fontweight[value];
-        if (type == -1) {
-          shape->font_weight = strtod(value.data(), nullptr);
-        }  else {
-          switch ((FontWeight)type) {
-            case FONTWEIGHT_NORMAL: {
-              shape->font_weight = 400;
-            } break;
-            case FONTWEIGHT_BOLD: {
-              shape->font_weight = 700;
-            } break;
-            case FONTWEIGHT_BOLDER: {
-              if (parent == nullptr) {
-                shape->font_weight = 700;
+static_assert(STYLE_COUNT == ELEMENT_ATTR_FONT_FAMILY + 1, "presentation attributes must follow StyleType");
+
+static void apply_property(ComputedStyle *style, const ComputedStyle *parent, StyleType property, std::string_view value) {
+  switch (property) {
+    case STYLE_VISIBLE: {
+      if (value != "visible") style->visible = false;
+    } break;
+
+    case STYLE_FILL: {
+      style->fill = read_paint(value);
+    } break;
+
+    case STYLE_STROKE: {
+      if (value != "") style->stroke = read_paint(value);
+    } break;
+
+    case STYLE_FONT_SIZE: {
+      style->font_size = to_number(value);
+    } break;
+
+    case STYLE_OPACITY: {
+      style->opacity = convert_percent(value);
+    } break;
+
+    case STYLE_FILL_OPACITY: {
+      style->fill_opacity = convert_percent(value);
+    } break;
+
+    case STYLE_STROKE_OPACITY: {
+      style->stroke_opacity = convert_percent(value);
+    } break;
+
+    case STYLE_STROKE_WIDTH: {
+      style->stroke_width = to_number(value);
+    } break;
+
+    case STYLE_STROKE_DASH_OFFSET: {
+      style->stroke_dash_offset = to_number(value);
+    } break;
+
+    case STYLE_STROKE_DASH_ARRAY: {
+      if (value != "none")
+        convert_array(value, style->stroke_dash_array, &style->stroke_dash_count);
+    } break;
+
+    case STYLE_STROKE_LINE_JOIN: {
+      int type = inv_linejoin[value];
+      if (type != -1) style->stroke_line_join = (StrokeLineJoin) type;
+    } break;
+
+    case STYLE_STROKE_LINE_CAP: {
+      int type = inv_linecap[value];
+      if (type != -1) style->stroke_line_cap = (StrokeLineCap)type;
+    } break;
+
+    case STYLE_MITER_LIMIT: {
+      style->miter_limit = to_number(value);
+    } break;
+
+    case STYLE_FILL_RULE: {
+      int type = inv_fillrule[value];
+      if (type != -1) style->fill_rule = (FillRule)type;
+    } break;
+
+    case STYLE_FONT_STYLE: {
+      int type = inv_fontstyle[value];
+      if (type != - 1) style->font_style = (FontStyle)type;
+    } break;
+
+    case STYLE_FONT_WEIGHT: {
+      int type = inv_fontweight[value];
+      if (type == -1) {
+        style->font_weight = to_number(value);
+      }  else {
+        switch ((FontWeight)type) {
+          case FONTWEIGHT_NORMAL: {
+            style->font_weight = 400;
+          } break;
+          case FONTWEIGHT_BOLD: {
+            style->font_weight = 700;
+          } break;
+          case FONTWEIGHT_BOLDER: {
+            if (parent == nullptr) {
+              style->font_weight = 700;
+            } else {
+              if (parent->font_weight < 100) {
+                style->font_weight = 100;
+              } else if (parent->font_weight < 400) {
+                style->font_weight = 400;
+              } else if (parent->font_weight < 700) {
+                style->font_weight = 700;
+              } else if (parent->font_weight < 900){
+                style->font_weight = 900;
               } else {
-                if (parent->font_weight < 100) {
-                  shape->font_weight = 100;
-                } else if (parent->font_weight < 400) {
-                  shape->font_weight = 400;
-                } else if (parent->font_weight < 700) {
-                  shape->font_weight = 700;
-                } else if (parent->font_weight < 900){
-                  shape->font_weight = 900;
-                } else {
-                  shape->font_weight = parent->font_weight;
-                }
-              } 
-            } break;
-            case FONTWEIGHT_LIGHTER: {
-              if (parent == nullptr) {
-                shape->font_weight = 100;
+                style->font_weight = parent->font_weight;
+              }
+            } 
+          } break;
+          case FONTWEIGHT_LIGHTER: {
+            if (parent == nullptr) {
+              style->font_weight = 100;
+            } else {
+              if (parent->font_weight > 900) {
+                style->font_weight = 900;
+              } else if (parent->font_weight > 700) {
+                style->font_weight = 700;
+              } else if (parent->font_weight > 400) {
+                style->font_weight = 400;
+              } else if (parent->font_weight > 100){
+                style->font_weight = 100;
               } else {
-                if (parent->font_weight > 900) {
-                  shape->font_weight = 900;
-                } else if (parent->font_weight > 700) {
-                  shape->font_weight = 700;
-                } else if (parent->font_weight > 400) {
-                  shape->font_weight = 400;
-                } else if (parent->font_weight > 100){
-                  shape->font_weight = 100;
-                } else {
-                  shape->font_weight = parent->font_weight;
-                }
-              } 
-            } break;
-            case FONTWEIGHT_COUNT: {
-              __builtin_unreachable();
-            }
+                style->font_weight = parent->font_weight;
+              }
+            } 
+          } break;
+          case FONTWEIGHT_COUNT: {
+            __builtin_unreachable();
           }
-        } 
-      } break;
-      
-      case STYLE_FONT_FAMILY: {
-        shape->font_family = value;
-      } break;
-
-      case STYLE_COUNT: {
-        __builtin_unreachable();
-      }
+        }
+      } 
+    } break;
+    
+    case STYLE_FONT_FAMILY: {
+      style->font_family = value;
+    } break;
+
+    case STYLE_COUNT: {
+      __builtin_unreachable();
     }
   }
 }
 
-BaseShape::BaseShape(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles) {
+static void apply_style(ComputedStyle *style, const ComputedStyle *parent, const Attribute *attrs, int attrs_count) {
+  for (int i = 0; i < attrs_count; i++) {
+    int property = inv_style[attrs[i].key];
+    if (property != -1) apply_property(style, parent, (StyleType)property, attrs[i].value);
+  }
+}
+
+BaseShape::BaseShape(const AttributeSet *attrs, BaseShape *parent, ParseContext *context) :
+  kind{SHAPE_KIND_GROUP},
+  parent{parent},
+  next{nullptr},
+  arena{context->arena},
+  cache{nullptr} {
+  StylePool *styles = context->styles;
+  const ComputedStyle *parent_style = nullptr;
+  ComputedStyle style;
+
   if (parent == nullptr) {
-    this->visible = true;
-    this->fill = Paint::new_rgb(0, 0, 0);
-    this->stroke = Paint::new_transparent();
-    this->font_size = 16;
-    this->opacity = 1.0;
-    this->fill_opacity = 1.0;
-    this->stroke_opacity = 1.0;
-    this->stroke_width = 1.0;
-    this->stroke_dash_offset = 0.0;
-    this->stroke_dash_count = 0;
-    this->stroke_line_join = StrokeLineJoin::LINE_JOIN_MITER;
-    this->stroke_line_cap = StrokeLineCap::LINE_CAP_BUTT;
-    this->miter_limit = 4;
+    style = initial_style();
     this->transform = Transform::identity();
-    this->fill_rule = FillRule::FILL_RULE_NONZERO;
-    this->font_style = FontStyle::FONTSTYLE_NORMAL;
-    this->font_weight = 400;
-    this->font_family = "serif";
-    this->xml_space = true;
   } else {
-    this->visible = parent->visible;
-    this->fill = parent->fill;
-    this->stroke = parent->stroke;
-    this->font_size = parent->font_size;
-    this->opacity = parent->opacity;
-    this->fill_opacity = parent->fill_opacity;
-    this->stroke_opacity = parent->stroke_opacity;
-    this->stroke_width = parent->stroke_width;
-    this->stroke_dash_offset = parent->stroke_dash_offset;
-    this->stroke_dash_count = parent->stroke_dash_count;
-    this->stroke_line_join = parent->stroke_line_join;
-    this->stroke_line_cap = parent->stroke_line_cap;
-    this->miter_limit = parent->miter_limit;
+    parent_style = &(*styles)[parent->style];
+    style = *parent_style;
     this->transform = parent->transform;
-    this->fill_rule = parent->fill_rule;
-    this->font_style = parent->font_style;
-    this->font_weight = parent->font_weight;
-    this->font_family = parent->font_family;
-    this->xml_space = parent->xml_space;
   }
 
-  for (int i = 0; i < attrs_count; i++) {
-    std::string_view key = attrs[i].key;
-    std::string_view value = attrs[i].value;
-
-    if (key == "class") {
-      value = trim_start(value);
-      value = trim_end(value);
-
-      StyleSheet::iterator it = styles->find(value);
-      if (it != styles->end()) {
-        ArrayList<Attribute> *attr = &it->second;
-        apply_style(this, parent, attr->begin(), attr->len());
-      }
+  // Class rules come first, then the inline style, then the presentation
+  // attributes
+  if (attrs->has(ELEMENT_ATTR_CLASS)) {
+    std::string_view value = trim_end(trim_start((*attrs)[ELEMENT_ATTR_CLASS]));
+
+    StyleSheet::iterator it = context->stylesheet->find(value);
+    if (it != context->stylesheet->end()) {
+      ArrayList<Attribute> *attr = &it->second;
+      apply_style(&style, parent_style, attr->begin(), attr->len());
     }
   }
 
-  for (int i = 0; i < attrs_count; i++) {
-    std::string_view key = attrs[i].key;
-    std::string_view value = attrs[i].value;
-  
-    switch ((AttributeType)inv_attribute[key]) {
-      case ATTRIBUTE_TRANSFORM: {
-        this->transform = this->transform * convert_transform(value);
-      } break;
-
-      case ATTRIBUTE_STYLE: {
-        ArrayList<Attribute> attrs_style = process_style(value);
-        apply_style(this, parent, attrs_style.begin(), attrs_style.len());
-      } break;
-
-      case ATTRIBUTE_XML_SPACE: {
-        if(value == "preserve") this->xml_space = false;
-      } break;
-
-      case ATTRIBUTE_COUNT: {
-        __builtin_unreachable();
-      }
+  if (attrs->has(ELEMENT_ATTR_TRANSFORM)) {
+    this->transform = this->transform * convert_transform((*attrs)[ELEMENT_ATTR_TRANSFORM]);
+  }
+
+  if (attrs->has(ELEMENT_ATTR_STYLE)) {
+    ArrayList<Attribute> *scratch = context->style_scratch;
+    process_style((*attrs)[ELEMENT_ATTR_STYLE], scratch);
+    apply_style(&style, parent_style, scratch->begin(), scratch->len());
+  }
+
+  if (attrs->has(ELEMENT_ATTR_XML_SPACE) && (*attrs)[ELEMENT_ATTR_XML_SPACE] == "preserve") {
+    style.xml_space = false;
+  }
+
+  for (uint64_t bits = attrs->present & ELEMENT_ATTR_PRESENTATION; bits; bits &= bits - 1) {
+    ElementAttr attr = (ElementAttr)std::countr_zero(bits);
+    apply_property(&style, parent_style, (StyleType)attr, (*attrs)[attr]);
+  }
+
+  // Most elements don't restyle anything, so they can skip hashing
+  if (parent_style && style_equal(style, *parent_style)) {
+    this->style = parent->style;
+  } else {
+    this->style = styles->intern(style);
+  }
+}
+
+void BaseShape::build_path(PathData *) const {}
+
+GeometryCache *BaseShape::geometry_cache() const {
+  if (this->cache == nullptr) {
+    this->cache = this->arena->make<GeometryCache>(GeometryCache {
+      PathData {this->arena},
+      ArrayList<BezierCurve> {this->arena},
+      AABB {},
+      AABB {},
+      false,
+      false,
+      false,
+      false,
+    });
+  }
+  return this->cache;
+}
+
+const PathData &BaseShape::path() const {
+  GeometryCache *cache = this->geometry_cache();
+  if (cache->has_path == false) {
+    this->build_path(&cache->path);
+    cache->has_path = true;
+  }
+  return cache->path;
+}
+
+const ArrayList<BezierCurve> &BaseShape::beziers() const {
+  GeometryCache *cache = this->geometry_cache();
+  if (cache->has_beziers == false) {
+    this->path().to_beziers(&cache->beziers);
+    cache->has_beziers = true;
+  }
+  return cache->beziers;
+}
+
+const AABB &BaseShape::bounds() const {
+  GeometryCache *cache = this->geometry_cache();
+  if (cache->has_bounds == false) {
+    cache->bounds = this->get_bounding();
+    cache->has_bounds = true;
+  }
+  return cache->bounds;
+}
+
+const AABB &BaseShape::world_bounds() const {
+  GeometryCache *cache = this->geometry_cache();
+  if (cache->has_world_bounds == false) {
+    const PathData &path = this->path();
+    if (path.verbs.len()) {
+      cache->world_bounds = path_bounds(path, this->transform);
+    } else {
+      cache->world_bounds = transform_box(this->transform, this->bounds());
     }
+    cache->has_world_bounds = true;
   }
+  return cache->world_bounds;
+}
 
-  apply_style(this, parent, attrs, attrs_count);
+void BaseShape::prepare_geometry() const {
+  this->beziers();
+  this->bounds();
+  this->world_bounds();
 }
 
-ArrayList<BezierCurve> BaseShape::get_beziers() const {
-  return ArrayList<BezierCurve> {};
+void BaseShape::invalidate_geometry() {
+  if (this->cache == nullptr) return;
+  this->cache->path.clear();
+  this->cache->beziers.resize(0);
+  this->cache->has_path = false;
+  this->cache->has_beziers = false;
+  this->cache->has_bounds = false;
+  this->cache->has_world_bounds = false;
 }
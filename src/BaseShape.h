@@ -3,91 +3,102 @@
 
 #include "common.h"
 #include "ArrayList.h"
+#include "Arena.h"
+#include "AttributeSet.h"
+#include "Bounds.h"
 #include "utils.h"
 #include "Matrix.h"
 #include "Paint.h"
-
-enum StrokeLineJoin {
-  LINE_JOIN_ARCS = 0,
-  LINE_JOIN_BEVEL,
-  LINE_JOIN_MITER,
-  LINE_JOIN_MITER_CLIP,
-  LINE_JOIN_ROUND,
-  LINE_JOIN_COUNT,
-};
-
-enum StrokeLineCap {
-  LINE_CAP_BUTT = 0,
-  LINE_CAP_ROUND,
-  LINE_CAP_SQUARE,
-  LINE_CAP_COUNT,
+#include "PathData.h"
+#include "Style.h"
+
+enum ShapeKind {
+  SHAPE_KIND_GROUP = 0,
+  SHAPE_KIND_PATH,
+  SHAPE_KIND_RECT,
+  SHAPE_KIND_CIRCLE,
+  SHAPE_KIND_ELLIPSE,
+  SHAPE_KIND_LINE,
+  SHAPE_KIND_POLYLINE,
+  SHAPE_KIND_POLYGON,
+  SHAPE_KIND_TEXT,
+  SHAPE_KIND_SVG,
+  SHAPE_KIND_COUNT
 };
 
-enum FillRule {
-  FILL_RULE_NONZERO = 0,
-  FILL_RULE_EVENODD,
-  FILL_RULE_COUNT
+// What a shape remembers of its own geometry, see `BaseShape::path`
+struct GeometryCache {
+  PathData path;
+  ArrayList<BezierCurve> beziers;
+  AABB bounds;
+  AABB world_bounds;
+
+  bool has_path;
+  bool has_beziers;
+  bool has_bounds;
+  bool has_world_bounds;
 };
 
-enum FontStyle {
-  FONTSTYLE_NORMAL = 0,
-  FONTSTYLE_ITALIC,
-  FONTSTYLE_OBLIQUE,
-  FONTSTYLE_COUNT,
-};
-
-class BezierCurve {
-public:
-  Point start;
-  Point end;
-  Point control_start;
-  Point control_end;
-};
-
-
-struct AABB {
-  Point min;
-  Point max;
+// What the shapes of one document share while it is parsed. Shapes and
+// their payloads are allocated from `arena`, computed styles are interned in
+// `styles`. `style_scratch` holds the declarations of one inline style at a
+// time
+struct ParseContext {
+  StyleSheet *stylesheet;
+  StylePool *styles;
+  Arena *arena;
+  ArrayList<Attribute> *style_scratch;
 };
 
 class BaseShape {
 public:
-  BaseShape(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
+  BaseShape(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
   virtual ~BaseShape() = default;
 
-  bool visible;
-
-  Paint fill;
-  Paint stroke;
+  ShapeKind kind;
+  BaseShape *parent;
 
-  double font_size;
-  FontStyle font_style;
-  int font_weight;
-  std::string_view font_family;
+  // Index of the computed style in the document's `StylePool`
+  uint32_t style;
 
-  double opacity;
-  double fill_opacity;
-  double stroke_opacity;
+  Transform transform;
+  BaseShape *next;
 
-  double stroke_width;
-  double stroke_dash_offset;
-  double stroke_dash_array[8];
-  int stroke_dash_count;
+  // Returns the segments of the shape in its own coordinates. They are built
+  // on the first call and kept in the document's arena
+  virtual const PathData &path() const;
 
-  StrokeLineJoin stroke_line_join;
-  StrokeLineCap stroke_line_cap;
+  // Returns `path()` as cubic curves only, built on the first call
+  const ArrayList<BezierCurve> &beziers() const;
 
-  double miter_limit;
-  FillRule fill_rule;
+  // Returns the bounds of the shape in its own coordinates, computed once
+  const AABB &bounds() const;
 
-  bool xml_space;
+  // Returns the bounds of the shape after `transform`, computed once from
+  // the mapped segments. Shapes without segments map the corners of
+  // `bounds()` instead
+  const AABB &world_bounds() const;
 
-  Transform transform;
-  std::unique_ptr<BaseShape> next;
+  // Computes everything above at once, so that later calls only read what
+  // was kept and allocate nothing
+  void prepare_geometry() const;
 
-  virtual ArrayList<BezierCurve> get_beziers() const;
+  // Forgets the cached curves and bounds, must be called whenever something
+  // they are computed from changes
+  void invalidate_geometry();
+protected:
+  // Builds the segments of the shape, only called by `path()`
+  virtual void build_path(PathData *out) const;
 
+  // Computes the bounds of the shape, only called by `bounds()`
   virtual AABB get_bounding() const;
+private:
+  GeometryCache *geometry_cache() const;
+
+  // The cache is only allocated once something asks for it, most groups
+  // never need one
+  Arena *arena;
+  mutable GeometryCache *cache;
 };
 
 
@@ -0,0 +1,288 @@
+#include "Bounds.h"
+#include "Cpu.h"
+#include "Transform.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+// How many curves are gathered before their turning points are searched
+constexpr uint32_t BOUNDS_BATCH = 64;
+
+// Kernels take curves this many at a time, batches are padded to it
+constexpr uint32_t BOUNDS_LANES = 4;
+
+// The curves of a batch along one axis, one array per control point, in the
+// order start, control start, control end, end
+using CurveAxis = double[4][BOUNDS_BATCH];
+
+// For every curve, the derivative over three is a t^2 + b t + c with
+//   a = p3 - p0 + 3 (p1 - p2), b = 2 (p0 - 2 p1 + p2), c = p1 - p0
+// whose roots are found without branches: q = -(b + sign(b) sqrt(b^2 - 4ac)) / 2
+// gives the roots q / a and c / q, which stay accurate when either is tiny.
+// Roots that do not exist come out as NaN or infinite and are clamped to the
+// ends of the curve along with those outside [0, 1], which is harmless since
+// the ends count anyway. Each kernel grows `lo` and `hi` by the `count`
+// curves of `p`, `count` being a multiple of `BOUNDS_LANES`
+
+#ifdef CPU_X86
+
+static void cubic_extremes_sse2(const CurveAxis &p, uint32_t count, double *lo, double *hi) {
+  __m128d zero = _mm_setzero_pd();
+  __m128d one = _mm_set1_pd(1);
+  __m128d two = _mm_set1_pd(2);
+  __m128d three = _mm_set1_pd(3);
+  __m128d half = _mm_set1_pd(0.5);
+  __m128d sign = _mm_set1_pd(-0.0);
+
+  __m128d min = _mm_set1_pd(*lo);
+  __m128d max = _mm_set1_pd(*hi);
+  for (uint32_t i = 0; i < count; i += 2) {
+    __m128d p0 = _mm_loadu_pd(&p[0][i]);
+    __m128d p1 = _mm_loadu_pd(&p[1][i]);
+    __m128d p2 = _mm_loadu_pd(&p[2][i]);
+    __m128d p3 = _mm_loadu_pd(&p[3][i]);
+
+    __m128d a = _mm_add_pd(_mm_sub_pd(p3, p0), _mm_mul_pd(three, _mm_sub_pd(p1, p2)));
+    __m128d b = _mm_mul_pd(two, _mm_add_pd(_mm_sub_pd(p0, _mm_mul_pd(two, p1)), p2));
+    __m128d c = _mm_sub_pd(p1, p0);
+
+    __m128d disc = _mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(_mm_mul_pd(a, c), _mm_set1_pd(4)));
+    __m128d root = _mm_sqrt_pd(_mm_max_pd(disc, zero));
+    __m128d q = _mm_mul_pd(_mm_sub_pd(zero, half), _mm_add_pd(b, _mm_or_pd(_mm_and_pd(b, sign), root)));
+
+    // The maximum picks its second operand when the first is NaN
+    __m128d t0 = _mm_min_pd(_mm_max_pd(_mm_div_pd(q, a), zero), one);
+    __m128d t1 = _mm_min_pd(_mm_max_pd(_mm_div_pd(c, q), zero), one);
+
+    // The curve in power form is p0 + t (3 c + t (3 b / 2 + t a))
+    __m128d k1 = _mm_mul_pd(three, c);
+    __m128d k2 = _mm_mul_pd(_mm_set1_pd(1.5), b);
+    __m128d e0 = _mm_add_pd(p0, _mm_mul_pd(t0, _mm_add_pd(k1, _mm_mul_pd(t0, _mm_add_pd(k2, _mm_mul_pd(t0, a))))));
+    __m128d e1 = _mm_add_pd(p0, _mm_mul_pd(t1, _mm_add_pd(k1, _mm_mul_pd(t1, _mm_add_pd(k2, _mm_mul_pd(t1, a))))));
+
+    min = _mm_min_pd(min, _mm_min_pd(_mm_min_pd(e0, e1), _mm_min_pd(p0, p3)));
+    max = _mm_max_pd(max, _mm_max_pd(_mm_max_pd(e0, e1), _mm_max_pd(p0, p3)));
+  }
+
+  min = _mm_min_pd(min, _mm_unpackhi_pd(min, min));
+  max = _mm_max_pd(max, _mm_unpackhi_pd(max, max));
+  _mm_store_sd(lo, min);
+  _mm_store_sd(hi, max);
+}
+
+// Four curves per register, the polynomial evaluated with fused multiply-adds
+__attribute__((target("avx2,fma")))
+static void cubic_extremes_avx2(const CurveAxis &p, uint32_t count, double *lo, double *hi) {
+  __m256d zero = _mm256_setzero_pd();
+  __m256d one = _mm256_set1_pd(1);
+  __m256d two = _mm256_set1_pd(2);
+  __m256d three = _mm256_set1_pd(3);
+  __m256d half = _mm256_set1_pd(0.5);
+  __m256d sign = _mm256_set1_pd(-0.0);
+
+  __m256d min = _mm256_set1_pd(*lo);
+  __m256d max = _mm256_set1_pd(*hi);
+  for (uint32_t i = 0; i < count; i += 4) {
+    __m256d p0 = _mm256_loadu_pd(&p[0][i]);
+    __m256d p1 = _mm256_loadu_pd(&p[1][i]);
+    __m256d p2 = _mm256_loadu_pd(&p[2][i]);
+    __m256d p3 = _mm256_loadu_pd(&p[3][i]);
+
+    __m256d a = _mm256_fmadd_pd(three, _mm256_sub_pd(p1, p2), _mm256_sub_pd(p3, p0));
+    __m256d b = _mm256_mul_pd(two, _mm256_add_pd(_mm256_fnmadd_pd(two, p1, p0), p2));
+    __m256d c = _mm256_sub_pd(p1, p0);
+
+    __m256d disc = _mm256_fmsub_pd(b, b, _mm256_mul_pd(_mm256_mul_pd(a, c), _mm256_set1_pd(4)));
+    __m256d root = _mm256_sqrt_pd(_mm256_max_pd(disc, zero));
+    __m256d q = _mm256_mul_pd(_mm256_sub_pd(zero, half), _mm256_add_pd(b, _mm256_or_pd(_mm256_and_pd(b, sign), root)));
+
+    __m256d t0 = _mm256_min_pd(_mm256_max_pd(_mm256_div_pd(q, a), zero), one);
+    __m256d t1 = _mm256_min_pd(_mm256_max_pd(_mm256_div_pd(c, q), zero), one);
+
+    __m256d k1 = _mm256_mul_pd(three, c);
+    __m256d k2 = _mm256_mul_pd(_mm256_set1_pd(1.5), b);
+    __m256d e0 = _mm256_fmadd_pd(t0, _mm256_fmadd_pd(t0, _mm256_fmadd_pd(t0, a, k2), k1), p0);
+    __m256d e1 = _mm256_fmadd_pd(t1, _mm256_fmadd_pd(t1, _mm256_fmadd_pd(t1, a, k2), k1), p0);
+
+    min = _mm256_min_pd(min, _mm256_min_pd(_mm256_min_pd(e0, e1), _mm256_min_pd(p0, p3)));
+    max = _mm256_max_pd(max, _mm256_max_pd(_mm256_max_pd(e0, e1), _mm256_max_pd(p0, p3)));
+  }
+
+  __m128d min2 = _mm_min_pd(_mm256_castpd256_pd128(min), _mm256_extractf128_pd(min, 1));
+  __m128d max2 = _mm_max_pd(_mm256_castpd256_pd128(max), _mm256_extractf128_pd(max, 1));
+  _mm_store_sd(lo, _mm_min_pd(min2, _mm_unpackhi_pd(min2, min2)));
+  _mm_store_sd(hi, _mm_max_pd(max2, _mm_unpackhi_pd(max2, max2)));
+}
+
+#else
+
+static double clamp_unit(double t) {
+  return t > 0 ? (t < 1 ? t : 1) : 0;
+}
+
+static void cubic_extremes_scalar(const CurveAxis &p, uint32_t count, double *lo, double *hi) {
+  for (uint32_t i = 0; i < count; ++i) {
+    double a = p[3][i] - p[0][i] + 3 * (p[1][i] - p[2][i]);
+    double b = 2 * (p[0][i] - 2 * p[1][i] + p[2][i]);
+    double c = p[1][i] - p[0][i];
+
+    double root = std::sqrt(std::max(b * b - 4 * a * c, 0.0));
+    double q = -0.5 * (b + std::copysign(root, b));
+
+    double ts[2] = {clamp_unit(q / a), clamp_unit(c / q)};
+    for (double t : ts) {
+      double value = p[0][i] + t * (3 * c + t * (1.5 * b + t * a));
+      *lo = std::min(*lo, value);
+      *hi = std::max(*hi, value);
+    }
+
+    *lo = std::min(*lo, std::min(p[0][i], p[3][i]));
+    *hi = std::max(*hi, std::max(p[0][i], p[3][i]));
+  }
+}
+
+#endif
+
+using CubicExtremesFn = void (*)(const CurveAxis &p, uint32_t count, double *lo, double *hi);
+
+static CubicExtremesFn select_cubic_extremes() {
+#ifdef CPU_X86
+  if (cpu_has_avx2_fma()) return cubic_extremes_avx2;
+  return cubic_extremes_sse2;
+#else
+  return cubic_extremes_scalar;
+#endif
+}
+
+// Curves waiting for their turning points to be searched
+struct CurveBatch {
+  CurveAxis x;
+  CurveAxis y;
+  uint32_t len;
+};
+
+// Grows `bounds` by every curve of the batch and empties it
+static void flush_batch(CurveBatch *batch, AABB *bounds) {
+  static const CubicExtremesFn kernel = select_cubic_extremes();
+  if (batch->len == 0) return;
+
+  // Repeating the last curve changes nothing about the bounds
+  uint32_t count = (batch->len + BOUNDS_LANES - 1) / BOUNDS_LANES * BOUNDS_LANES;
+  for (int k = 0; k < 4; ++k) {
+    std::fill(&batch->x[k][batch->len], &batch->x[k][count], batch->x[k][batch->len - 1]);
+    std::fill(&batch->y[k][batch->len], &batch->y[k][count], batch->y[k][batch->len - 1]);
+  }
+
+  kernel(batch->x, count, &bounds->min[0], &bounds->max[0]);
+  kernel(batch->y, count, &bounds->min[1], &bounds->max[1]);
+  batch->len = 0;
+}
+
+static void push_curve(CurveBatch *batch, AABB *bounds, Point p0, Point p1, Point p2, Point p3) {
+  uint32_t i = batch->len++;
+  batch->x[0][i] = p0[0];
+  batch->x[1][i] = p1[0];
+  batch->x[2][i] = p2[0];
+  batch->x[3][i] = p3[0];
+  batch->y[0][i] = p0[1];
+  batch->y[1][i] = p1[1];
+  batch->y[2][i] = p2[1];
+  batch->y[3][i] = p3[1];
+
+  if (batch->len == BOUNDS_BATCH) flush_batch(batch, bounds);
+}
+
+// Grows `bounds` to hold a point
+static void add_point(AABB *bounds, Point p) {
+  for (int j = 0; j < 2; j++) {
+    bounds->min[j] = std::min(bounds->min[j], p[j]);
+    bounds->max[j] = std::max(bounds->max[j], p[j]);
+  }
+}
+
+// Bounds the segments of `verbs` drawn through `points`, which may be the
+// points of the path or a mapped copy of them
+static AABB segment_bounds(const ArrayList<PathVerb> &verbs, const Point *points) {
+  AABB bounds;
+  bounds.min[0] = std::numeric_limits<double>::max();
+  bounds.min[1] = std::numeric_limits<double>::max();
+  bounds.max[0] = std::numeric_limits<double>::lowest();
+  bounds.max[1] = std::numeric_limits<double>::lowest();
+
+  CurveBatch batch;
+  batch.len = 0;
+
+  // A lone move draws nothing, so points only count once a segment leaves them
+  const Point *point = points;
+  Point current = {0, 0};
+  for (PathVerb verb : verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        current = point[0];
+      } break;
+
+      case PATH_VERB_LINE: {
+        add_point(&bounds, current);
+        add_point(&bounds, point[0]);
+        current = point[0];
+      } break;
+
+      case PATH_VERB_QUAD: {
+        BezierCurve curve = elevate_quad(current, point[0], point[1]);
+        push_curve(&batch, &bounds, curve.start, curve.control_start, curve.control_end, curve.end);
+        current = point[1];
+      } break;
+
+      case PATH_VERB_CUBIC: {
+        push_curve(&batch, &bounds, current, point[0], point[1], point[2]);
+        current = point[2];
+      } break;
+
+      // The closing line ends where the subpath began, which was already
+      // counted by its first segment
+      case PATH_VERB_CLOSE: break;
+
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      }
+    }
+    point += path_verb_points[verb];
+  }
+
+  flush_batch(&batch, &bounds);
+  return bounds;
+}
+
+AABB path_bounds(const PathData &path) {
+  return segment_bounds(path.verbs, path.points.begin());
+}
+
+AABB path_bounds(const PathData &path, const Transform &transform) {
+  ArrayList<Point> mapped;
+  mapped.resize(path.points.len());
+  transform_points(transform, path.points.begin(), mapped.begin(), path.points.len());
+  return segment_bounds(path.verbs, mapped.begin());
+}
+
+AABB transform_box(const Transform &transform, const AABB &box) {
+  Point corners[4] = {
+    Point {box.min[0], box.min[1]},
+    Point {box.min[0], box.max[1]},
+    Point {box.max[0], box.min[1]},
+    Point {box.max[0], box.max[1]},
+  };
+  transform_points(transform, corners, corners, 4);
+
+  AABB result = {corners[0], corners[0]};
+  for (int i = 1; i < 4; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      result.min[j] = std::min(result.min[j], corners[i][j]);
+      result.max[j] = std::max(result.max[j], corners[i][j]);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,24 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "Matrix.h"
+#include "PathData.h"
+
+struct AABB {
+  Point min;
+  Point max;
+};
+
+// Returns the exact bounds of the segments of `path`, the turning points of
+// its curves included. A path that draws nothing has its min above its max
+AABB path_bounds(const PathData &path);
+
+// Returns the exact bounds of `path` mapped through `transform`. An affine
+// map keeps a curve the curve of its mapped control points, so this is as
+// tight as `path_bounds` rather than the box around its mapped corners
+AABB path_bounds(const PathData &path, const Transform &transform);
+
+// Returns the box around the corners of `box` mapped through `transform`
+AABB transform_box(const Transform &transform, const AABB &box);
+
+#endif
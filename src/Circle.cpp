@@ -1,52 +1,20 @@
 #include "Circle.h"
-#include "InverseIndex.h"
+#include "Number.h"
 
 using namespace SVGShapes;
 
-enum CircleAttr {
-  CIRCLE_ATTR_CX = 0,
-  CIRCLE_ATTR_CY,
-  CIRCLE_ATTR_R,
-  CIRCLE_ATTR_COUNT,
-};
-
-constexpr std::string_view circle_attr_name[CIRCLE_ATTR_COUNT] = {
-  "cx", 
-  "cy",
-  "r",
-};
-
-constexpr InverseIndex<CIRCLE_ATTR_COUNT> inv_circle_attribute {&circle_attr_name};
-
-Circle::Circle(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles) :
-  BaseShape(attrs, attrs_count, parent, styles),
+Circle::Circle(const AttributeSet *attrs, BaseShape *parent, ParseContext *context) :
+  BaseShape(attrs, parent, context),
   c{0, 0},
   r{0} {
-  for (int i = 0; i < attrs_count; ++i) {
-    std::string_view key = attrs[i].key;
-    std::string_view value = attrs[i].value;
-      
-    switch ((CircleAttr)inv_circle_attribute[key]) {
-      case CIRCLE_ATTR_CX: {
-        this->c[0] = strtod(value.data(), nullptr);
-      } break;
-
-      case CIRCLE_ATTR_CY: {
-        this->c[1] = strtod(value.data(), nullptr);
-      } break;
-
-      case CIRCLE_ATTR_R: {
-        this->r = strtod(value.data(), nullptr);
-      } break;
+  this->kind = SHAPE_KIND_CIRCLE;
 
-      case CIRCLE_ATTR_COUNT: {
-        __builtin_unreachable();
-      }
-    }
-  }
+  if (attrs->has(ELEMENT_ATTR_CX)) this->c[0] = to_number((*attrs)[ELEMENT_ATTR_CX]);
+  if (attrs->has(ELEMENT_ATTR_CY)) this->c[1] = to_number((*attrs)[ELEMENT_ATTR_CY]);
+  if (attrs->has(ELEMENT_ATTR_R)) this->r = to_number((*attrs)[ELEMENT_ATTR_R]);
 }
 
-ArrayList<BezierCurve> Circle::get_beziers() const {
+void Circle::build_path(PathData *out) const {
   double r = this->r;
 
   Point p0 = this->c + Point {-r, 0};
@@ -54,22 +22,10 @@ ArrayList<BezierCurve> Circle::get_beziers() const {
   Point p2 = this->c + Point {r, 0};
   Point p3 = this->c + Point {0, -r};
 
-  ArrayList<BezierCurve> curves;
-  curves.push(BezierCurve {
-    p0, p1, p0 + Point {r * KX, r * KY}, p1 - Point {r * KY, r * KX}
-  });
-
-  curves.push(BezierCurve {
-    p1, p2, p1 + Point {r * KY, -r * KX}, p2 - Point {r * KX, -r * KY}
-  });
-
-  curves.push(BezierCurve {
-    p2, p3, p2 + Point {-r * KX, -r * KY}, p3 - Point {-r * KY, - r * KX }
-  });
-
-  curves.push(BezierCurve {
-    p3, p0, p3 + Point {-r * KY, r * KX}, p0 - Point {-r * KX, r * KY}
-  });
-
-  return curves;
+  out->move_to(p0);
+  out->cubic_to(p0 + Point {r * KX, r * KY}, p1 - Point {r * KY, r * KX}, p1);
+  out->cubic_to(p1 + Point {r * KY, -r * KX}, p2 - Point {r * KX, -r * KY}, p2);
+  out->cubic_to(p2 + Point {-r * KX, -r * KY}, p3 - Point {-r * KY, - r * KX }, p3);
+  out->cubic_to(p3 + Point {-r * KY, r * KX}, p0 - Point {-r * KX, r * KY}, p0);
+  out->close();
 }
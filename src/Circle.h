@@ -7,9 +7,9 @@ namespace SVGShapes {
 
 class Circle final : public BaseShape {
 public:
-  Circle(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-
-  ArrayList<BezierCurve> get_beziers() const override;
+  Circle(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
+  void build_path(PathData *out) const override;
 private:
   Point c;
   double r;
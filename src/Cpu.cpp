@@ -0,0 +1,40 @@
+#include "Cpu.h"
+
+#ifdef CPU_X86
+
+#include <cpuid.h>
+#include <cstdint>
+
+static bool detect_fma() {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return ecx & bit_FMA;
+}
+
+static bool detect_avx2() {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+
+  bool osxsave = ecx & bit_OSXSAVE;
+  bool avx = ecx & bit_AVX;
+  if (!osxsave || !avx) return false;
+
+  uint32_t xcr0_low, xcr0_high;
+  __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+  if ((xcr0_low & 0x6) != 0x6) return false;
+
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+  return ebx & bit_AVX2;
+}
+
+bool cpu_has_avx2() {
+  static const bool has = detect_avx2();
+  return has;
+}
+
+bool cpu_has_avx2_fma() {
+  static const bool has = cpu_has_avx2() && detect_fma();
+  return has;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CPU_H
+#define CPU_H
+
+// Defined when SSE2 can be used unconditionally and AVX2 can be checked for
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define CPU_X86 1
+#endif
+
+#ifdef CPU_X86
+
+// Returns whether the processor has AVX2 and the OS saves the AVX registers,
+// checked once
+bool cpu_has_avx2();
+
+// Returns whether AVX2 can be used and the processor also has FMA
+bool cpu_has_avx2_fma();
+
+#endif
+
+#endif
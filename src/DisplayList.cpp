@@ -0,0 +1,229 @@
+#include "DisplayList.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Transform.h"
+
+// Resolves a gradient coordinate, percentages are of `max_val` in user space
+// and of the unit square in object bounding box units
+static double apply_percent(double val, bool percent, double max_val, GradientUnits gradient_units) {
+  if (percent == false) return val;
+  if (gradient_units == GRADIENT_UNIT_OBJECT_BOUNDING_BOX) return val / 100;
+  return max_val / 100 * val;
+}
+
+// Returns the gradient a url paint refers to, or null if there is none
+static const Gradient *find_gradient(const Paint &paint, const GradientMap &gradient_map) {
+  std::string_view url {
+    paint.variants.url_paint.data,
+    (size_t)paint.variants.url_paint.len
+  };
+
+  while (url.size() > 1 && url[0] != '#') {
+    url = url.substr(1, url.size() - 2);
+  }
+
+  if (url.size() <= 1 || url[0] != '#') return nullptr;
+  url = url.substr(1);
+
+  GradientMap::const_iterator it = gradient_map.find(url);
+  if (it == gradient_map.end()) return nullptr;
+  return &it->second;
+}
+
+// Resolves `paint` for `node` of `scene` into `list`, returns its index or
+// `DISPLAY_NO_PAINT` when it draws nothing
+static uint32_t add_paint(DisplayList *list, const Paint &paint, double opacity, const Scene *scene, uint32_t node) {
+  const ParseResult *result = scene->document;
+
+  DisplayPaint out = {};
+  out.spread = SPREAD_METHOD_PAD;
+  out.transform = Transform::identity();
+
+  switch (paint.type) {
+    case PAINT_TRANSPARENT: {
+      return DISPLAY_NO_PAINT;
+    } break;
+
+    case PAINT_RGB: {
+      out.kind = DISPLAY_PAINT_SOLID;
+      out.color = DisplayColor {
+        paint.variants.rgb_paint.r,
+        paint.variants.rgb_paint.g,
+        paint.variants.rgb_paint.b,
+        opacity,
+      };
+    } break;
+
+    case PAINT_URL: {
+      const Gradient *gradient = find_gradient(paint, result->gradient_map);
+      if (gradient == nullptr || gradient->stops.len() == 0) return DISPLAY_NO_PAINT;
+
+      const AABB &size = scene->shapes[node]->bounds();
+      double width = size.max[0] - size.min[0];
+      double height = size.max[1] - size.min[1];
+
+      // Object bounding box units map the unit square onto the bounds, which
+      // can't be done for a flat shape
+      Transform box = Transform::identity();
+      if (gradient->gradient_units == GRADIENT_UNIT_OBJECT_BOUNDING_BOX) {
+        if (!(width > 0 && height > 0)) return DISPLAY_NO_PAINT;
+        box.m[0][0] = width;
+        box.m[1][1] = height;
+        box.d = size.min;
+      }
+
+      switch (gradient->type) {
+        case GRADIENT_TYPE_LINEAR: {
+          const LinearGradient &linear = gradient->variants.linear;
+          double root_width = result->root ? result->root->width : 0;
+          double root_height = result->root ? result->root->height : 0;
+
+          out.kind = DISPLAY_PAINT_LINEAR;
+          out.start = Point {
+            apply_percent(linear.x1.val, linear.x1.percent, root_width, gradient->gradient_units),
+            apply_percent(linear.y1.val, linear.y1.percent, root_height, gradient->gradient_units),
+          };
+          out.end = Point {
+            apply_percent(linear.x2.val, linear.x2.percent, root_width, gradient->gradient_units),
+            apply_percent(linear.y2.val, linear.y2.percent, root_height, gradient->gradient_units),
+          };
+        } break;
+
+        case GRADIENT_TYPE_RADIAL: {
+          const RadialGradient &radial = gradient->variants.radial;
+          PercentUnit fx = radial.fx || radial.cx;
+          PercentUnit fy = radial.fy || radial.cy;
+
+          out.kind = DISPLAY_PAINT_RADIAL;
+          out.start = Point {
+            apply_percent(radial.cx.val, radial.cx.percent, width, gradient->gradient_units),
+            apply_percent(radial.cy.val, radial.cy.percent, height, gradient->gradient_units),
+          };
+          out.end = Point {
+            apply_percent(fx.val, fx.percent, width, gradient->gradient_units),
+            apply_percent(fy.val, fy.percent, height, gradient->gradient_units),
+          };
+          out.radius = apply_percent(radial.r.val, radial.r.percent, width, gradient->gradient_units);
+        } break;
+
+        case GRADIENT_TYPE_COUNT: {
+          __builtin_unreachable();
+        }
+      }
+
+      out.spread = gradient->spread_method;
+      out.transform = scene->transform(node) * box * gradient->transform;
+
+      // Offsets are clamped and never go back, as SVG asks of stops
+      out.stops = DisplayRange {list->stops.len(), gradient->stops.len()};
+      double offset = 0;
+      for (const Stop &stop : gradient->stops) {
+        offset = std::clamp(stop.offset, offset, 1.0);
+        list->stops.push(DisplayStop {
+          offset,
+          DisplayColor {
+            stop.stop_color.r,
+            stop.stop_color.g,
+            stop.stop_color.b,
+            stop.stop_opacity * opacity,
+          },
+        });
+      }
+    } break;
+  }
+
+  list->paints.push(out);
+  return list->paints.len() - 1;
+}
+
+static double det(const Transform &transform) {
+  return transform.m[0][0] * transform.m[1][1] - transform.m[0][1] * transform.m[1][0];
+}
+
+DisplayList compile_display_list(const Scene *scene) {
+  DisplayList list;
+
+  for (uint32_t node = 0; node < scene->len(); ++node) {
+    const ComputedStyle &style = scene->style(node);
+    if (style.visible == false) continue;
+
+    bool is_text = scene->kinds[node] == SHAPE_KIND_TEXT;
+    const ScenePath &path = scene->geometry[node];
+    if (is_text == false && path.verbs.count == 0) continue;
+
+    const BaseShape *shape = scene->shapes[node];
+    const Transform &transform = scene->transform(node);
+
+    DisplayItem item = {};
+    item.kind = is_text ? DISPLAY_ITEM_TEXT : DISPLAY_ITEM_PATH;
+    item.fill_rule = style.fill_rule;
+    item.node = node;
+    item.fill = add_paint(&list, style.fill, style.fill_opacity * style.opacity, scene, node);
+
+    // Strokes scale with the transform, by its mean scale when it stretches
+    // one axis more than the other
+    double stroke_scale = std::sqrt(std::abs(det(transform)));
+    double stroke_width = style.stroke_width * stroke_scale;
+    item.stroke = DISPLAY_NO_PAINT;
+    if (stroke_width > 0) {
+      item.stroke = add_paint(&list, style.stroke, style.stroke_opacity * style.opacity, scene, node);
+    }
+    if (item.fill == DISPLAY_NO_PAINT && item.stroke == DISPLAY_NO_PAINT) continue;
+
+    item.bounds = scene->bounds[node];
+    if (item.stroke != DISPLAY_NO_PAINT) {
+      DisplayStroke stroke = {};
+      stroke.width = stroke_width;
+      stroke.miter_limit = style.miter_limit;
+      stroke.join = style.stroke_line_join;
+      stroke.cap = style.stroke_line_cap;
+      stroke.dash_offset = style.stroke_dash_offset * stroke_scale;
+      stroke.dash_count = style.stroke_dash_count;
+      for (int i = 0; i < style.stroke_dash_count; ++i) {
+        stroke.dash_array[i] = style.stroke_dash_array[i] * stroke_scale;
+      }
+      item.stroke_style = list.strokes.len();
+      list.strokes.push(stroke);
+
+      // A stroke reaches half its width past the outline, or further at
+      // miter joins and square caps
+      double reach = stroke_width / 2 * std::max(style.miter_limit, std::sqrt(2.0));
+      item.bounds.min = item.bounds.min - Point {reach, reach};
+      item.bounds.max = item.bounds.max + Point {reach, reach};
+    }
+
+    item.geometry = DisplayPath {
+      DisplayRange {list.verbs.len(), 0},
+      DisplayRange {list.points.len(), 0},
+    };
+    if (is_text) {
+      const SVGShapes::Text *text = static_cast<const SVGShapes::Text*>(shape);
+      item.text = list.texts.len();
+      list.texts.push(DisplayText {
+        text->content,
+        style.font_family,
+        text->pos + text->d,
+        style.font_size,
+        style.font_style,
+        style.font_weight,
+        text->text_anchor,
+        transform,
+      });
+    } else {
+      item.geometry.verbs.count = path.verbs.count;
+      item.geometry.points.count = path.points.count;
+      list.verbs.extend(scene->paths.verbs.begin() + path.verbs.start, path.verbs.count);
+      list.points.resize(list.points.len() + path.points.count);
+      transform_points(
+        transform, scene->paths.points.begin() + path.points.start,
+        list.points.begin() + item.geometry.points.start, path.points.count
+      );
+    }
+
+    list.items.push(item);
+  }
+
+  return list;
+}
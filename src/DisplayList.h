@@ -0,0 +1,141 @@
+#ifndef DISPLAY_LIST_H
+#define DISPLAY_LIST_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "Scene.h"
+#include "Text.h"
+
+constexpr uint32_t DISPLAY_NO_PAINT = UINT32_MAX;
+
+// A slice of one of the buffers of a `DisplayList`
+struct DisplayRange {
+  uint32_t start;
+  uint32_t count;
+};
+
+// Where an outline lives in `DisplayList::verbs` and `DisplayList::points`
+struct DisplayPath {
+  DisplayRange verbs;
+  DisplayRange points;
+};
+
+enum DisplayItemKind : uint8_t {
+  DISPLAY_ITEM_PATH = 0,
+  DISPLAY_ITEM_TEXT,
+  DISPLAY_ITEM_COUNT,
+};
+
+enum DisplayPaintKind : uint8_t {
+  DISPLAY_PAINT_SOLID = 0,
+  DISPLAY_PAINT_LINEAR,
+  DISPLAY_PAINT_RADIAL,
+  DISPLAY_PAINT_COUNT,
+};
+
+// A color with straight alpha, every channel from 0 to 1
+struct DisplayColor {
+  double r, g, b, a;
+};
+
+struct DisplayStop {
+  double offset;
+  DisplayColor color;
+};
+
+// A fill or stroke with its gradient looked up and its opacity folded into
+// the colors. Gradients are described in their own space, `transform` maps
+// it to the world through the object bounding box when the gradient uses it
+struct DisplayPaint {
+  DisplayPaintKind kind;
+  SpreadMethod spread;
+
+  // The color of a solid paint
+  DisplayColor color;
+
+  // A linear gradient runs from `start` to `end`. A radial one is the
+  // circle around `start` with `radius`, focused on `end`
+  Point start;
+  Point end;
+  double radius;
+  Transform transform;
+
+  // Into `DisplayList::stops`, with offsets that never decrease
+  DisplayRange stops;
+};
+
+// How a stroked item is outlined, lengths are in world units
+struct DisplayStroke {
+  double width;
+  double miter_limit;
+  StrokeLineJoin join;
+  StrokeLineCap cap;
+  double dash_offset;
+  double dash_array[8];
+  int dash_count;
+};
+
+// Text is laid out by the backend, from the start of its baseline in the
+// coordinates of the element
+struct DisplayText {
+  std::string_view content;
+  std::string_view font_family;
+  Point origin;
+  double font_size;
+  FontStyle font_style;
+  int font_weight;
+  TextAnchor anchor;
+  Transform transform;
+};
+
+// One drawing command, the fill is painted before the stroke
+struct DisplayItem {
+  DisplayItemKind kind;
+  FillRule fill_rule;
+
+  // The node of the `Scene` the item comes from, for its parent, style and
+  // transform
+  uint32_t node;
+
+  // Into `DisplayList::paints`, or `DISPLAY_NO_PAINT`
+  uint32_t fill;
+  uint32_t stroke;
+
+  // Into `DisplayList::strokes`, only when `stroke` is a paint
+  uint32_t stroke_style;
+
+  // Into `DisplayList::texts`, only for text
+  uint32_t text;
+
+  // The outline in world space, empty for text
+  DisplayPath geometry;
+
+  // The box the item paints in world space, strokes included. For text it
+  // is an estimate, a backend laying out the glyphs knows better
+  AABB bounds;
+};
+
+// What a document draws, in painting order, with everything a backend needs
+// resolved: paints are plain colors or gradients with their geometry, strokes
+// carry their parameters and outlines are already in world space. Elements
+// that paint nothing are left out. Every outline lives in one verb buffer and
+// one point buffer, so backends walk them linearly
+struct DisplayList {
+  ArrayList<DisplayItem> items;
+  ArrayList<DisplayPaint> paints;
+  ArrayList<DisplayStop> stops;
+  ArrayList<DisplayStroke> strokes;
+  ArrayList<DisplayText> texts;
+  ArrayList<PathVerb> verbs;
+  ArrayList<Point> points;
+
+  // Returns the number of items
+  uint32_t len() const { return this->items.len(); }
+};
+
+// Compiles the nodes of `scene` into a `DisplayList`. Text items keep views
+// into the document of the scene, which must outlive them
+DisplayList compile_display_list(const Scene *scene);
+
+#endif
@@ -0,0 +1,145 @@
+#include "DocumentSource.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+DocumentSource::DocumentSource() :
+  type{DOCUMENT_SOURCE_BORROWED},
+  data{nullptr},
+  size{0},
+  owned{nullptr} {}
+
+DocumentSource::DocumentSource(DocumentSource &&other) :
+  type{other.type},
+  data{other.data},
+  size{other.size},
+  owned{std::move(other.owned)} {
+  other.type = DOCUMENT_SOURCE_BORROWED;
+  other.data = nullptr;
+  other.size = 0;
+}
+
+DocumentSource &DocumentSource::operator=(DocumentSource &&other) {
+  if (this != &other) {
+    this->release();
+    this->type = other.type;
+    this->data = other.data;
+    this->size = other.size;
+    this->owned = std::move(other.owned);
+
+    other.type = DOCUMENT_SOURCE_BORROWED;
+    other.data = nullptr;
+    other.size = 0;
+  }
+  return *this;
+}
+
+DocumentSource::~DocumentSource() {
+  this->release();
+}
+
+void DocumentSource::release() {
+  if (this->type == DOCUMENT_SOURCE_MAPPED && this->data) {
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+#else
+    munmap((void*)this->data, this->size);
+#endif
+  }
+  this->owned = nullptr;
+  this->type = DOCUMENT_SOURCE_BORROWED;
+  this->data = nullptr;
+  this->size = 0;
+}
+
+Optional<DocumentSource> DocumentSource::map_file(const char *filename) {
+  DocumentSource source;
+  source.type = DOCUMENT_SOURCE_MAPPED;
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(
+    filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+  );
+  if (file == INVALID_HANDLE_VALUE) return Optional<DocumentSource>::none();
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return Optional<DocumentSource>::none();
+  }
+
+  // Empty files can't be mapped, but they are still valid (empty) documents
+  if (file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return Optional<DocumentSource>::some(DocumentSource {});
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) return Optional<DocumentSource>::none();
+
+  // The view keeps the mapping alive after its handle is closed
+  const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == NULL) return Optional<DocumentSource>::none();
+
+  source.data = (const char*)view;
+  source.size = (size_t)file_size.QuadPart;
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return Optional<DocumentSource>::none();
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return Optional<DocumentSource>::none();
+  }
+
+  if (info.st_size == 0) {
+    close(fd);
+    return Optional<DocumentSource>::some(DocumentSource {});
+  }
+
+  void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED) return Optional<DocumentSource>::none();
+
+  madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+  source.data = (const char*)view;
+  source.size = (size_t)info.st_size;
+#endif
+
+  return Optional<DocumentSource>::some(std::move(source));
+}
+
+DocumentSource DocumentSource::adopt(std::unique_ptr<char[]> data, size_t size) {
+  DocumentSource source;
+  source.type = DOCUMENT_SOURCE_OWNED;
+  source.data = data.get();
+  source.size = size;
+  source.owned = std::move(data);
+  return source;
+}
+
+DocumentSource DocumentSource::borrow(std::string_view content) {
+  DocumentSource source;
+  source.type = DOCUMENT_SOURCE_BORROWED;
+  source.data = content.data();
+  source.size = content.size();
+  return source;
+}
+
+std::string_view DocumentSource::view() const {
+  return std::string_view {this->data, this->size};
+}
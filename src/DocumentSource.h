@@ -0,0 +1,48 @@
+#ifndef DOCUMENT_SOURCE_H
+#define DOCUMENT_SOURCE_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "utils.h"
+
+enum DocumentSourceType {
+  DOCUMENT_SOURCE_BORROWED = 0,
+  DOCUMENT_SOURCE_OWNED,
+  DOCUMENT_SOURCE_MAPPED,
+};
+
+// The bytes of a document. Every `std::string_view` the parser produces
+// points into this buffer, so it is owned by the `ParseResult`. The buffer
+// never moves, moving a `DocumentSource` keeps all views valid
+class DocumentSource {
+public:
+  DocumentSource();
+  DocumentSource(DocumentSource &&other);
+  DocumentSource &operator=(DocumentSource &&other);
+  ~DocumentSource();
+
+  DocumentSource(const DocumentSource&) = delete;
+  DocumentSource &operator=(const DocumentSource&) = delete;
+
+  // Maps a file read-only into memory without copying it
+  static Optional<DocumentSource> map_file(const char *filename);
+
+  // Takes ownership of `size` bytes from a caller-allocated buffer
+  static DocumentSource adopt(std::unique_ptr<char[]> data, size_t size);
+
+  // Refers to `content` without owning it, the caller keeps it alive
+  static DocumentSource borrow(std::string_view content);
+
+  std::string_view view() const;
+private:
+  void release();
+
+  DocumentSourceType type;
+  const char *data;
+  size_t size;
+  std::unique_ptr<char[]> owned;
+};
+
+#endif
@@ -0,0 +1,367 @@
+#include "Flatten.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// Cubics are first approximated by quadratics, which may use this share of
+// the tolerance, the rest is left to flattening the quadratics
+constexpr double FLATTEN_QUAD_SHARE = 0.2;
+
+// Bounds the lines of one quadratic and the quadratics of one cubic, in case
+// the tolerance is absurdly small
+constexpr double FLATTEN_MAX_LINES = 1 << 16;
+
+// How many parameters are evaluated together
+constexpr uint32_t FLATTEN_BATCH = 16;
+
+// Approximates the integral of the arc length density of the parabola
+// y = x^2, from "Flattening quadratic Béziers" by Raph Levien. Spacing the
+// lines evenly in this integral spreads the error evenly over them
+static double approx_parabola_integral(double x) {
+  constexpr double d = 0.67;
+  return x / (1 - d + std::sqrt(std::sqrt(d * d * d * d + 0.25 * x * x)));
+}
+
+// The inverse of `approx_parabola_integral`
+static double approx_parabola_inv_integral(double x) {
+  constexpr double b = 0.39;
+  return x * (1 - b + std::sqrt(b * b + 0.25 * x * x));
+}
+
+static uint32_t line_count(double count) {
+  if (!(count > 1)) return 1;
+  return (uint32_t)std::ceil(std::min(count, FLATTEN_MAX_LINES));
+}
+
+// Evaluates the quadratic at each of the `count` parameters of `t`. The loop
+// only does independent multiply-adds over plain arrays so the compiler can
+// run it on vector registers
+static void eval_quad_batch(Point p0, Point p1, Point p2, const double *t, uint32_t count, Point *out) {
+  double bx = 2 * (p1[0] - p0[0]);
+  double by = 2 * (p1[1] - p0[1]);
+  double cx = p0[0] - 2 * p1[0] + p2[0];
+  double cy = p0[1] - 2 * p1[1] + p2[1];
+
+  double xs[FLATTEN_BATCH];
+  double ys[FLATTEN_BATCH];
+  for (uint32_t i = 0; i < count; ++i) {
+    xs[i] = p0[0] + t[i] * (bx + t[i] * cx);
+    ys[i] = p0[1] + t[i] * (by + t[i] * cy);
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = Point {xs[i], ys[i]};
+  }
+}
+
+// How a quadratic maps onto the standard parabola, see `estimate_quad`
+struct QuadParams {
+  double a0;
+  double a2;
+  double u0;
+  double u_scale;
+
+  // Twice the number of lines needed, times the square root of the tolerance
+  double value;
+
+  // Whether the mapping exists, without it lines are spaced evenly
+  bool parabolic;
+};
+
+static QuadParams estimate_quad(Point p0, Point p1, Point p2, double sqrt_tolerance) {
+  QuadParams params = {0, 0, 0, 0, 0, false};
+
+  Point d01 = p1 - p0;
+  Point d12 = p2 - p1;
+  Point dd = d01 - d12;
+  double dd_len = std::sqrt(dd[0] * dd[0] + dd[1] * dd[1]);
+  double cross = (p2[0] - p0[0]) * dd[1] - (p2[1] - p0[1]) * dd[0];
+
+  // The ends of the curve on the parabola, and how much it is scaled
+  double x0 = (d01[0] * dd[0] + d01[1] * dd[1]) / cross;
+  double x2 = (d12[0] * dd[0] + d12[1] * dd[1]) / cross;
+  double scale = std::abs(cross / (dd_len * (x2 - x0)));
+
+  if (std::isfinite(x0) && std::isfinite(x2) && std::isfinite(scale) && scale > 0) {
+    params.parabolic = true;
+    params.a0 = approx_parabola_integral(x0);
+    params.a2 = approx_parabola_integral(x2);
+
+    double sqrt_scale = std::sqrt(scale);
+    if ((x0 < 0) == (x2 < 0)) {
+      params.value = std::abs(params.a2 - params.a0) * sqrt_scale;
+    } else {
+      // The vertex of the parabola is inside the curve, where the scale
+      // alone would undercount
+      double x_min = sqrt_tolerance / sqrt_scale;
+      params.value = sqrt_tolerance * std::abs(params.a2 - params.a0) / approx_parabola_integral(x_min);
+    }
+
+    params.u0 = approx_parabola_inv_integral(params.a0);
+    params.u_scale = 1 / (approx_parabola_inv_integral(params.a2) - params.u0);
+  } else {
+    // Straight or folded back on itself, where Wang's formula gives the
+    // number of evenly spaced lines
+    params.value = 2 * sqrt_tolerance * std::sqrt(dd_len / (4 * sqrt_tolerance * sqrt_tolerance));
+  }
+  return params;
+}
+
+// Returns the parameter at `u` of the way along the lines of the quadratic
+static double quad_subdiv_t(const QuadParams &params, double u) {
+  if (params.parabolic == false) return u;
+  double a = params.a0 + (params.a2 - params.a0) * u;
+  return (approx_parabola_inv_integral(a) - params.u0) * params.u_scale;
+}
+
+// Appends one line to each of the `count` points of the quadratic at `u`
+static void push_quad_lines(Point p0, Point p1, Point p2, const QuadParams &params, const double *u, uint32_t count, PathData *out) {
+  double t[FLATTEN_BATCH];
+  for (uint32_t k = 0; k < count; ++k) {
+    t[k] = quad_subdiv_t(params, u[k]);
+  }
+
+  uint32_t verb_base = out->verbs.len();
+  uint32_t point_base = out->points.len();
+  out->verbs.resize(verb_base + count);
+  out->points.resize(point_base + count);
+  std::fill(out->verbs.begin() + verb_base, out->verbs.end(), PATH_VERB_LINE);
+  eval_quad_batch(p0, p1, p2, t, count, out->points.begin() + point_base);
+}
+
+// Appends the lines of the quadratic from `p0` to `p2`. The path must
+// already have a subpath open at `p0`
+static void flatten_quad(Point p0, Point p1, Point p2, double sqrt_tolerance, PathData *out) {
+  QuadParams params = estimate_quad(p0, p1, p2, sqrt_tolerance);
+  uint32_t lines = line_count(0.5 * params.value / sqrt_tolerance);
+
+  double u[FLATTEN_BATCH];
+  double step = 1.0 / lines;
+  for (uint32_t i = 1; i < lines; i += FLATTEN_BATCH) {
+    uint32_t count = std::min(FLATTEN_BATCH, lines - i);
+    for (uint32_t k = 0; k < count; ++k) {
+      u[k] = (i + k) * step;
+    }
+    push_quad_lines(p0, p1, p2, params, u, count, out);
+  }
+
+  // The end is copied rather than evaluated so consecutive segments meet
+  out->verbs.push(PATH_VERB_LINE);
+  out->points.push(p2);
+}
+
+// Appends the lines of the cubic from `p0` to `p3`, by replacing it with
+// quadratics close enough to it and flattening those
+static void flatten_cubic(Point p0, Point p1, Point p2, Point p3, double tolerance, PathData *out) {
+  double quad_tolerance = tolerance * FLATTEN_QUAD_SHARE;
+  double sqrt_tolerance = std::sqrt(tolerance - quad_tolerance);
+
+  Point diff = (3 * p2 - p3) - (3 * p1 - p0);
+  double error = diff[0] * diff[0] + diff[1] * diff[1];
+  uint32_t quads = line_count(std::pow(error / (432 * quad_tolerance * quad_tolerance), 1.0 / 6));
+
+  // Every quadratic matches the cubic at its ends, in position and in
+  // direction. In power form the cubic is p0 + t (b + t (c + t d))
+  Point b = 3 * (p1 - p0);
+  Point c = 3 * (p0 - 2 * p1 + p2);
+  Point d = p3 - p0 + 3 * (p1 - p2);
+
+  double h = 1.0 / quads;
+  Point start = p0;
+  Point start_tangent = b * (h / 3);
+  for (uint32_t i = 1; i <= quads; ++i) {
+    double t = i * h;
+    Point end = i == quads ? p3 : p0 + t * (b + t * (c + t * d));
+    Point end_tangent = (b + t * (2 * c + 3 * t * d)) * (h / 3);
+
+    Point control = ((3 * (start + start_tangent) - start) + (3 * (end - end_tangent) - end)) / 4;
+    flatten_quad(start, control, end, sqrt_tolerance, out);
+
+    start = end;
+    start_tangent = end_tangent;
+  }
+}
+
+void flatten_path(const PathData &path, double tolerance, PathData *out) {
+  const Point *point = path.points.begin();
+  Point current = {0, 0};
+
+  for (PathVerb verb : path.verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        out->move_to(point[0]);
+        current = point[0];
+      } break;
+
+      case PATH_VERB_LINE: {
+        out->line_to(point[0]);
+        current = point[0];
+      } break;
+
+      case PATH_VERB_QUAD: {
+        flatten_quad(current, point[0], point[1], std::sqrt(tolerance), out);
+        current = point[1];
+      } break;
+
+      case PATH_VERB_CUBIC: {
+        flatten_cubic(current, point[0], point[1], point[2], tolerance, out);
+        current = point[2];
+      } break;
+
+      case PATH_VERB_CLOSE: {
+        out->close();
+      } break;
+
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      }
+    }
+    point += path_verb_points[verb];
+  }
+}
+
+// A run of points whose ends are kept, the ones between still to be decided
+struct SimplifySpan {
+  uint32_t first;
+  uint32_t last;
+};
+
+// Returns the squared distance from `p` to the segment from `a` to `b`
+static double segment_distance_sq(Point p, Point a, Point b) {
+  Point ab = b - a;
+  Point ap = p - a;
+  double len_sq = ab[0] * ab[0] + ab[1] * ab[1];
+  double t = len_sq > 0 ? std::clamp((ap[0] * ab[0] + ap[1] * ab[1]) / len_sq, 0.0, 1.0) : 0;
+  Point d = ap - t * ab;
+  return d[0] * d[0] + d[1] * d[1];
+}
+
+// Marks in `keep` the points of the polyline `points` that Douglas-Peucker
+// keeps at `tolerance`. A closed figure passes its first point again at the
+// end, the farthest point from it then splits the figure in two
+static void simplify_polyline(const ArrayList<Point> &points, double tolerance, ArrayList<uint8_t> *keep, ArrayList<SimplifySpan> *spans) {
+  double tolerance_sq = tolerance * tolerance;
+  uint32_t count = points.len();
+  keep->resize(count);
+  std::fill(keep->begin(), keep->end(), 0);
+  (*keep)[0] = 1;
+  (*keep)[count - 1] = 1;
+
+  spans->resize(0);
+  spans->push(SimplifySpan {0, count - 1});
+  while (spans->len()) {
+    SimplifySpan span = *spans->pop();
+    Point a = points[span.first];
+    Point b = points[span.last];
+
+    uint32_t farthest = 0;
+    double farthest_sq = tolerance_sq;
+    for (uint32_t i = span.first + 1; i < span.last; ++i) {
+      double distance_sq = segment_distance_sq(points[i], a, b);
+      if (distance_sq > farthest_sq) {
+        farthest = i;
+        farthest_sq = distance_sq;
+      }
+    }
+
+    if (farthest != 0) {
+      (*keep)[farthest] = 1;
+      spans->push(SimplifySpan {span.first, farthest});
+      spans->push(SimplifySpan {farthest, span.last});
+    }
+  }
+}
+
+void simplify_lines(const PathData &lines, double tolerance, PathData *out) {
+  ArrayList<Point> figure;
+  ArrayList<uint8_t> keep;
+  ArrayList<SimplifySpan> spans;
+
+  const Point *point = lines.points.begin();
+  const PathVerb *verb = lines.verbs.begin();
+  const PathVerb *verb_end = lines.verbs.end();
+  while (verb != verb_end) {
+    // Gathers one figure, from its move up to the next move
+    figure.resize(0);
+    bool closed = false;
+    do {
+      if (*verb == PATH_VERB_CLOSE) {
+        closed = true;
+      } else {
+        figure.push(point[0]);
+      }
+      point += path_verb_points[*verb];
+      ++verb;
+    } while (verb != verb_end && *verb != PATH_VERB_MOVE && closed == false);
+
+    Point start = figure[0];
+    uint32_t count = figure.len();
+    if (closed && (figure[count - 1][0] != start[0] || figure[count - 1][1] != start[1])) {
+      figure.push(start);
+    }
+    simplify_polyline(figure, tolerance, &keep, &spans);
+
+    out->move_to(start);
+    for (uint32_t i = 1; i < count; ++i) {
+      if (keep[i]) out->line_to(figure[i]);
+    }
+    if (closed) out->close();
+  }
+}
+
+int flatten_bucket(double scale) {
+  return (int)std::ceil(std::log2(scale) * FLATTEN_BUCKETS_PER_OCTAVE);
+}
+
+double flatten_bucket_scale(int bucket) {
+  return std::exp2((double)bucket / FLATTEN_BUCKETS_PER_OCTAVE);
+}
+
+FlattenCache::FlattenCache() :
+  current{0} {
+  this->invalidate();
+}
+
+bool FlattenCache::update(const PathData &path, double scale) {
+  int needed = flatten_bucket(scale);
+  if (this->levels[this->current].valid && this->levels[this->current].bucket == needed) {
+    return false;
+  }
+
+  // A kept bucket is reused, otherwise the slot of the bucket furthest from
+  // the scale is built again
+  uint32_t slot = 0;
+  int slot_distance = -1;
+  for (uint32_t i = 0; i < FLATTEN_CACHED_BUCKETS; ++i) {
+    const Level &level = this->levels[i];
+    if (level.valid && level.bucket == needed) {
+      this->current = i;
+      return true;
+    }
+
+    int distance = level.valid ? std::abs(level.bucket - needed) : INT_MAX;
+    if (distance > slot_distance) {
+      slot = i;
+      slot_distance = distance;
+    }
+  }
+
+  double tolerance = FLATTEN_TOLERANCE / flatten_bucket_scale(needed);
+  PathData flat;
+  flatten_path(path, tolerance * (1 - FLATTEN_SIMPLIFY_SHARE), &flat);
+
+  Level &level = this->levels[slot];
+  level.lines.clear();
+  simplify_lines(flat, tolerance * FLATTEN_SIMPLIFY_SHARE, &level.lines);
+  level.bucket = needed;
+  level.valid = true;
+  this->current = slot;
+  return true;
+}
+
+void FlattenCache::invalidate() {
+  for (Level &level : this->levels) {
+    level.valid = false;
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef FLATTEN_H
+#define FLATTEN_H
+
+#include <cstdint>
+
+#include "PathData.h"
+
+// How far, in device pixels, a flattened line may stray from its curve
+constexpr double FLATTEN_TOLERANCE = 0.25;
+
+// Zoom buckets are this many per doubling of the scale, so the tolerance of
+// each bucket is half the one of the bucket below
+constexpr int FLATTEN_BUCKETS_PER_OCTAVE = 1;
+
+// The share of the tolerance left to simplifying the flattened lines, the
+// rest is for flattening the curves
+constexpr double FLATTEN_SIMPLIFY_SHARE = 0.5;
+
+// How many buckets a cache keeps, zooming back to one of them reuses its
+// lines
+constexpr uint32_t FLATTEN_CACHED_BUCKETS = 4;
+
+// Appends `path` to `out` with every curve replaced by lines, none of which
+// is further than `tolerance` from the curve. Moves and closes are kept as
+// they are, so `out` has the same subpaths
+void flatten_path(const PathData &path, double tolerance, PathData *out);
+
+// Appends the lines of `lines`, a path of moves, lines and closes, to `out`
+// with the points dropped that Douglas-Peucker finds within `tolerance` of
+// the lines kept. Every subpath keeps its first point, so none disappears
+void simplify_lines(const PathData &lines, double tolerance, PathData *out);
+
+// Returns the zoom bucket of `scale`, the number of device pixels per unit
+int flatten_bucket(double scale);
+
+// Returns the largest scale of `bucket`, flattening for it is precise enough
+// for every scale in the bucket
+double flatten_bucket_scale(int bucket);
+
+// The flattened forms of one path, kept across frames. Each is built for a
+// zoom bucket, with the lines simplified down to what is visible at that
+// scale, so zoomed out documents draw a fraction of their points. Panning
+// never changes the scale, and zooming back to a bucket that is still kept
+// reuses its lines
+class FlattenCache {
+public:
+  FlattenCache();
+
+  // Makes `lines()` valid for `path` drawn at `scale`, returns whether they
+  // changed
+  bool update(const PathData &path, double scale);
+
+  // Forgets the lines, the next `update` rebuilds them
+  void invalidate();
+
+  const PathData &lines() const { return this->levels[this->current].lines; }
+private:
+  struct Level {
+    PathData lines;
+    int bucket;
+    bool valid;
+  };
+
+  Level levels[FLATTEN_CACHED_BUCKETS];
+  uint32_t current;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "GdiplusFragment.h"
 #include "Text.h"
 #include "Gradient.h"
+#include "Transform.h"
+#include "HitTest.h"
 
 #include <string_view>
 #include <cmath>
@@ -21,42 +23,16 @@ constexpr std::string_view genericfont_name[GENERIC_FONT_COUNT] = {
 
 constexpr InverseIndex<GENERIC_FONT_COUNT> inv_genericfont{&genericfont_name};
 
-static double apply_percent(double val, bool percent, double max_val, GradientUnits gradient_units) {
-  switch(gradient_units) {
-    case GRADIENT_UNIT_USER_SPACE_ON_USE: {
-      if (percent == true) {
-        return max_val / 100 * val;
-      }
-      return val;
-    } break;
-    case GRADIENT_UNIT_OBJECT_BOUNDING_BOX: {
-      if (percent == true) {
-        return val / 100;
-      }
-      return val;
-    }
-    case GRADIENT_UNIT_COUNT: {
-      __builtin_unreachable();
-    }
-  }
-}
-
-static void add_bezier_transformed(Gdiplus::GraphicsPath *path, BezierCurve curve, Transform matrix) {
-  Point start = matrix * curve.start;
-  Point end = matrix * curve.end;
-
-  Point control_start = matrix * curve.control_start;
-  Point control_end = matrix * curve.control_end;
-
+static void add_bezier(Gdiplus::GraphicsPath *path, const BezierCurve &curve) {
   path->AddBezier(
-    (Gdiplus::REAL)start[0],
-    (Gdiplus::REAL)start[1],
-    (Gdiplus::REAL)control_start[0],
-    (Gdiplus::REAL)control_start[1],
-    (Gdiplus::REAL)control_end[0],
-    (Gdiplus::REAL)control_end[1],
-    (Gdiplus::REAL)end[0],
-    (Gdiplus::REAL)end[1]
+    (Gdiplus::REAL)curve.start[0],
+    (Gdiplus::REAL)curve.start[1],
+    (Gdiplus::REAL)curve.control_start[0],
+    (Gdiplus::REAL)curve.control_start[1],
+    (Gdiplus::REAL)curve.control_end[0],
+    (Gdiplus::REAL)curve.control_end[1],
+    (Gdiplus::REAL)curve.end[0],
+    (Gdiplus::REAL)curve.end[1]
   );
 }
 
@@ -65,371 +41,253 @@ static double distance(Point p1, Point p2) {
   return std::hypot(d[0], d[1]);
 }
 
-static std::unique_ptr<const Gdiplus::Brush> paint_to_brush(Paint paint, double opacity, ParseResult *svg, const BaseShape *shape) {
-  GradientMap *gradient_map = &svg->gradient_map;
-  switch (paint.type) {
-    case PAINT_TRANSPARENT:
-      return nullptr;
-    case PAINT_RGB:
-      return std::make_unique<const Gdiplus::SolidBrush>(Gdiplus::Color{
-        (BYTE)(opacity * 255),
-        (BYTE)(paint.variants.rgb_paint.r * 255),
-        (BYTE)(paint.variants.rgb_paint.g * 255),
-        (BYTE)(paint.variants.rgb_paint.b * 255)
-      });
-    case PAINT_URL: {
-      std::string_view url {
-        paint.variants.url_paint.data,
-        (size_t)paint.variants.url_paint.len
-      };
+static Gdiplus::Color to_color(const DisplayColor &color) {
+  return Gdiplus::Color {
+    (BYTE)(color.a * 255),
+    (BYTE)(color.r * 255),
+    (BYTE)(color.g * 255),
+    (BYTE)(color.b * 255),
+  };
+}
 
-      while (url.size() > 1 && url[0] != '#') {
-        url = url.substr(1, url.size() - 2);
-      }
+// Creates the brush of the paint at `index` of `list` for an item painting
+// in `bounds`, or null for no paint
+static std::unique_ptr<const Gdiplus::Brush> paint_to_brush(const DisplayList *list, uint32_t index, const AABB &bounds) {
+  if (index == DISPLAY_NO_PAINT) return nullptr;
+
+  const DisplayPaint &paint = list->paints[index];
+  const DisplayStop *stops = list->stops.begin() + paint.stops.start;
+  int stop_count = (int)paint.stops.count;
+
+  // Gradient brushes end where their geometry does, so they are stretched
+  // far enough past the item that its padding color covers the rest
+  Point tmin = bounds.min;
+  Point tmax = bounds.max;
+  switch (paint.kind) {
+    case DISPLAY_PAINT_SOLID: {
+      return std::make_unique<const Gdiplus::SolidBrush>(to_color(paint.color));
+    } break;
 
-      if (url.size() <= 1 || url[0] != '#') return nullptr;
-      url = url.substr(1);
+    case DISPLAY_PAINT_LINEAR: {
+      Point p0 = paint.transform * paint.start;
+      Point p1 = paint.transform * paint.end;
 
-      GradientMap::iterator it = gradient_map->find(url);
-      if (it == gradient_map->end()) return nullptr;
+      double pad = tmax[0] - tmin[0] + tmax[1] - tmin[1];
+      Point d = p1 - p0;
+      double gap = std::hypot(d[0], d[1]);
 
-      Gradient *gradient = &it->second;
-      AABB size = shape->get_bounding();
+      Point min = p0 - pad * d / gap;
+      Point max = p1 + pad * d / gap;
 
-      double width = (size.max[0] - size.min[0]);
-      double height = (size.max[1] - size.min[1]);
+      double new_gap = gap + 2 * pad;
 
-      Point vertices[4] = {
-        shape->transform * Point {size.min[0], size.min[1]},
-        shape->transform * Point {size.min[0], size.max[1]},
-        shape->transform * Point {size.max[0], size.min[1]},
-        shape->transform * Point {size.max[0], size.max[1]},
+      Gdiplus::PointF start {
+        (Gdiplus::REAL)min[0],
+        (Gdiplus::REAL)min[1],
       };
 
-      Point tmax = vertices[0];
-      Point tmin = vertices[0];
+      Gdiplus::PointF end {
+        (Gdiplus::REAL)max[0],
+        (Gdiplus::REAL)max[1],
+      };
 
-      for (int i = 1; i < 4; ++i) {
-        tmin[0] = std::min(tmin[0], vertices[i][0]);
-        tmax[0] = std::max(tmax[0], vertices[i][0]);
-        tmin[1] = std::min(tmin[1], vertices[i][1]);
-        tmax[1] = std::max(tmax[1], vertices[i][1]);
-      }
-      switch (gradient->type) {
-        case GRADIENT_TYPE_LINEAR: {
-          Point p0 = {
-            apply_percent(gradient->variants.linear.x1.val, gradient->variants.linear.x1.percent, svg->root->width, gradient->gradient_units),
-            apply_percent(gradient->variants.linear.y1.val, gradient->variants.linear.y1.percent, svg->root->height, gradient->gradient_units),
-          };
-
-          Point p1 = {
-            apply_percent(gradient->variants.linear.x2.val, gradient->variants.linear.x2.percent, svg->root->width, gradient->gradient_units),
-            apply_percent(gradient->variants.linear.y2.val, gradient->variants.linear.y2.percent, svg->root->height, gradient->gradient_units),
-          };
-
-          p0 = gradient->transform * p0;
-          p1 = gradient->transform * p1;
-
-          if (gradient->gradient_units == GRADIENT_UNIT_OBJECT_BOUNDING_BOX) {
-            p0[0] = (size.min[0] + p0[0] * width);
-            p0[1] = (size.min[1] + p0[1] * height);
-
-            p1[0] = (size.min[0] + p1[0] * width);
-            p1[1] = (size.min[1] + p1[1] * height);
-          }
+      std::unique_ptr<Gdiplus::Color[]> colors = std::make_unique<Gdiplus::Color[]>(stop_count + 2);
+      std::unique_ptr<Gdiplus::REAL[]> blendPositions = std::make_unique<Gdiplus::REAL[]>(stop_count + 2);
 
-          p0 = shape->transform * p0;
-          p1 = shape->transform * p1;
+      colors[0] = to_color(stops[0].color);
+      blendPositions[0] = 0.0f;
 
-          double pad = tmax[0] - tmin[0] + tmax[1] - tmin[1];
-          Point d = p1 - p0;
-          double gap = std::hypot(d[0], d[1]);
+      for (int i = 0; i < stop_count; i++) {
+        colors[i + 1] = to_color(stops[i].color);
+        blendPositions[i + 1] = (Gdiplus::REAL)((stops[i].offset * gap + pad) / new_gap);
+      }
 
-          Point min = p0 - pad * d / gap;
-          Point max = p1 + pad * d / gap;
+      colors[stop_count + 1] = to_color(stops[stop_count - 1].color);
+      blendPositions[stop_count + 1] = 1.0f;
 
-          double new_gap = gap + 2 * pad;
+      stop_count += 2;
 
-          Gdiplus::PointF start {
-            (Gdiplus::REAL)min[0],
-            (Gdiplus::REAL)min[1],
-          };
+      std::unique_ptr<Gdiplus::LinearGradientBrush> brush = std::make_unique<Gdiplus::LinearGradientBrush>(
+        start,
+        end,
+        colors[0], 
+        colors[stop_count - 1]
+      );
 
-          Gdiplus::PointF end {
-            (Gdiplus::REAL)max[0],
-            (Gdiplus::REAL)max[1],
-          };
+      brush->SetInterpolationColors(colors.get(), blendPositions.get(), (INT)stop_count);
+      return brush;
+    } break;
 
-          size_t stop_count = gradient->stops.len();
+    case DISPLAY_PAINT_RADIAL: {
+      double cx = paint.start[0];
+      double cy = paint.start[1];
+      double r = paint.radius;
+
+      Point center = paint.transform * paint.start;
+      Point high = paint.transform * Point {cx, cy - r};
+      Point right = paint.transform * Point {cx + r, cy};
+      Point f = paint.transform * paint.end;
+
+      double height_out = 0, width_out = 0;
+      if (center[0] < tmin[0]) {
+        width_out = tmin[0] - center[0];
+      } else if (center[0] > tmax[0]) {
+        width_out = center[0] - tmax[0];
+      }
 
-          if (stop_count == 0) return nullptr;
+      if (center[1] < tmin[1]) {
+        height_out = tmin[1] - center[1];
+      } else if (center[1] > tmax[1]) {
+        height_out = center[1] - tmax[1];
+      }
 
-          std::unique_ptr<Gdiplus::Color[]> colors = std::make_unique<Gdiplus::Color[]>(stop_count + 2);
-          std::unique_ptr<Gdiplus::REAL[]> blendPositions = std::make_unique<Gdiplus::REAL[]>(stop_count + 2);
+      double max_r = height_out + width_out + tmax[1] - tmin[1] + tmax[0] - tmin[0];
+      double min_r = std::min(distance(high, center), distance(right, center));
+      double new_r = r * max_r / min_r;
+
+      Point brush_point[12];
+      brush_point[0] = {cx - new_r, cy};
+      brush_point[3] = {cx, cy + new_r};
+      brush_point[6] = {cx + new_r, cy};
+      brush_point[9] = {cx, cy - new_r};
+      brush_point[1] = brush_point[0] + Point{new_r * KX, new_r * KY};
+      brush_point[2] = brush_point[3] - Point{new_r * KY, new_r * KX};
+      brush_point[4] = brush_point[3] + Point{new_r * KY, -new_r * KX};
+      brush_point[5] = brush_point[6] - Point{new_r * KX, -new_r * KY};
+      brush_point[7] = brush_point[6] + Point{-new_r * KX, -new_r * KY};
+      brush_point[8] = brush_point[9] - Point{-new_r * KY, -new_r * KX};
+      brush_point[10] = brush_point[9] + Point{-new_r * KY, new_r * KX};
+      brush_point[11] = brush_point[0] - Point{-new_r * KX, new_r * KY};
+
+      transform_points(paint.transform, brush_point, brush_point, 12);
+
+      BezierCurve brush_curve[4] = {
+        BezierCurve{brush_point[0], brush_point[3], brush_point[1], brush_point[2]},
+        BezierCurve{brush_point[3], brush_point[6], brush_point[4], brush_point[5]},
+        BezierCurve{brush_point[6], brush_point[9], brush_point[7], brush_point[8]},
+        BezierCurve{brush_point[9], brush_point[0], brush_point[10], brush_point[11]}
+      };
 
-          colors[0] = Gdiplus::Color {
-            (BYTE)(gradient->stops[0].stop_opacity * opacity * 255),
-            (BYTE)(gradient->stops[0].stop_color.r * 255),
-            (BYTE)(gradient->stops[0].stop_color.g * 255),
-            (BYTE)(gradient->stops[0].stop_color.b * 255),
-          };
-          blendPositions[0] = 0.0f;
+      Gdiplus::GraphicsPath path;
+      for (size_t i = 0; i < 4; ++i) {
+        add_bezier(&path, brush_curve[i]);
+      }
+      std::unique_ptr<Gdiplus::PathGradientBrush> brush = std::make_unique<Gdiplus::PathGradientBrush>(&path);
+      brush->SetCenterPoint(Gdiplus::PointF{(Gdiplus::REAL)f[0], (Gdiplus::REAL)f[1]});
 
-          for (size_t i = 0; i < stop_count; i++) {
-            colors[i + 1] = Gdiplus::Color{
-              (BYTE)(gradient->stops[i].stop_opacity * opacity * 255),
-              (BYTE)(gradient->stops[i].stop_color.r * 255),
-              (BYTE)(gradient->stops[i].stop_color.g * 255),
-              (BYTE)(gradient->stops[i].stop_color.b * 255),
-            };
-            blendPositions[i + 1] = (Gdiplus::REAL)((gradient->stops[i].offset * gap + pad) / new_gap);
-          }
+      std::deque<Gdiplus::Color> colors;
+      std::deque<Gdiplus::REAL> iter_positions;
 
-          colors[stop_count + 1] = Gdiplus::Color{
-            (BYTE)(gradient->stops[stop_count - 1].stop_opacity * opacity * 255),
-            (BYTE)(gradient->stops[stop_count - 1].stop_color.r * 255),
-            (BYTE)(gradient->stops[stop_count - 1].stop_color.g * 255),
-            (BYTE)(gradient->stops[stop_count - 1].stop_color.b * 255),
-          };
-          blendPositions[stop_count + 1] = 1.0f;
-
-          stop_count += 2;
-
-          std::unique_ptr<Gdiplus::LinearGradientBrush> brush = std::make_unique<Gdiplus::LinearGradientBrush>(
-            start,
-            end,
-            colors[0], 
-            colors[stop_count - 1]
-          );
+      for (int i = 0; i < stop_count; ++i) {
+        colors.emplace_back(to_color(stops[stop_count - i - 1].color));
+        iter_positions.emplace_back((Gdiplus::REAL)((1 - ((stops[stop_count - i - 1].offset) * min_r / max_r))));
+      }
 
-          brush->SetInterpolationColors(colors.get(), blendPositions.get(), (INT)stop_count);
-          return brush;
-        } break;
-        case GRADIENT_TYPE_RADIAL: {
-          int stop_count = gradient->stops.len();
-          RadialGradient radial_grad = gradient->variants.radial;
-          PercentUnit p_fx = radial_grad.fx || radial_grad.cx;
-          PercentUnit p_fy = radial_grad.fy || radial_grad.cy;
-
-          double fx = apply_percent(p_fx.val, p_fx.percent, width, gradient->gradient_units);
-          double fy = apply_percent(p_fy.val, p_fy.percent, height, gradient->gradient_units);
-          double cx = apply_percent(radial_grad.cx.val, radial_grad.cx.percent, width, gradient->gradient_units);
-          double cy = apply_percent(radial_grad.cy.val, radial_grad.cy.percent, height, gradient->gradient_units);
-          double r = apply_percent(radial_grad.r.val, radial_grad.r.percent, width, gradient->gradient_units);
-          Point f = {fx, fy};
-
-          Point center = {cx, cy};
-          Point high = {cx, cy - r};
-          Point right = {cx + r, cy};
-
-          center = gradient->transform * center;
-          high = gradient->transform * high;
-          right = gradient->transform * right;
-          f = gradient->transform * f;
-
-          if (gradient->gradient_units == GRADIENT_UNIT_OBJECT_BOUNDING_BOX) {
-            center[0] = (size.min[0] + center[0] * width);
-            center[1] = (size.min[1] + center[1] * height);
-            high[0] = (size.min[0] + high[0] * width);
-            high[1] = (size.min[1] + high[1] * height);
-            right[0] = (size.min[0] + right[0] * width);
-            right[1] = (size.min[1] + right[1] * height);
-            f[0] = (size.min[0] + f[0] * width);
-            f[1] = (size.min[1] + f[1] * height);
-          }
+      if (colors.size() == 0) return nullptr;
 
-          center = shape->transform * center;
-          high = shape->transform * high;
-          right = shape->transform * right;
-          f = shape->transform * f;
+      SpreadMethod method = (colors.size() > 1) ? paint.spread : SPREAD_METHOD_PAD;
 
-          double height_out = 0, width_out = 0;
-          if (center[0] < tmin[0]) {
-            width_out = tmin[0] - center[0];
-          } else if (center[0] > tmax[0]) {
-            width_out = center[0] - tmax[0];
-          }
+      switch (method) {
+        case SPREAD_METHOD_PAD: {
+          iter_positions.emplace_front(0);
+          colors.emplace_front(to_color(stops[stop_count - 1].color));
 
-          if (center[1] < tmin[1]) {
-            height_out = tmin[1] - center[1];
-          } else if (center[1] > tmax[1]) {
-            height_out = center[1] - tmax[1];
-          }
+          colors.emplace_back(to_color(stops[0].color));
 
-          double max_r = height_out + width_out + tmax[1] - tmin[1] + tmax[0] - tmin[0];
-          double min_r = std::min(distance(high, center), distance(right, center));
-          double new_r = r * max_r / min_r;
-
-          Point brush_point[12];
-          brush_point[0] = {cx - new_r, cy};
-          brush_point[3] = {cx, cy + new_r};
-          brush_point[6] = {cx + new_r, cy};
-          brush_point[9] = {cx, cy - new_r};
-          brush_point[1] = brush_point[0] + Point{new_r * KX, new_r * KY};
-          brush_point[2] = brush_point[3] - Point{new_r * KY, new_r * KX};
-          brush_point[4] = brush_point[3] + Point{new_r * KY, -new_r * KX};
-          brush_point[5] = brush_point[6] - Point{new_r * KX, -new_r * KY};
-          brush_point[7] = brush_point[6] + Point{-new_r * KX, -new_r * KY};
-          brush_point[8] = brush_point[9] - Point{-new_r * KY, -new_r * KX};
-          brush_point[10] = brush_point[9] + Point{-new_r * KY, new_r * KX};
-          brush_point[11] = brush_point[0] - Point{-new_r * KX, new_r * KY};
-
-          for (size_t i = 0; i < 12; ++i) {
-            brush_point[i] = gradient->transform * brush_point[i];
-          }
+          iter_positions.emplace_back(1);
+        } break;
 
-           if (gradient->gradient_units == GRADIENT_UNIT_OBJECT_BOUNDING_BOX) {
-             for (size_t i = 0; i < 12; ++i) {
-               brush_point[i][0] = (size.min[0] + brush_point[i][0] * width);
-               brush_point[i][1] = (size.min[1] + brush_point[i][1] * height);
-             }
-           }
-
-          BezierCurve brush_curve[4] = {
-            BezierCurve{brush_point[0], brush_point[3], brush_point[1], brush_point[2]},
-            BezierCurve{brush_point[3], brush_point[6], brush_point[4], brush_point[5]},
-            BezierCurve{brush_point[6], brush_point[9], brush_point[7], brush_point[8]},
-            BezierCurve{brush_point[9], brush_point[0], brush_point[10], brush_point[11]}
-          };
-
-          Gdiplus::GraphicsPath path;
-          for (size_t i = 0; i < 4; ++i) {
-            add_bezier_transformed(&path, brush_curve[i], shape->transform);
+        case SPREAD_METHOD_REFLECT: {
+          while (iter_positions.back() < 1) {
+            Gdiplus::REAL *last_pos = &iter_positions.back();
+            colors.emplace_back(colors[stop_count - 1]);
+            iter_positions.emplace_back(*last_pos);
+            for (int i = 1; i < stop_count; ++i) {
+              colors.emplace_back(colors[stop_count - i - 1]);
+              iter_positions.emplace_back(*last_pos + iter_positions[stop_count - 1] - iter_positions[stop_count - i - 1]);
+
+              if (iter_positions.back() > 1) {
+                iter_positions.back() = 1;
+                break;
+              }
+            }
           }
-          std::unique_ptr<Gdiplus::PathGradientBrush> brush = std::make_unique<Gdiplus::PathGradientBrush>(&path);
-          brush->SetCenterPoint(Gdiplus::PointF{(Gdiplus::REAL)f[0], (Gdiplus::REAL)f[1]});
-
-          std::deque<Gdiplus::Color> colors;
-          std::deque<Gdiplus::REAL> iter_positions;
-
-          for (int i = 0; i < stop_count; ++i) {
-            colors.emplace_back(Gdiplus::Color {
-              (BYTE)(gradient->stops[stop_count - i - 1].stop_opacity * opacity * 255),
-              (BYTE)(gradient->stops[stop_count - i - 1].stop_color.r * 255),
-              (BYTE)(gradient->stops[stop_count - i - 1].stop_color.g * 255),
-              (BYTE)(gradient->stops[stop_count - i - 1].stop_color.b * 255),
-            });
 
-            iter_positions.emplace_back((Gdiplus::REAL)((1 - ((gradient->stops[stop_count - i - 1].offset) * min_r / max_r))));
+          while (iter_positions.front() > 0) {
+            int first = 0;
+            Gdiplus::REAL *last_pos = &iter_positions.front();
+            colors.emplace_front(colors[first]);
+            iter_positions.emplace_front(*last_pos);
+            ++first;
+
+            for (int i = 1; i < stop_count; ++i) {
+              colors.emplace_front(colors[first + i]);
+              iter_positions.emplace_front(*last_pos + iter_positions[0] - iter_positions[first + i]);
+              ++first;
+
+              if (iter_positions.front() < 0) {
+                iter_positions.front() = 0;
+                break;
+              }
+            }
           }
+        } break;
 
-          if (colors.size() == 0) return nullptr;
-
-          SpreadMethod method = (colors.size() > 1) ? gradient->spread_method : SPREAD_METHOD_PAD;
-
-          switch (method) {
-            case SPREAD_METHOD_PAD: {
-              iter_positions.emplace_front(0);
-              colors.emplace_front(Gdiplus::Color {
-                (BYTE)(gradient->stops[stop_count - 1].stop_opacity * opacity * 255),
-                (BYTE)(gradient->stops[stop_count - 1].stop_color.r * 255),
-                (BYTE)(gradient->stops[stop_count - 1].stop_color.g * 255),
-                (BYTE)(gradient->stops[stop_count - 1].stop_color.b * 255),
-              });
-
-              colors.emplace_back(Gdiplus::Color {
-                (BYTE)(gradient->stops[0].stop_opacity * opacity * 255),
-                (BYTE)(gradient->stops[0].stop_color.r * 255),
-                (BYTE)(gradient->stops[0].stop_color.g * 255),
-                (BYTE)(gradient->stops[0].stop_color.b * 255),
-              });
-
-              iter_positions.emplace_back(1);
-            } break;
-
-            case SPREAD_METHOD_REFLECT: {
-              while (iter_positions.back() < 1) {
-                Gdiplus::REAL *last_pos = &iter_positions.back();
-                colors.emplace_back(colors[stop_count - 1]);
-                iter_positions.emplace_back(*last_pos);
-                for (int i = 1; i < stop_count; ++i) {
-                  colors.emplace_back(colors[stop_count - i - 1]);
-                  iter_positions.emplace_back(*last_pos + iter_positions[stop_count - 1] - iter_positions[stop_count - i - 1]);
-
-                  if (iter_positions.back() > 1) {
-                    iter_positions.back() = 1;
-                    break;
-                  }
-                }
+        case SPREAD_METHOD_REPEAT: {
+          while (iter_positions.back() < 1) {
+            Gdiplus::REAL *last_pos = &iter_positions.back();
+            colors.emplace_back(colors[0]);
+            iter_positions.emplace_back(*last_pos);
+            for (int i = 1; i < stop_count; ++i) {
+              colors.emplace_back(colors[i]);
+              iter_positions.emplace_back(*last_pos + iter_positions[i] - iter_positions[0]);
+
+              if (iter_positions.back() > 1) {
+                iter_positions.back() = 1;
+                break;
               }
+            }
+          }
 
-              while (iter_positions.front() > 0) {
-                int first = 0;
-                Gdiplus::REAL *last_pos = &iter_positions.front();
-                colors.emplace_front(colors[first]);
-                iter_positions.emplace_front(*last_pos);
-                ++first;
-
-                for (int i = 1; i < stop_count; ++i) {
-                  colors.emplace_front(colors[first + i]);
-                  iter_positions.emplace_front(*last_pos + iter_positions[0] - iter_positions[first + i]);
-                  ++first;
-
-                  if (iter_positions.front() < 0) {
-                    iter_positions.front() = 0;
-                    break;
-                  }
-                }
-              }
-            } break;
-
-            case SPREAD_METHOD_REPEAT: {
-              while (iter_positions.back() < 1) {
-                Gdiplus::REAL *last_pos = &iter_positions.back();
-                colors.emplace_back(colors[0]);
-                iter_positions.emplace_back(*last_pos);
-                for (int i = 1; i < stop_count; ++i) {
-                  colors.emplace_back(colors[i]);
-                  iter_positions.emplace_back(*last_pos + iter_positions[i] - iter_positions[0]);
-
-                  if (iter_positions.back() > 1) {
-                    iter_positions.back() = 1;
-                    break;
-                  }
-                }
+          while (iter_positions.front() > 0) {
+            int first = 0;
+            Gdiplus::REAL *last_pos = &iter_positions.front();
+            colors.emplace_front(colors[first + stop_count - 1]);
+            iter_positions.emplace_front(*last_pos);
+            ++first;
+
+            for (int i = 1; i < stop_count; ++i) {
+              colors.emplace_front(colors[first + stop_count - i - 1]);
+              iter_positions.emplace_front(*last_pos + iter_positions[first + stop_count - i - 1] - iter_positions[first + stop_count - 1]);
+              ++first;
+
+              if (iter_positions.front() < 0) {
+                iter_positions.front() = 0;
+                break;
               }
+            }
+          }
+        } break;
 
-              while (iter_positions.front() > 0) {
-                int first = 0;
-                Gdiplus::REAL *last_pos = &iter_positions.front();
-                colors.emplace_front(colors[first + stop_count - 1]);
-                iter_positions.emplace_front(*last_pos);
-                ++first;
-
-                for (int i = 1; i < stop_count; ++i) {
-                  colors.emplace_front(colors[first + stop_count - i - 1]);
-                  iter_positions.emplace_front(*last_pos + iter_positions[first + stop_count - i - 1] - iter_positions[first + stop_count - 1]);
-                  ++first;
-
-                  if (iter_positions.front() < 0) {
-                    iter_positions.front() = 0;
-                    break;
-                  }
-                }
-              }
-            } break;
+        case SPREAD_METHOD_COUNT: {
+          __builtin_unreachable();
+        };
+      }
 
-            case SPREAD_METHOD_COUNT: {
-              __builtin_unreachable();
-            };
-          }
+      int size = colors.size();
 
-          int size = colors.size();
+      std::unique_ptr<Gdiplus::Color[]> colors_ptr = std::make_unique<Gdiplus::Color[]>(size);
+      std::unique_ptr<Gdiplus::REAL[]> positions_ptr = std::make_unique<Gdiplus::REAL[]>(size);
 
-          std::unique_ptr<Gdiplus::Color[]> colors_ptr = std::make_unique<Gdiplus::Color[]>(size);
-          std::unique_ptr<Gdiplus::REAL[]> positions_ptr = std::make_unique<Gdiplus::REAL[]>(size);
+      std::copy(colors.begin(), colors.end(), colors_ptr.get());
+      std::copy(iter_positions.begin(), iter_positions.end(), positions_ptr.get());
 
-          std::copy(colors.begin(), colors.end(), colors_ptr.get());
-          std::copy(iter_positions.begin(), iter_positions.end(), positions_ptr.get());
+      brush->SetInterpolationColors(colors_ptr.get(), positions_ptr.get(), (INT)size);
+      return brush;
+    } break;
 
-          brush->SetInterpolationColors(colors_ptr.get(), positions_ptr.get(), (INT)size);
-          return brush;
-        } break;
-        case GRADIENT_TYPE_COUNT: {
-          __builtin_unreachable();
-        } break;
-      }
-      return nullptr;
+    case DISPLAY_PAINT_COUNT: {
+      __builtin_unreachable();
     }
   }
 }
@@ -445,8 +303,57 @@ static Gdiplus::FillMode get_gdiplus_fillmode(FillRule fillrule) {
   }
 }
 
-static double det(Transform transform) {
-  return transform.m[0][0] * transform.m[1][1] - transform.m[0][1] * transform.m[1][0];
+// Sets up `pen` to outline with `stroke`
+static void set_pen_stroke(Gdiplus::Pen *pen, const DisplayStroke &stroke) {
+  pen->SetWidth((Gdiplus::REAL)stroke.width);
+
+  switch (stroke.join) {
+    case LINE_JOIN_ARCS: {
+      pen->SetLineJoin(Gdiplus::LineJoinMiter);
+    } break;
+    case LINE_JOIN_BEVEL: {
+      pen->SetLineJoin(Gdiplus::LineJoinBevel);
+    } break;
+    case LINE_JOIN_MITER: {
+      pen->SetLineJoin(Gdiplus::LineJoinMiter);
+    } break;
+    case LINE_JOIN_MITER_CLIP: {
+      pen->SetLineJoin(Gdiplus::LineJoinMiterClipped);
+    } break;
+    case LINE_JOIN_ROUND: {
+      pen->SetLineJoin(Gdiplus::LineJoinRound);
+    } break;
+    case LINE_JOIN_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+
+  switch (stroke.cap) {
+    case LINE_CAP_BUTT: {
+      pen->SetStartCap(Gdiplus::LineCapFlat);
+      pen->SetEndCap(Gdiplus::LineCapFlat);
+    } break;
+    case LINE_CAP_ROUND: {
+      pen->SetStartCap(Gdiplus::LineCapRound);
+      pen->SetEndCap(Gdiplus::LineCapRound);
+    } break;
+    case LINE_CAP_SQUARE: {
+      pen->SetStartCap(Gdiplus::LineCapSquare);
+      pen->SetEndCap(Gdiplus::LineCapSquare);
+    } break;
+    case LINE_CAP_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+
+  // GDI+ measures dashes in pen widths
+  pen->SetDashOffset((Gdiplus::REAL)(stroke.dash_offset / stroke.width));
+  Gdiplus::REAL dasharray[8];
+  for (int i = 0; i < stroke.dash_count; i++) {
+    dasharray[i] = (Gdiplus::REAL)(stroke.dash_array[i] / stroke.width);
+  }
+  pen->SetDashPattern(dasharray, stroke.dash_count);
+  pen->SetMiterLimit((Gdiplus::REAL)stroke.miter_limit);
 }
 
 std::wstring string_to_wide_string(std::string_view string) {
@@ -459,28 +366,34 @@ std::wstring string_to_wide_string(std::string_view string) {
   return result;
 }
 
-GdiplusFragment::GdiplusFragment(const BaseShape *shape, ParseResult *svg) :
-  fill_brush{paint_to_brush(shape->fill, shape->fill_opacity * shape->opacity, svg, shape)},
-  stroke_brush{paint_to_brush(shape->stroke, shape->stroke_opacity * shape->opacity, svg, shape)},
-  pen{
-    this->stroke_brush.get(),
-    (Gdiplus::REAL)(shape->stroke_width * (std::sqrt(det(shape->transform)))),
-  },
-  path {get_gdiplus_fillmode(shape->fill_rule)} {
-  if (const SVGShapes::Text *text = dynamic_cast<const SVGShapes::Text*>(shape)) {
-    std::wstring str = string_to_wide_string(text->content);
+GdiplusFragment::GdiplusFragment(const DisplayList *list, const DisplayItem &item) :
+  fill_brush{paint_to_brush(list, item.fill, item.bounds)},
+  stroke_brush{paint_to_brush(list, item.stroke, item.bounds)},
+  pen{this->stroke_brush.get(), 0},
+  path {get_gdiplus_fillmode(item.fill_rule)},
+  fill_mode {get_gdiplus_fillmode(item.fill_rule)},
+  fill_rule {item.fill_rule},
+  is_text {item.kind == DISPLAY_ITEM_TEXT},
+  world_bounds {item.bounds} {
+  if (item.stroke != DISPLAY_NO_PAINT) {
+    set_pen_stroke(&this->pen, list->strokes[item.stroke_style]);
+  }
+
+  if (this->is_text) {
+    const DisplayText &text = list->texts[item.text];
+    std::wstring str = string_to_wide_string(text.content);
 
     int font_style;
-    switch (text->font_style) {
+    switch (text.font_style) {
       case FONTSTYLE_NORMAL: {
-        if (text->font_weight >= 500) font_style = Gdiplus::FontStyleBold;
+        if (text.font_weight >= 500) font_style = Gdiplus::FontStyleBold;
         else font_style = Gdiplus::FontStyleRegular;
 
       } break;
 
       case FONTSTYLE_ITALIC:
       case FONTSTYLE_OBLIQUE: {
-        if (text->font_weight >= 500) font_style = Gdiplus::FontStyleBoldItalic;
+        if (text.font_weight >= 500) font_style = Gdiplus::FontStyleBoldItalic;
         else font_style = Gdiplus::FontStyleItalic;
       } break;
 
@@ -490,13 +403,13 @@ GdiplusFragment::GdiplusFragment(const BaseShape *shape, ParseResult *svg) :
     }
 
     Gdiplus::PointF origin{
-      (Gdiplus::REAL)(text->pos[0] + text->d[0]), 
-      (Gdiplus::REAL)(text->pos[1] + text->d[1] - text->font_size)
+      (Gdiplus::REAL)text.origin[0],
+      (Gdiplus::REAL)(text.origin[1] - text.font_size)
     };
 
     Gdiplus::StringFormat format;
     
-    switch (text->text_anchor) {
+    switch (text.anchor) {
       case TEXTANCHOR_START: {
         format.SetAlignment(Gdiplus::StringAlignmentNear);
       } break;
@@ -512,7 +425,7 @@ GdiplusFragment::GdiplusFragment(const BaseShape *shape, ParseResult *svg) :
     }
 
     bool set_font_family = false;
-    std::string_view tmp_font_family = text->font_family;
+    std::string_view tmp_font_family = text.font_family;
     
     while (tmp_font_family.size() > 0) {
       size_t pos = (tmp_font_family).find(',');
@@ -535,7 +448,7 @@ GdiplusFragment::GdiplusFragment(const BaseShape *shape, ParseResult *svg) :
             (INT)(str.length()), 
             &family,
             font_style,
-            (Gdiplus::REAL) text->font_size,
+            (Gdiplus::REAL) text.font_size,
             origin,
             &format
           );
@@ -563,7 +476,7 @@ GdiplusFragment::GdiplusFragment(const BaseShape *shape, ParseResult *svg) :
           (INT)(str.length()), 
           family,
           font_style,
-          (Gdiplus::REAL) text->font_size,
+          (Gdiplus::REAL) text.font_size,
           origin,
           &format
         );
@@ -577,112 +490,121 @@ GdiplusFragment::GdiplusFragment(const BaseShape *shape, ParseResult *svg) :
         (INT)(str.length()), 
         Gdiplus::FontFamily::GenericSerif(),
         font_style,
-        (Gdiplus::REAL) text->font_size,
+        (Gdiplus::REAL) text.font_size,
         origin,
         &format
       );
     }
 
     Gdiplus::Matrix matrix {
-      (Gdiplus::REAL)shape->transform.m[0][0],
-      (Gdiplus::REAL)shape->transform.m[1][0],
-      (Gdiplus::REAL)shape->transform.m[0][1],
-      (Gdiplus::REAL)shape->transform.m[1][1],
-      (Gdiplus::REAL)shape->transform.d[0],
-      (Gdiplus::REAL)shape->transform.d[1]
+      (Gdiplus::REAL)text.transform.m[0][0],
+      (Gdiplus::REAL)text.transform.m[1][0],
+      (Gdiplus::REAL)text.transform.m[0][1],
+      (Gdiplus::REAL)text.transform.m[1][1],
+      (Gdiplus::REAL)text.transform.d[0],
+      (Gdiplus::REAL)text.transform.d[1]
     };
     this->path.Transform(&matrix);
-  } else {
-    ArrayList<BezierCurve> beziers = shape->get_beziers();
 
-    if (beziers.len()) {
-      add_bezier_transformed(&this->path, beziers[0], shape->transform);
+    // The glyphs are only known now, their bounds replace the estimate
+    Gdiplus::RectF rect;
+    this->path.GetBounds(&rect);
+    this->world_bounds = AABB {
+      Point {rect.X, rect.Y},
+      Point {rect.X + rect.Width, rect.Y + rect.Height},
+    };
 
-      Point first_point = beziers[0].start;
-      Point last_point = beziers[0].end;
+    // A stroke reaches half its width past the outline, or further at
+    // miter joins and square caps
+    if (item.stroke != DISPLAY_NO_PAINT) {
+      const DisplayStroke &stroke = list->strokes[item.stroke_style];
+      double reach = stroke.width / 2 * std::max(stroke.miter_limit, std::sqrt(2.0));
+      this->world_bounds.min = this->world_bounds.min - Point {reach, reach};
+      this->world_bounds.max = this->world_bounds.max + Point {reach, reach};
+    }
+  } else {
+    // The curves are flattened for the scale they are drawn at, so the
+    // path is kept in world space and only turned into lines when rendered
+    this->world_path.verbs.extend(list->verbs.begin() + item.geometry.verbs.start, item.geometry.verbs.count);
+    this->world_path.points.extend(list->points.begin() + item.geometry.points.start, item.geometry.points.count);
+  }
+}
 
-      for (uint32_t i = 1; i < beziers.len() - 1; ++i){
-        BezierCurve curve = beziers[i];
+void GdiplusFragment::build_lines() {
+  this->path.Reset();
+  this->path.SetFillMode(this->fill_mode);
 
-        if (last_point[0] != curve.start[0] ||
-          last_point[1] != curve.start[1]) {
-          this->path.StartFigure();
-        }
+  const PathData &lines = this->flatten.lines();
+  const Point *point = lines.points.begin();
+  this->figure.resize(0);
 
-        add_bezier_transformed(&this->path, curve, shape->transform);
+  for (PathVerb verb : lines.verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        this->add_figure(false);
+        this->figure.push(Gdiplus::PointF {(Gdiplus::REAL)point[0][0], (Gdiplus::REAL)point[0][1]});
+      } break;
 
-        last_point = curve.end;
-      }
-      BezierCurve curve = beziers[beziers.len() - 1];
-      Point mid = (last_point + first_point) / 2; 
+      case PATH_VERB_LINE: {
+        this->figure.push(Gdiplus::PointF {(Gdiplus::REAL)point[0][0], (Gdiplus::REAL)point[0][1]});
+      } break;
 
-      if (curve.start[0] == last_point[0] && curve.start[1] == last_point[1]
-        && curve.end[0] == first_point[0] && curve.end[1] == first_point[1] 
-        && curve.control_end[0] == mid[0] && curve.control_end[1] == mid[1]) {
-        this->path.CloseFigure();
-      } else {
-        if (last_point[0] != curve.start[0] ||
-          last_point[1] != curve.start[1]) {
-          this->path.StartFigure();
-        }
+      case PATH_VERB_CLOSE: {
+        this->add_figure(true);
+      } break;
 
-        add_bezier_transformed(&this->path, curve, shape->transform);
+      case PATH_VERB_QUAD:
+      case PATH_VERB_CUBIC:
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
       }
     }
+    point += path_verb_points[verb];
   }
+  this->add_figure(false);
+}
 
-  switch ((StrokeLineJoin)shape->stroke_line_join) {
-    case LINE_JOIN_ARCS: {
-      this->pen.SetLineJoin(Gdiplus::LineJoinMiter);
-    } break;
-    case LINE_JOIN_BEVEL: {
-      this->pen.SetLineJoin(Gdiplus::LineJoinBevel);
-    } break;
-    case LINE_JOIN_MITER: {
-      this->pen.SetLineJoin(Gdiplus::LineJoinMiter);
-    } break;
-    case LINE_JOIN_MITER_CLIP: {
-      this->pen.SetLineJoin(Gdiplus::LineJoinMiterClipped);
-    } break;
-    case LINE_JOIN_ROUND: {
-      this->pen.SetLineJoin(Gdiplus::LineJoinRound);
-    } break;
-    case LINE_JOIN_COUNT: {
-      __builtin_unreachable();
-    } break;
-  }
-
-  switch ((StrokeLineCap)(shape->stroke_line_cap)) {
-    case LINE_CAP_BUTT: {
-      this->pen.SetStartCap(Gdiplus::LineCapFlat);
-      this->pen.SetEndCap(Gdiplus::LineCapFlat);
-    } break;
-    case LINE_CAP_ROUND: {
-      this->pen.SetStartCap(Gdiplus::LineCapRound);
-      this->pen.SetEndCap(Gdiplus::LineCapRound);
-    } break;
-    case LINE_CAP_SQUARE: {
-      this->pen.SetStartCap(Gdiplus::LineCapSquare);
-      this->pen.SetEndCap(Gdiplus::LineCapSquare);
-    } break;
-    case LINE_CAP_COUNT: {
-      __builtin_unreachable();
-    } break;
+void GdiplusFragment::add_figure(bool closed) {
+  if (this->figure.len() > 1) {
+    this->path.StartFigure();
+    this->path.AddLines(this->figure.begin(), (INT)this->figure.len());
+    if (closed) this->path.CloseFigure();
   }
+  this->figure.resize(0);
+}
 
-  this->pen.SetDashOffset((Gdiplus::REAL)shape->stroke_dash_offset);
-  Gdiplus::REAL dasharray[8];
-  for (int i = 0; i < shape->stroke_dash_count; i++) {
-    dasharray[i] = shape->stroke_dash_array[i];
+void GdiplusFragment::render(Gdiplus::Graphics *graphics, double scale) {
+  if (this->is_text == false && this->flatten.update(this->world_path, scale)) {
+    this->build_lines();
   }
-  this->pen.SetDashPattern(dasharray, shape->stroke_dash_count);
-  this->pen.SetMiterLimit((Gdiplus::REAL)shape->miter_limit);
-}
 
-void GdiplusFragment::render(Gdiplus::Graphics *graphics) {
   if (this->fill_brush) {
     graphics->FillPath(this->fill_brush.get(), &this->path);
   }
   if (this->pen.GetWidth() > 0)
   graphics->DrawPath(&this->pen, &this->path);
 }
+
+bool GdiplusFragment::hit(Point p, double tolerance) const {
+  const AABB &box = this->world_bounds;
+  if (p[0] < box.min[0] || p[0] > box.max[0] || p[1] < box.min[1] || p[1] > box.max[1]) return false;
+  if (this->is_text) return true;
+
+  if (this->fill_brush && path_fill_contains(this->world_path, this->fill_rule, p)) return true;
+
+  double radius = this->stroke_brush ? this->pen.GetWidth() / 2 : 0;
+  return radius > 0 && path_stroke_contains(this->world_path, radius, tolerance, p);
+}
+
+bool GdiplusFragment::touches(const AABB &area, double tolerance) const {
+  const AABB &box = this->world_bounds;
+  if (area.max[0] < box.min[0] || box.max[0] < area.min[0]) return false;
+  if (area.max[1] < box.min[1] || box.max[1] < area.min[1]) return false;
+  if (this->is_text) return true;
+
+  double radius = this->stroke_brush ? this->pen.GetWidth() / 2 : 0;
+  if (this->fill_brush == nullptr && radius <= 0) return false;
+  return path_touches_area(
+    this->world_path, area, this->fill_brush != nullptr, this->fill_rule, radius, tolerance
+  );
+}
@@ -6,19 +6,50 @@
 
 #include <memory>
 
-#include "parser.h"
-#include "BaseShape.h"
+#include "DisplayList.h"
+#include "Flatten.h"
 
 class GdiplusFragment {
 public:
-  GdiplusFragment(const BaseShape *shape, ParseResult *svg);
+  // Replays `item` of `list`, which can be dropped once every item is built
+  GdiplusFragment(const DisplayList *list, const DisplayItem &item);
 
-  void render(Gdiplus::Graphics *graphics);
+  // Draws the shape, `scale` is the number of device pixels per unit of the
+  // world space
+  void render(Gdiplus::Graphics *graphics, double scale);
+
+  // Returns the box the shape paints in, in world space, strokes included
+  const AABB &bounds() const { return this->world_bounds; }
+
+  // Returns whether the fill or the stroke covers the world point `p`,
+  // curves being followed to within `tolerance`. Text is hit anywhere in
+  // its box
+  bool hit(Point p, double tolerance) const;
+
+  // Returns whether the fill or the stroke covers any of the world `area`
+  bool touches(const AABB &area, double tolerance) const;
 private:
+  // Rebuilds `path` from the flattened lines
+  void build_lines();
+
+  // Adds the points gathered in `figure` to `path` as one figure
+  void add_figure(bool closed);
+
   std::unique_ptr<const Gdiplus::Brush> fill_brush;
   std::unique_ptr<const Gdiplus::Brush> stroke_brush;
   Gdiplus::Pen pen;
   Gdiplus::GraphicsPath path;
+  Gdiplus::FillMode fill_mode;
+  FillRule fill_rule;
+
+  // Text is laid out by GDI+, every other shape is kept as a path in world
+  // space and flattened for the current zoom
+  bool is_text;
+  PathData world_path;
+  FlattenCache flatten;
+  ArrayList<Gdiplus::PointF> figure;
+
+  AABB world_bounds;
 };
 
 #endif
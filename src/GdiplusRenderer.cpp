@@ -1,14 +1,45 @@
 #include "GdiplusRenderer.h"
 
+#include <chrono>
 #include <cmath>
-#include <fstream>
-#include <sstream>
 
 #include "parser.h"
+#include "DisplayList.h"
 #include "SVG.h"
+#include "Flatten.h"
+
+// The side of the cached tiles in pixels, and the memory they may take
+constexpr uint32_t VIEW_TILE_SIZE = 256;
+constexpr size_t VIEW_TILE_CACHE_BYTES = (size_t)256 << 20;
+
+// The time a frame spends rendering missing tiles before it shows what it
+// has, the frames after it render the rest
+constexpr double VIEW_FRAME_BUDGET_MS = 12;
+
+// How far, in levels, a kept level may be from the view to stand in for
+// its missing tiles
+constexpr int64_t VIEW_PLACEHOLDER_LEVELS = (int64_t)(2 * TILE_LEVELS_PER_OCTAVE);
+
+// Draws the tile of `size` pixels at `pixels` with its corner on the window
+// pixel `corner`
+static void draw_tile(Gdiplus::Graphics *graphics, uint8_t *pixels, INT size, Point corner) {
+  Gdiplus::Bitmap bitmap {size, size, size * 4, PixelFormat32bppPARGB, pixels};
+  graphics->DrawImage(&bitmap, (INT)corner[0], (INT)corner[1], size, size);
+}
+
+// Returns the corner of the tile at (`x`, `y`) of a level, in its device
+// pixels
+static Point tile_corner(int32_t x, int32_t y, INT size) {
+  return Point {(double)x, (double)y} * (double)size;
+}
 
 GdiplusRenderer::GdiplusRenderer(int init_width, int init_height) :
   shapes{},
+  bvh{},
+  visible{},
+  tiles{VIEW_TILE_SIZE, VIEW_TILE_CACHE_BYTES},
+  missing{},
+  background{0},
   center{0, 0},
   scale{1},
   dragging{false},
@@ -18,21 +49,27 @@ GdiplusRenderer::GdiplusRenderer(int init_width, int init_height) :
   view_height{0} {}
 
 bool GdiplusRenderer::load_file(const char *filename) {
-  std::ifstream fin(filename);
+  Optional<DocumentSource> source = DocumentSource::map_file(filename);
 
-  if (!fin.is_open()) {
+  if (!source.has_value) {
     return false;
   }
 
-  std::ostringstream ss;
-  ss << fin.rdbuf();
-  std::string svg_file = ss.str();
   this->clear();
-  ParseResult svg = parse_xml(svg_file);
+  ParseResult svg = parse_xml(std::move(source.data));
+
+  Scene scene = build_scene(&svg);
+  DisplayList list = compile_display_list(&scene);
+  for (const DisplayItem &item : list.items) {
+    this->shapes.emplace_back(&list, item);
+  }
 
-  for (const BaseShape *shape = svg.shapes.get(); shape; shape = shape->next.get()) {
-    this->shapes.emplace_back(shape, &svg);
+  ArrayList<AABB> bounds;
+  bounds.resize((uint32_t)this->shapes.size());
+  for (uint32_t i = 0; i < bounds.len(); ++i) {
+    bounds[i] = this->shapes[i].bounds();
   }
+  this->bvh.build(bounds.begin(), bounds.len());
 
   if (svg.root) {
     if (svg.root->view_width && svg.root->view_height) {
@@ -56,17 +93,152 @@ bool GdiplusRenderer::load_file(const char *filename) {
   return true;
 }
 
-void GdiplusRenderer::render(Gdiplus::Graphics *graphics) {
-  graphics->TranslateTransform(
-    (Gdiplus::REAL)this->center[0],
-    (Gdiplus::REAL)this->center[1]
+bool GdiplusRenderer::render(Gdiplus::Graphics *graphics, Gdiplus::Color background) {
+  // The tiles have the background painted in
+  if (background.GetValue() != this->background) {
+    this->tiles.clear();
+    this->background = background.GetValue();
+  }
+
+  // Tiles land on whole pixels so they are copied, not resampled. The view
+  // is off by less than half a pixel for it
+  Point origin = {std::round(this->center[0]), std::round(this->center[1])};
+  Point screen = {(double)this->width, (double)this->height};
+  int64_t level = tile_level(this->scale);
+  INT size = (INT)this->tiles.tile_size();
+  TileRange range = tile_range(AABB {-origin, screen - origin}, size);
+
+  this->missing.resize(0);
+  for (int32_t y = range.y0; y < range.y1; ++y) {
+    for (int32_t x = range.x0; x < range.x1; ++x) {
+      TileKey key = {level, x, y};
+      if (uint8_t *pixels = this->tiles.find(key)) {
+        draw_tile(graphics, pixels, size, origin + tile_corner(x, y, size));
+      } else {
+        this->missing.push(key);
+      }
+    }
+  }
+  if (this->missing.len() == 0) return true;
+
+  // Until they are rendered, the missing tiles show the closest level kept,
+  // so a zoom shows the view it leaves scaled at once
+  Optional<int64_t> placeholder = this->tiles.nearest_level(level, VIEW_PLACEHOLDER_LEVELS);
+  if (placeholder) {
+    for (TileKey key : this->missing) {
+      this->draw_placeholder(graphics, key, *placeholder, origin);
+    }
+  }
+
+  // At least one tile is rendered, so every frame gets closer to the view
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < this->missing.len(); ++i) {
+    std::chrono::duration<double, std::milli> spent = std::chrono::steady_clock::now() - start;
+    if (i > 0 && spent.count() > VIEW_FRAME_BUDGET_MS) return false;
+
+    TileKey key = this->missing[i];
+    uint8_t *pixels = this->tiles.insert(key);
+    this->render_tile(key, pixels);
+    draw_tile(graphics, pixels, size, origin + tile_corner(key.x, key.y, size));
+  }
+  return true;
+}
+
+void GdiplusRenderer::render_tile(TileKey key, uint8_t *pixels) {
+  INT size = (INT)this->tiles.tile_size();
+  Gdiplus::Bitmap bitmap {size, size, size * 4, PixelFormat32bppPARGB, pixels};
+  Gdiplus::Graphics graphics {&bitmap};
+  graphics.SetSmoothingMode(Gdiplus::SmoothingModeHighQuality);
+  graphics.Clear(Gdiplus::Color {this->background});
+  Point corner = tile_corner(key.x, key.y, size);
+  graphics.TranslateTransform(
+    -(Gdiplus::REAL)corner[0],
+    -(Gdiplus::REAL)corner[1]
   );
-  graphics->ScaleTransform(
+  graphics.ScaleTransform(
     (Gdiplus::REAL)this->scale,
     (Gdiplus::REAL)this->scale
   );
-  for (GdiplusFragment &shape : this->shapes) {
-    shape.render(graphics);
+
+  // Only shapes touching the tile are drawn, in document order
+  AABB area = {corner / this->scale, (corner + Point {(double)size, (double)size}) / this->scale};
+  this->visible.resize(0);
+  this->bvh.query(area, &this->visible);
+  for (uint32_t index : this->visible) {
+    this->shapes[index].render(&graphics, this->scale);
+  }
+}
+
+void GdiplusRenderer::draw_placeholder(Gdiplus::Graphics *graphics, TileKey key, int64_t level, Point origin) {
+  INT size = (INT)this->tiles.tile_size();
+
+  // Window pixels per pixel of the level
+  double ratio = this->scale / tile_level_scale(level);
+  Point corner = tile_corner(key.x, key.y, size);
+  AABB area = {corner / ratio, (corner + Point {(double)size, (double)size}) / ratio};
+  TileRange range = tile_range(area, size);
+
+  // Edges are sampled from the tile itself rather than faded out, so the
+  // scaled tiles join without seams
+  Gdiplus::ImageAttributes attributes;
+  attributes.SetWrapMode(Gdiplus::WrapModeTileFlipXY);
+  Point clip = origin + corner;
+  graphics->SetClip(Gdiplus::Rect {(INT)clip[0], (INT)clip[1], size, size});
+
+  for (int32_t y = range.y0; y < range.y1; ++y) {
+    for (int32_t x = range.x0; x < range.x1; ++x) {
+      uint8_t *pixels = this->tiles.find(TileKey {level, x, y});
+      if (!pixels) continue;
+
+      Gdiplus::Bitmap bitmap {size, size, size * 4, PixelFormat32bppPARGB, pixels};
+      Point start = origin + tile_corner(x, y, size) * ratio;
+      Gdiplus::RectF target = {
+        (Gdiplus::REAL)start[0],
+        (Gdiplus::REAL)start[1],
+        (Gdiplus::REAL)(size * ratio),
+        (Gdiplus::REAL)(size * ratio),
+      };
+      graphics->DrawImage(&bitmap, target, 0.0f, 0.0f, (Gdiplus::REAL)size, (Gdiplus::REAL)size, Gdiplus::UnitPixel, &attributes);
+    }
+  }
+
+  graphics->ResetClip();
+}
+
+Point GdiplusRenderer::to_world(Point pos) const {
+  // A world point p lands on the screen at p * scale + center
+  return (pos - this->center) / this->scale;
+}
+
+Optional<uint32_t> GdiplusRenderer::pick(Point pos) const {
+  Point p = this->to_world(pos);
+  ArrayList<uint32_t> candidates;
+  this->bvh.query(AABB {p, p}, &candidates);
+
+  // Shapes painted later are on top
+  double tolerance = FLATTEN_TOLERANCE / this->scale;
+  for (uint32_t i = candidates.len(); i-- > 0;) {
+    if (this->shapes[candidates[i]].hit(p, tolerance)) {
+      return Optional<uint32_t>::some(candidates[i]);
+    }
+  }
+  return Optional<uint32_t>::none();
+}
+
+void GdiplusRenderer::pick_area(Point a, Point b, ArrayList<uint32_t> *out) const {
+  Point p0 = this->to_world(a);
+  Point p1 = this->to_world(b);
+  AABB area = {
+    Point {std::min(p0[0], p1[0]), std::min(p0[1], p1[1])},
+    Point {std::max(p0[0], p1[0]), std::max(p0[1], p1[1])},
+  };
+
+  ArrayList<uint32_t> candidates;
+  this->bvh.query(area, &candidates);
+
+  double tolerance = FLATTEN_TOLERANCE / this->scale;
+  for (uint32_t index : candidates) {
+    if (this->shapes[index].touches(area, tolerance)) out->push(index);
   }
 }
 
@@ -129,6 +301,8 @@ void GdiplusRenderer::resize(int new_width, int new_height) {
 
 void GdiplusRenderer::clear() {
   this->shapes.clear();
+  this->bvh.clear();
+  this->tiles.clear();
   this->center = {0, 0};
   this->scale = 1;
 }
@@ -2,6 +2,8 @@
 #define GDIPLUS_RENDERER_H
 
 #include "GdiplusFragment.h"
+#include "BVH.h"
+#include "TileCache.h"
 #include <deque>
 
 class GdiplusRenderer {
@@ -10,7 +12,18 @@ public:
   
   bool load_file(const char *filename);
 
-  void render(Gdiplus::Graphics *graphics);
+  // Draws the view over `background` from cached tiles, rendering the
+  // missing ones until the frame has taken its share of time. Returns false
+  // when some are left for the next frame, which draws them
+  bool render(Gdiplus::Graphics *graphics, Gdiplus::Color background);
+
+  // Returns the index of the topmost shape painted at the window point
+  // `pos`, in the order shapes were loaded
+  Optional<uint32_t> pick(Point pos) const;
+
+  // Appends the indices of every shape painted in the window rectangle with
+  // corners `a` and `b` to `out`, in painting order
+  void pick_area(Point a, Point b, ArrayList<uint32_t> *out) const;
 
   void drag_start(Point pos);
   bool drag_move(Point pos);
@@ -21,8 +34,29 @@ public:
 
   void clear();
 private:
+  // Renders the shapes under the tile at `key` into its `pixels`, at the
+  // current scale
+  void render_tile(TileKey key, uint8_t *pixels);
+
+  // Draws the missing tile at `key` from the tiles of `level`, scaled to
+  // the view. `origin` is where the world origin is on the window
+  void draw_placeholder(Gdiplus::Graphics *graphics, TileKey key, int64_t level, Point origin);
+
+  // Maps a window point into the world
+  Point to_world(Point pos) const;
+
   std::deque<GdiplusFragment> shapes;
 
+  // Over the bounds of `shapes`, so a frame only visits what it can see
+  BVH bvh;
+  ArrayList<uint32_t> visible;
+
+  // The view as it was rendered, panning reuses every tile still on screen.
+  // Tiles are opaque, drawn over `background`
+  TileCache tiles;
+  ArrayList<TileKey> missing;
+  Gdiplus::ARGB background;
+
   Point center;
   double scale;
   bool dragging;
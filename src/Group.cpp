@@ -2,9 +2,11 @@
 
 using namespace SVGShapes;
 
-Group::Group(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles) :
-  BaseShape{attrs, attrs_count, parent, styles}, parent{parent} {}
+Group::Group(const AttributeSet *attrs, BaseShape *parent, ParseContext *context) :
+  BaseShape{attrs, parent, context} {
+  this->kind = SHAPE_KIND_GROUP;
+}
 
 AABB Group::get_bounding() const{
-  return parent->get_bounding();
+  return this->parent->bounds();
 }
\ No newline at end of file
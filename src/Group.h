@@ -7,10 +7,9 @@ namespace SVGShapes {
 
 class Group final : public BaseShape {
 public:
-  Group(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
+  Group(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
   AABB get_bounding() const override;
-private:
-  BaseShape *parent;
 };
 
 };
@@ -0,0 +1,303 @@
+#include "HitTest.h"
+#include "Flatten.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Bisection stops once the parameter is known this precisely, well past
+// what the point of a double can tell apart
+constexpr double HIT_TEST_T_PRECISION = 1e-15;
+
+// The crossing of the line with the ray from `p` towards +x, +1 going up
+// and -1 going down. Each end counts on one side only, so a ray through a
+// vertex crosses exactly one of the segments meeting there
+static int line_winding(Point a, Point b, Point p) {
+  double cross = (b[0] - a[0]) * (p[1] - a[1]) - (p[0] - a[0]) * (b[1] - a[1]);
+  if (a[1] <= p[1] && p[1] < b[1]) return cross > 0 ? 1 : 0;
+  if (b[1] <= p[1] && p[1] < a[1]) return cross < 0 ? -1 : 0;
+  return 0;
+}
+
+// One axis of a cubic in power form, a t^3 + b t^2 + c t + d
+struct CubicAxis {
+  double a;
+  double b;
+  double c;
+  double d;
+
+  double at(double t) const {
+    return ((this->a * t + this->b) * t + this->c) * t + this->d;
+  }
+};
+
+static CubicAxis cubic_axis(double p0, double p1, double p2, double p3) {
+  return CubicAxis {
+    p3 - p0 + 3 * (p1 - p2),
+    3 * (p0 - 2 * p1 + p2),
+    3 * (p1 - p0),
+    p0,
+  };
+}
+
+static int cubic_winding(Point p0, Point p1, Point p2, Point p3, Point p) {
+  double y_min = std::min(std::min(p0[1], p1[1]), std::min(p2[1], p3[1]));
+  double y_max = std::max(std::max(p0[1], p1[1]), std::max(p2[1], p3[1]));
+  if (p[1] < y_min || p[1] >= y_max) return 0;
+
+  double x_min = std::min(std::min(p0[0], p1[0]), std::min(p2[0], p3[0]));
+  double x_max = std::max(std::max(p0[0], p1[0]), std::max(p2[0], p3[0]));
+  if (x_max <= p[0]) return 0;
+
+  // Entirely to the right, every crossing counts and they add up to those
+  // of the chord
+  if (x_min > p[0]) return line_winding(p0, p3, p);
+
+  CubicAxis x = cubic_axis(p0[0], p1[0], p2[0], p3[0]);
+  CubicAxis y = cubic_axis(p0[1], p1[1], p2[1], p3[1]);
+
+  // Split where y turns, leaving pieces that cross the ray at most once
+  double splits[4] = {0, 1, 1, 1};
+  uint32_t split_count = 1;
+  double qa = 3 * y.a;
+  double qb = 2 * y.b;
+  double qc = y.c;
+  double disc = qb * qb - 4 * qa * qc;
+  if (disc >= 0) {
+    double root = std::sqrt(disc);
+    double q = -0.5 * (qb + std::copysign(root, qb));
+    double ts[2] = {q / qa, qc / q};
+    for (double t : ts) {
+      if (t > 0 && t < 1) splits[split_count++] = t;
+    }
+  }
+  if (split_count == 3 && splits[1] > splits[2]) std::swap(splits[1], splits[2]);
+  splits[split_count++] = 1;
+
+  int winding = 0;
+  for (uint32_t i = 0; i + 1 < split_count; ++i) {
+    double lo = splits[i];
+    double hi = splits[i + 1];
+    double y_lo = i == 0 ? p0[1] : y.at(lo);
+    double y_hi = i + 2 == split_count ? p3[1] : y.at(hi);
+
+    int direction = 0;
+    if (y_lo <= p[1] && p[1] < y_hi) direction = 1;
+    if (y_hi <= p[1] && p[1] < y_lo) direction = -1;
+    if (direction == 0) continue;
+
+    // The piece is monotonic, so bisection keeps the crossing between the
+    // ends, where (y - p.y) * direction goes from at most 0 to above 0
+    while (hi - lo > HIT_TEST_T_PRECISION) {
+      double mid = 0.5 * (lo + hi);
+      if (mid <= lo || mid >= hi) break;
+      if ((y.at(mid) - p[1]) * direction > 0) hi = mid;
+      else lo = mid;
+    }
+
+    if (x.at(0.5 * (lo + hi)) > p[0]) winding += direction;
+  }
+  return winding;
+}
+
+int path_winding(const PathData &path, Point p) {
+  const Point *point = path.points.begin();
+  Point start = {0, 0};
+  Point current = {0, 0};
+  int winding = 0;
+
+  for (PathVerb verb : path.verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        winding += line_winding(current, start, p);
+        start = point[0];
+        current = point[0];
+      } break;
+
+      case PATH_VERB_LINE: {
+        winding += line_winding(current, point[0], p);
+        current = point[0];
+      } break;
+
+      case PATH_VERB_QUAD: {
+        BezierCurve curve = elevate_quad(current, point[0], point[1]);
+        winding += cubic_winding(curve.start, curve.control_start, curve.control_end, curve.end, p);
+        current = point[1];
+      } break;
+
+      case PATH_VERB_CUBIC: {
+        winding += cubic_winding(current, point[0], point[1], point[2], p);
+        current = point[2];
+      } break;
+
+      case PATH_VERB_CLOSE: {
+        winding += line_winding(current, start, p);
+        current = start;
+      } break;
+
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      }
+    }
+    point += path_verb_points[verb];
+  }
+
+  return winding + line_winding(current, start, p);
+}
+
+bool path_fill_contains(const PathData &path, FillRule rule, Point p) {
+  int winding = path_winding(path, p);
+  switch (rule) {
+    case FILL_RULE_NONZERO: return winding != 0;
+    case FILL_RULE_EVENODD: return winding % 2 != 0;
+    case FILL_RULE_COUNT: {
+      __builtin_unreachable();
+    }
+  }
+  return false;
+}
+
+// Returns the squared distance from `p` to the segment from `a` to `b`
+static double segment_distance_sq(Point a, Point b, Point p) {
+  Point ab = b - a;
+  Point ap = p - a;
+  double length_sq = ab[0] * ab[0] + ab[1] * ab[1];
+  double t = length_sq > 0 ? (ap[0] * ab[0] + ap[1] * ab[1]) / length_sq : 0;
+  t = std::min(std::max(t, 0.0), 1.0);
+
+  Point d = ap - ab * t;
+  return d[0] * d[0] + d[1] * d[1];
+}
+
+static bool boxes_touch(const AABB &a, const AABB &b) {
+  return a.min[0] <= b.max[0] && b.min[0] <= a.max[0]
+      && a.min[1] <= b.max[1] && b.min[1] <= a.max[1];
+}
+
+// Calls `visit` with the lines of the flattened `path` that may touch `near`
+// until it returns true. A curve is only flattened when the box around its
+// control points touches `near`, the curve lying inside that box. Closes add
+// their line, and so does the end of every open subpath when `close_open`
+// is set
+template<typename Visit>
+static bool any_line(const PathData &path, const AABB &near, double tolerance, bool close_open, Visit visit) {
+  auto line = [&](Point a, Point b) {
+    AABB box = {Point {std::min(a[0], b[0]), std::min(a[1], b[1])}, Point {std::max(a[0], b[0]), std::max(a[1], b[1])}};
+    return boxes_touch(box, near) && visit(a, b);
+  };
+
+  PathData lines;
+  auto curve = [&](const Point *control, uint32_t count) {
+    AABB box = {control[0], control[0]};
+    for (uint32_t i = 1; i < count; ++i) {
+      box.min = Point {std::min(box.min[0], control[i][0]), std::min(box.min[1], control[i][1])};
+      box.max = Point {std::max(box.max[0], control[i][0]), std::max(box.max[1], control[i][1])};
+    }
+    if (!boxes_touch(box, near)) return false;
+
+    lines.clear();
+    lines.move_to(control[0]);
+    if (count == 3) lines.quad_to(control[1], control[2]);
+    else lines.cubic_to(control[1], control[2], control[3]);
+
+    PathData flat;
+    flatten_path(lines, tolerance, &flat);
+    for (uint32_t i = 1; i < flat.points.len(); ++i) {
+      if (visit(flat.points[i - 1], flat.points[i])) return true;
+    }
+    return false;
+  };
+
+  const Point *point = path.points.begin();
+  Point start = {0, 0};
+  Point current = {0, 0};
+  bool open = false;
+
+  for (PathVerb verb : path.verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        if (open && close_open && line(current, start)) return true;
+        start = point[0];
+        current = point[0];
+        open = true;
+      } break;
+
+      case PATH_VERB_LINE: {
+        if (line(current, point[0])) return true;
+        current = point[0];
+      } break;
+
+      case PATH_VERB_QUAD: {
+        Point control[3] = {current, point[0], point[1]};
+        if (curve(control, 3)) return true;
+        current = point[1];
+      } break;
+
+      case PATH_VERB_CUBIC: {
+        Point control[4] = {current, point[0], point[1], point[2]};
+        if (curve(control, 4)) return true;
+        current = point[2];
+      } break;
+
+      case PATH_VERB_CLOSE: {
+        if (line(current, start)) return true;
+        current = start;
+        open = false;
+      } break;
+
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      }
+    }
+    point += path_verb_points[verb];
+  }
+
+  return open && close_open && line(current, start);
+}
+
+bool path_stroke_contains(const PathData &path, double radius, double tolerance, Point p) {
+  double radius_sq = radius * radius;
+  AABB near = {p - Point {radius, radius}, p + Point {radius, radius}};
+  return any_line(path, near, tolerance, false, [&](Point a, Point b) {
+    return segment_distance_sq(a, b, p) <= radius_sq;
+  });
+}
+
+// Returns whether the segment from `a` to `b` has a point in `area`, by
+// clipping its parameter range against each side
+static bool segment_touches_area(Point a, Point b, const AABB &area) {
+  double t0 = 0;
+  double t1 = 1;
+  Point d = b - a;
+  for (int j = 0; j < 2; ++j) {
+    if (d[j] == 0) {
+      if (a[j] < area.min[j] || a[j] > area.max[j]) return false;
+      continue;
+    }
+    double near = (area.min[j] - a[j]) / d[j];
+    double far = (area.max[j] - a[j]) / d[j];
+    if (near > far) std::swap(near, far);
+    t0 = std::max(t0, near);
+    t1 = std::min(t1, far);
+    if (t0 > t1) return false;
+  }
+  return true;
+}
+
+bool path_touches_area(
+  const PathData &path, const AABB &area,
+  bool filled, FillRule rule, double radius, double tolerance
+) {
+  // An area inside the fill touches no edge, but all of its corners are
+  // inside
+  if (filled && path_fill_contains(path, rule, area.min)) return true;
+
+  AABB grown = area;
+  if (radius > 0) {
+    grown.min = area.min - Point {radius, radius};
+    grown.max = area.max + Point {radius, radius};
+  }
+
+  return any_line(path, grown, tolerance, filled, [&](Point a, Point b) {
+    return segment_touches_area(a, b, grown);
+  });
+}
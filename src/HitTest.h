@@ -0,0 +1,30 @@
+#ifndef HIT_TEST_H
+#define HIT_TEST_H
+
+#include "Bounds.h"
+#include "PathData.h"
+#include "Style.h"
+
+// Returns the winding number of `path` around `p`, every subpath being
+// closed back to its start as filling does. Curves are followed exactly,
+// the crossings with the ray from `p` towards +x are found on the curves
+// themselves rather than on lines approximating them
+int path_winding(const PathData &path, Point p);
+
+// Returns whether `p` is inside the fill of `path` under `rule`
+bool path_fill_contains(const PathData &path, FillRule rule, Point p);
+
+// Returns whether `p` is within `radius` of the outline of `path`, curves
+// being followed to within `tolerance`. Open subpaths are not closed
+bool path_stroke_contains(const PathData &path, double radius, double tolerance, Point p);
+
+// Returns whether any of `area` is covered by `path`, either its fill when
+// `filled` or its outline grown by `radius`, with curves followed to within
+// `tolerance`. The outline is grown by a square rather than a disc, so it
+// may touch up to `radius * (sqrt(2) - 1)` too early at the corners of `area`
+bool path_touches_area(
+  const PathData &path, const AABB &area,
+  bool filled, FillRule rule, double radius, double tolerance
+);
+
+#endif
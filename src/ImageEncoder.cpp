@@ -0,0 +1,348 @@
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+// Matches are looked for this far back, the most deflate can refer to
+constexpr uint32_t DEFLATE_WINDOW = 32768;
+constexpr uint32_t DEFLATE_MIN_MATCH = 3;
+constexpr uint32_t DEFLATE_MAX_MATCH = 258;
+
+// Earlier positions with the same hash tried before taking the longest
+// match found, bounds the time spent on long runs of one color
+constexpr uint32_t DEFLATE_MAX_CHAIN = 32;
+constexpr uint32_t DEFLATE_HASH_BITS = 15;
+
+// Matches longer than this only have their first position hashed, as zlib
+// does at its fastest levels. Their other positions are mostly inside runs
+// the hashes of later positions find again
+constexpr uint32_t DEFLATE_MAX_INSERT = 16;
+
+// Bytes summed into Adler-32 before its sums must be reduced
+constexpr uint32_t ADLER_BLOCK = 5552;
+
+// The shortest length and distance of each code, and the extra bits after it
+constexpr uint16_t length_base[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+constexpr uint8_t length_extra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+constexpr uint16_t distance_base[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+constexpr uint8_t distance_extra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+constexpr std::array<uint32_t, 256> crc_table = [] {
+  std::array<uint32_t, 256> table {};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    table[i] = c;
+  }
+  return table;
+}();
+
+// Packs bits from the least significant one up, as deflate reads them
+class BitWriter {
+public:
+  BitWriter(ArrayList<uint8_t> *out) : out{out}, bits{0}, count{0} {}
+
+  void put(uint32_t value, uint32_t width) {
+    this->bits |= (uint64_t)value << this->count;
+    this->count += width;
+    while (this->count >= 8) {
+      this->out->push((uint8_t)this->bits);
+      this->bits >>= 8;
+      this->count -= 8;
+    }
+  }
+
+  // Huffman codes are sent from their most significant bit
+  void put_code(uint32_t code, uint32_t width) {
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < width; ++i) reversed |= ((code >> i) & 1) << (width - 1 - i);
+    this->put(reversed, width);
+  }
+
+  // Pads the last byte with zeros
+  void flush() {
+    if (this->count) this->out->push((uint8_t)this->bits);
+    this->bits = 0;
+    this->count = 0;
+  }
+private:
+  ArrayList<uint8_t> *out;
+  uint64_t bits;
+  uint32_t count;
+};
+
+// Writes a literal byte, the end of the block or a length code with the
+// fixed literal/length code
+static void put_symbol(BitWriter *writer, uint32_t symbol) {
+  if (symbol < 144) writer->put_code(0x30 + symbol, 8);
+  else if (symbol < 256) writer->put_code(0x190 + symbol - 144, 9);
+  else if (symbol < 280) writer->put_code(symbol - 256, 7);
+  else writer->put_code(0xc0 + symbol - 280, 8);
+}
+
+static void put_match(BitWriter *writer, uint32_t length, uint32_t distance) {
+  uint32_t code = (uint32_t)(std::upper_bound(length_base, length_base + 29, length) - length_base - 1);
+  put_symbol(writer, 257 + code);
+  writer->put(length - length_base[code], length_extra[code]);
+
+  code = (uint32_t)(std::upper_bound(distance_base, distance_base + 30, distance) - distance_base - 1);
+  writer->put_code(code, 5);
+  writer->put(distance - distance_base[code], distance_extra[code]);
+}
+
+static uint32_t hash3(const uint8_t *p) {
+  uint32_t word = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+  return (word * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+// Compresses `data` as a single deflate block with the fixed codes, each
+// position takes the longest earlier match its hash chain leads to
+static void deflate_fixed(const uint8_t *data, uint32_t size, ArrayList<uint8_t> *out) {
+  BitWriter writer {out};
+  writer.put(1, 1);
+  writer.put(1, 2);
+
+  // The last position of each hash, and for each position in the window
+  // the one before it with the same hash
+  std::unique_ptr<int32_t[]> head {new int32_t[1 << DEFLATE_HASH_BITS]};
+  std::unique_ptr<int32_t[]> previous {new int32_t[DEFLATE_WINDOW]};
+  std::fill(head.get(), head.get() + (1 << DEFLATE_HASH_BITS), -1);
+
+  auto insert = [&](uint32_t i) {
+    if (i + DEFLATE_MIN_MATCH > size) return;
+    uint32_t hash = hash3(data + i);
+    previous[i % DEFLATE_WINDOW] = head[hash];
+    head[hash] = (int32_t)i;
+  };
+
+  uint32_t i = 0;
+  while (i < size) {
+    uint32_t best_length = 0;
+    uint32_t best_distance = 0;
+    if (i + DEFLATE_MIN_MATCH <= size) {
+      uint32_t limit = std::min(DEFLATE_MAX_MATCH, size - i);
+      int32_t candidate = head[hash3(data + i)];
+
+      // Chains only go back, a slot reused by a newer position ends them
+      for (uint32_t chain = 0; chain < DEFLATE_MAX_CHAIN; ++chain) {
+        if (candidate < 0 || i - candidate >= DEFLATE_WINDOW) break;
+
+        const uint8_t *a = data + candidate;
+        const uint8_t *b = data + i;
+        if (a[best_length] == b[best_length]) {
+          uint32_t length = 0;
+          while (length < limit && a[length] == b[length]) ++length;
+          if (length > best_length) {
+            best_length = length;
+            best_distance = i - candidate;
+            if (length == limit) break;
+          }
+        }
+
+        int32_t next = previous[candidate % DEFLATE_WINDOW];
+        if (next >= candidate) break;
+        candidate = next;
+      }
+    }
+
+    if (best_length >= DEFLATE_MIN_MATCH) {
+      put_match(&writer, best_length, best_distance);
+      uint32_t inserted = best_length <= DEFLATE_MAX_INSERT ? best_length : 1;
+      for (uint32_t k = 0; k < inserted; ++k) insert(i + k);
+      i += best_length;
+    } else {
+      put_symbol(&writer, data[i]);
+      insert(i);
+      ++i;
+    }
+  }
+
+  put_symbol(&writer, 256);
+  writer.flush();
+}
+
+static void put_u32(ArrayList<uint8_t> *out, uint32_t value) {
+  out->push((uint8_t)(value >> 24));
+  out->push((uint8_t)(value >> 16));
+  out->push((uint8_t)(value >> 8));
+  out->push((uint8_t)value);
+}
+
+static void put_chunk(ArrayList<uint8_t> *out, const char *type, const uint8_t *data, uint32_t size) {
+  put_u32(out, size);
+  uint32_t start = out->len();
+  out->extend((const uint8_t*)type, 4);
+  if (size) out->extend(data, size);
+
+  uint32_t crc = 0xffffffff;
+  for (uint32_t i = start; i < out->len(); ++i) {
+    crc = crc_table[(crc ^ (*out)[i]) & 0xff] ^ (crc >> 8);
+  }
+  put_u32(out, crc ^ 0xffffffff);
+}
+
+// The filters tried on each row. Average and Paeth seldom beat these on
+// drawings, which are flat areas and antialiased edges, and took as long as
+// the rest of the encoding together
+enum PngFilter : uint8_t {
+  PNG_FILTER_NONE = 0,
+  PNG_FILTER_SUB,
+  PNG_FILTER_UP,
+  PNG_FILTER_COUNT,
+};
+
+// Writes to `out` what is left of the `size` bytes of `row` once `filter`
+// predicted each from its neighbours. The pixels left of the row count as
+// zeros
+static void apply_filter(PngFilter filter, const uint8_t *row, const uint8_t *above, uint32_t size, uint8_t *out) {
+  switch (filter) {
+    case PNG_FILTER_NONE: {
+      std::copy(row, row + size, out);
+    } break;
+    case PNG_FILTER_SUB: {
+      std::copy(row, row + std::min(size, 4u), out);
+      for (uint32_t x = 4; x < size; ++x) out[x] = (uint8_t)(row[x] - row[x - 4]);
+    } break;
+    case PNG_FILTER_UP: {
+      for (uint32_t x = 0; x < size; ++x) out[x] = (uint8_t)(row[x] - above[x]);
+    } break;
+    case PNG_FILTER_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+}
+
+void encode_png(const RasterTarget &image, ArrayList<uint8_t> *out) {
+  uint32_t row_size = image.width * 4;
+
+  // Each row is stored after the byte naming its filter. The filter kept is
+  // the one leaving the smallest residuals, which compress best
+  ArrayList<uint8_t> filtered;
+  filtered.resize((row_size + 1) * image.height);
+  ArrayList<uint8_t> row;
+  ArrayList<uint8_t> above;
+  ArrayList<uint8_t> candidate;
+  row.resize(row_size);
+  above.resize(row_size);
+  candidate.resize(row_size);
+  std::fill(above.begin(), above.end(), 0);
+
+  for (uint32_t y = 0; y < image.height; ++y) {
+    // Back to straight alpha
+    const uint8_t *pixel = image.pixels + y * image.stride;
+    for (uint32_t x = 0; x < row_size; x += 4) {
+      uint32_t a = pixel[x + 3];
+      if (a == 255 || a == 0) {
+        std::copy(pixel + x, pixel + x + 4, &row[x]);
+        continue;
+      }
+      for (uint32_t c = 0; c < 3; ++c) {
+        row[x + c] = (uint8_t)std::min((pixel[x + c] * 255 + a / 2) / a, 255u);
+      }
+      row[x + 3] = (uint8_t)a;
+    }
+
+    uint8_t *line = &filtered[y * (row_size + 1)];
+    uint32_t best_cost = UINT32_MAX;
+    for (uint8_t filter = 0; filter < PNG_FILTER_COUNT; ++filter) {
+      apply_filter((PngFilter)filter, row.begin(), above.begin(), row_size, candidate.begin());
+
+      uint32_t cost = 0;
+      for (uint8_t residual : candidate) {
+        cost += (uint32_t)std::abs((int8_t)residual);
+      }
+      if (cost < best_cost) {
+        best_cost = cost;
+        line[0] = filter;
+        std::copy(candidate.begin(), candidate.end(), line + 1);
+      }
+    }
+
+    std::swap(row, above);
+  }
+
+  // A zlib stream: the header, the deflate data and the Adler-32 of the
+  // filtered rows
+  ArrayList<uint8_t> compressed;
+  compressed.push(0x78);
+  compressed.push(0x01);
+  deflate_fixed(filtered.begin(), filtered.len(), &compressed);
+
+  // The sums are reduced once per block, as late as they cannot overflow
+  uint32_t s1 = 1;
+  uint32_t s2 = 0;
+  for (uint32_t start = 0; start < filtered.len(); start += ADLER_BLOCK) {
+    uint32_t end = std::min(start + ADLER_BLOCK, filtered.len());
+    for (uint32_t i = start; i < end; ++i) {
+      s1 += filtered[i];
+      s2 += s1;
+    }
+    s1 %= 65521;
+    s2 %= 65521;
+  }
+  put_u32(&compressed, s2 << 16 | s1);
+
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  out->extend(signature, 8);
+
+  // 8 bits per channel, RGBA, deflate, adaptive filters, not interlaced
+  uint8_t header[13];
+  for (int i = 0; i < 4; ++i) {
+    header[i] = (uint8_t)(image.width >> (24 - 8 * i));
+    header[4 + i] = (uint8_t)(image.height >> (24 - 8 * i));
+  }
+  header[8] = 8;
+  header[9] = 6;
+  header[10] = 0;
+  header[11] = 0;
+  header[12] = 0;
+  put_chunk(out, "IHDR", header, 13);
+  put_chunk(out, "IDAT", compressed.begin(), compressed.len());
+  put_chunk(out, "IEND", nullptr, 0);
+}
+
+void encode_ppm(const RasterTarget &image, ArrayList<uint8_t> *out) {
+  char header[64];
+  int length = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", image.width, image.height);
+  out->extend((const uint8_t*)header, (uint32_t)length);
+
+  uint32_t start = out->len();
+  out->resize(start + image.width * image.height * 3);
+  uint8_t *rgb = out->begin() + start;
+  for (uint32_t y = 0; y < image.height; ++y) {
+    const uint8_t *pixel = image.pixels + y * image.stride;
+    for (uint32_t x = 0; x < image.width; ++x, pixel += 4, rgb += 3) {
+      // Premultiplied colors over white only need the white left uncovered
+      for (int c = 0; c < 3; ++c) rgb[c] = (uint8_t)(pixel[c] + 255 - pixel[3]);
+    }
+  }
+}
+
+void encode_image(const RasterTarget &image, ImageFormat format, ArrayList<uint8_t> *out) {
+  switch (format) {
+    case IMAGE_FORMAT_PNG: {
+      encode_png(image, out);
+    } break;
+    case IMAGE_FORMAT_PPM: {
+      encode_ppm(image, out);
+    } break;
+    case IMAGE_FORMAT_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "ArrayList.h"
+#include "Rasterizer.h"
+
+enum ImageFormat {
+  IMAGE_FORMAT_PNG = 0,
+  IMAGE_FORMAT_PPM,
+  IMAGE_FORMAT_COUNT,
+};
+
+// Also the extension of the files
+constexpr std::string_view image_format_name[IMAGE_FORMAT_COUNT] = {
+  "png",
+  "ppm",
+};
+
+// Appends `image` to `out` as an RGBA PNG with straight alpha. Rows are
+// filtered and compressed with the fixed codes of deflate, which needs no
+// tables in the stream and does well on the flat areas of drawings
+void encode_png(const RasterTarget &image, ArrayList<uint8_t> *out);
+
+// Appends `image` to `out` as a binary PPM. The format has no alpha, the
+// image is laid over white
+void encode_ppm(const RasterTarget &image, ArrayList<uint8_t> *out);
+
+// Appends `image` to `out` in `format`
+void encode_image(const RasterTarget &image, ImageFormat format, ArrayList<uint8_t> *out);
+
+#endif
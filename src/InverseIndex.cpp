@@ -1,23 +1,31 @@
 #include "InverseIndex.h"
 
+#include <cstdlib>
+
+void perfect_hash_failed() {
+  abort();
+}
+
 InverseIndex<0>::InverseIndex(const std::string_view *map, uint32_t count) 
   : idx_map{map},
-    ht_shift{(uint32_t)__builtin_clz(count - 1) - 1},
-    ht_size{(uint32_t)1 << (32 - ht_shift)},
-    keys{std::make_unique<int[]>(ht_size)} {
-  for (uint32_t i = 0; i < count; ++i) {
-    uint32_t h = hash32(map[i].data(), map[i].size(), 0x811c9dc5) >> ht_shift;
-    while (keys[h]) {
-      h = (h + 1) & (ht_size - 1);
-    }
-    keys[h] = i + 1;
-  }
+    count{count},
+    displace{std::make_unique<int[]>(count)},
+    slots{std::make_unique<int[]>(count)} {
+  std::unique_ptr<uint64_t[]> mixes = std::make_unique<uint64_t[]>(count);
+  std::unique_ptr<uint32_t[]> bucket_start = std::make_unique<uint32_t[]>(count + 1);
+  std::unique_ptr<uint32_t[]> bucket_keys = std::make_unique<uint32_t[]>(count);
+  std::unique_ptr<uint32_t[]> cursor = std::make_unique<uint32_t[]>(count);
+  build_perfect_hash(
+    map, count, displace.get(), slots.get(),
+    mixes.get(), bucket_start.get(), bucket_keys.get(), cursor.get()
+  );
 }
 
 int InverseIndex<0>::operator[](std::string_view sv) const {
-  uint32_t h = hash32(sv.data(), sv.size(), 0x811c9dc5) >> ht_shift;
-  while (keys[h] && idx_map[keys[h] - 1] != sv) {
-    h = (h + 1) & (ht_size - 1);
-  }
-  return keys[h] - 1;
+  if (count == 0) return -1;
+  uint64_t mix = key_mix(sv);
+  int d = displace[perfect_hash_bucket(mix, count)];
+  uint32_t slot = d < 0 ? (uint32_t)(-d - 1) : perfect_hash_slot(mix, d, count);
+  int idx = slots[slot];
+  return key_equal(idx_map[idx], sv) ? idx : -1;
 }
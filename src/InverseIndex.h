@@ -1,49 +1,170 @@
 #ifndef ZDS_INVERSE_INDEX_H
 #define ZDS_INVERSE_INDEX_H
 
+#include <bit>
 #include <cstdint>
+#include <cstring>
 #include <string_view>
 #include <memory>
+#include <type_traits>
 
 #include "utils.h"
 
-constexpr uint32_t compute_shift(uint32_t x) {
-  uint32_t res = 1;
-  uint32_t shift = 31;
-  while (res < x) {
-    res <<= 1;
-    --shift;
+// Reads up to 8 bytes as a little endian word. At runtime the bytes are
+// gathered with at most two overlapping loads, which give the same word
+constexpr uint64_t load_word(const char *data, uint32_t size) {
+  if (!std::is_constant_evaluated() && std::endian::native == std::endian::little) {
+    if (size == 8) {
+      uint64_t word;
+      memcpy(&word, data, sizeof(word));
+      return word;
+    }
+    if (size >= 4) {
+      uint32_t low, high;
+      memcpy(&low, data, sizeof(low));
+      memcpy(&high, data + size - 4, sizeof(high));
+      return (uint64_t)low | ((uint64_t)high << (8 * (size - 4)));
+    }
+    if (size == 0) return 0;
+    return (uint64_t)(uint8_t)data[0] |
+           ((uint64_t)(uint8_t)data[size / 2] << (8 * (size / 2))) |
+           ((uint64_t)(uint8_t)data[size - 1] << (8 * (size - 1)));
+  }
+
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < size; ++i) word |= (uint64_t)(uint8_t)data[i] << (8 * i);
+  return word;
+}
+
+// Mixes the length and the bytes of a key, 8 at a time
+constexpr uint64_t key_mix(std::string_view key) {
+  uint64_t h = (uint64_t)key.size() * 0x9e3779b97f4a7c15;
+  uint32_t i = 0;
+  for (; i + 8 <= key.size(); i += 8) {
+    h = (h ^ load_word(key.data() + i, 8)) * 0xbf58476d1ce4e5b9;
+    h ^= h >> 31;
+  }
+  h = (h ^ load_word(key.data() + i, key.size() - i)) * 0x94d049bb133111eb;
+  return h ^ (h >> 29);
+}
+
+// Compares two keys, short ones with a single word compare instead of a call
+// to memcmp
+constexpr bool key_equal(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  if (a.size() <= 8) return load_word(a.data(), a.size()) == load_word(b.data(), b.size());
+  return a == b;
+}
+
+// Maps a key mix to a bucket in [0, count)
+constexpr uint32_t perfect_hash_bucket(uint64_t mix, uint32_t count) {
+  return (uint32_t)(((mix & 0xffffffff) * count) >> 32);
+}
+
+// Maps a key mix to a slot in [0, count) for a given seed
+constexpr uint32_t perfect_hash_slot(uint64_t mix, uint32_t seed, uint32_t count) {
+  uint64_t h = (mix ^ (seed * 0x9e3779b97f4a7c15)) * 0xff51afd7ed558ccd;
+  h ^= h >> 33;
+  return (uint32_t)(((h & 0xffffffff) * count) >> 32);
+}
+
+// Called when no seed separates the keys of a bucket, which only happens
+// with duplicate keys. Not constexpr, so it also stops compilation
+void perfect_hash_failed();
+
+// Builds a minimal perfect hash ("hash and displace") of `count` keys. Keys
+// are split into buckets, then the buckets are placed from the largest to
+// the smallest: a bucket with several keys searches for a seed sending all of
+// them to free slots, a bucket with a single key takes the next free slot
+// directly. `displace` holds the seed of each bucket, or `-(slot + 1)` for a
+// single key, and `slots` the key stored in each slot. `mixes`,
+// `bucket_start` (`count + 1` long), `bucket_keys` and `cursor` are scratch
+constexpr void build_perfect_hash(
+  const std::string_view *keys, uint32_t count, int *displace, int *slots,
+  uint64_t *mixes, uint32_t *bucket_start, uint32_t *bucket_keys, uint32_t *cursor
+) {
+  for (uint32_t i = 0; i <= count; ++i) bucket_start[i] = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    mixes[i] = key_mix(keys[i]);
+    ++bucket_start[perfect_hash_bucket(mixes[i], count) + 1];
+  }
+
+  uint32_t max_size = 0;
+  for (uint32_t b = 0; b < count; ++b) {
+    if (bucket_start[b + 1] > max_size) max_size = bucket_start[b + 1];
+    bucket_start[b + 1] += bucket_start[b];
+    cursor[b] = bucket_start[b];
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    bucket_keys[cursor[perfect_hash_bucket(mixes[i], count)]++] = i;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    slots[i] = -1;
+    displace[i] = 0;
+  }
+
+  // `cursor` now holds the slots picked for the current bucket
+  for (uint32_t size = max_size; size > 1; --size) {
+    for (uint32_t b = 0; b < count; ++b) {
+      if (bucket_start[b + 1] - bucket_start[b] != size) continue;
+
+      for (uint32_t seed = 1;; ++seed) {
+        if (seed > (1 << 24)) perfect_hash_failed();
+
+        bool placed = true;
+        for (uint32_t k = 0; k < size && placed; ++k) {
+          uint32_t slot = perfect_hash_slot(mixes[bucket_keys[bucket_start[b] + k]], seed, count);
+          if (slots[slot] != -1) placed = false;
+          for (uint32_t j = 0; j < k && placed; ++j) {
+            if (cursor[j] == slot) placed = false;
+          }
+          cursor[k] = slot;
+        }
+
+        if (placed) {
+          for (uint32_t k = 0; k < size; ++k) slots[cursor[k]] = bucket_keys[bucket_start[b] + k];
+          displace[b] = seed;
+          break;
+        }
+      }
+    }
+  }
+
+  uint32_t free_slot = 0;
+  for (uint32_t b = 0; b < count; ++b) {
+    if (bucket_start[b + 1] - bucket_start[b] != 1) continue;
+    while (slots[free_slot] != -1) ++free_slot;
+    slots[free_slot] = bucket_keys[bucket_start[b]];
+    displace[b] = -(int)free_slot - 1;
   }
-  return shift;
 }
 
+// Maps the strings of a table back to their index with a minimal perfect
+// hash built at compile time, so a lookup costs one mix and one compare
 template<uint32_t N>
 struct InverseIndex {
 public:
   constexpr InverseIndex(const std::string_view (*map)[N])
-      : idx_map{*map}, keys{{0}} {
-    for (uint32_t i = 0; i < N; ++i) {
-      uint32_t h = hash32((*map)[i].data(), (*map)[i].size(), 0x811c9dc5) >> ht_shift;
-      while (keys[h]) {
-        h = (h + 1) & (ht_size - 1);
-      }
-      keys[h] = i + 1;
-    }
+      : idx_map{*map}, displace{0}, slots{0} {
+    uint64_t mixes[N] = {};
+    uint32_t bucket_start[N + 1] = {};
+    uint32_t bucket_keys[N] = {};
+    uint32_t cursor[N] = {};
+    build_perfect_hash(*map, N, displace, slots, mixes, bucket_start, bucket_keys, cursor);
   }
 
   constexpr int operator[](std::string_view sv) const {
-    uint32_t h = hash32(sv.data(), sv.size(), 0x811c9dc5) >> ht_shift;
-    while (keys[h] && idx_map[keys[h] - 1] != sv) {
-      h = (h + 1) & (ht_size - 1);
-    }
-    return keys[h] - 1;
+    uint64_t mix = key_mix(sv);
+    int d = displace[perfect_hash_bucket(mix, N)];
+    uint32_t slot = d < 0 ? (uint32_t)(-d - 1) : perfect_hash_slot(mix, d, N);
+    int idx = slots[slot];
+    return key_equal(idx_map[idx], sv) ? idx : -1;
   }
 private:
-  static constexpr uint32_t ht_shift = compute_shift(N);
-  static constexpr uint32_t ht_size = 1 << (32 - ht_shift);
-
   const std::string_view *idx_map;
-  int keys[ht_size];
+  int displace[N];
+  int slots[N];
 };
 
 template<>
@@ -53,9 +174,9 @@ public:
   int operator[](std::string_view sv) const;
 private:
   const std::string_view *idx_map;
-  const uint32_t ht_shift;
-  const uint32_t ht_size;
-  const std::unique_ptr<int[]> keys;
+  const uint32_t count;
+  const std::unique_ptr<int[]> displace;
+  const std::unique_ptr<int[]> slots;
 };
 
 #endif
@@ -7,9 +7,9 @@ namespace SVGShapes {
 
 class Line final : public BaseShape {
 public:
-  Line(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-
-  ArrayList<BezierCurve> get_beziers() const override;
+  Line(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
+  void build_path(PathData *out) const override;
 private:
   Point p1;
   Point p2;
@@ -0,0 +1,18 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <cstddef>
+#include <string_view>
+
+// Reads a number with the SVG grammar from the start of `str`: an optional
+// sign, digits with an optional fraction and an optional exponent. Number
+// lists may omit separators ("1.5.5" is 1.5 and .5, "1e-3-2" is 1e-3 and -2).
+// Returns the number of bytes read, or 0 if `str` doesn't start with a
+// number. Never reads past the end of `str` and ignores the C locale
+size_t parse_number(std::string_view str, double *out);
+
+// Returns the number after any leading whitespace of `str`, or 0 if there is
+// none
+double to_number(std::string_view str);
+
+#endif
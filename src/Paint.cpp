@@ -1,6 +1,7 @@
 #include "Paint.h"
 
 #include "InverseIndex.h"
+#include "Number.h"
 #include <algorithm>
 #include <cctype>
 
@@ -186,16 +187,16 @@ static Paint read_color_text(std::string_view value) {
 static Paint read_RGB(std::string_view value) {
   int start = value.find('(');
   int end = value.find(',');
-  double r = strtod(value.data() + start + 1, nullptr);
+  double r = to_number(value.substr(start + 1));
 
   value = trim_start(value.substr(end + 1));
 
   end = value.find(',');
-  double g = strtod(value.data(), nullptr);
+  double g = to_number(value);
 
   value = trim_start(value.substr(end + 1));
 
-  double b = strtod(value.data(), nullptr);
+  double b = to_number(value);
 
   r /= 255;
   g /= 255;
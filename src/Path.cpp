@@ -1,718 +1,317 @@
 #include "Path.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
-#include "common.h"
+#include "Number.h"
 using namespace SVGShapes;
 
 
-static double get_vector_angle(Point u, Point v){
-  double ta = std::atan2(u[1], u[0]);
-  double tb = std::atan2(v[1], v[0]);
-
-  if (tb >= ta){
-    return tb - ta;
+// The unit circle point of each segment end is found by rotating the
+// previous one by a fixed step, a complex multiply, so the trigonometry is
+// only paid once per arc
+void arcs_to_curves(PathData *path, Point point_start, Point point_end, double rx, double ry, double angle_degree, int large_arc_flag, int sweep_flag) {
+  if (point_start[0] == point_end[0] && point_start[1] == point_end[1]) {
+    return;
   }
-  return (2 * PI) - (ta - tb);
-}
-
 
-ArrayList<BezierCurve> arcs_to_curves(Point point_start, Point point_end, double rx, double ry, double angle_degree, int large_arc_flag, int sweep_flag){
-  ArrayList<BezierCurve> arcs_list;
-  if (point_start[0] == point_end[0] && point_start[1] == point_end[1]){ 
-    return {};
+  rx = std::abs(rx);
+  ry = std::abs(ry);
+  if (rx == 0 || ry == 0) {
+    path->line_to(point_end);
+    return;
   }
 
-  if (rx == 0.0f && ry == 0.0f){
-    arcs_list.push(BezierCurve {point_start, point_end, point_start, point_end});
-    return arcs_list;
+  double sin_phi = 0;
+  double cos_phi = 1;
+  if (angle_degree != 0) {
+    sin_phi = std::sin(angle_degree * PI / 180);
+    cos_phi = std::cos(angle_degree * PI / 180);
   }
 
-  double sin_phi = std::sin(angle_degree * PI / 180);
-  double cos_phi = std::cos(angle_degree * PI / 180);
-
-  double x1_dash = cos_phi * (point_start[0] - point_end[0]) / 2.0
-                 + sin_phi * (point_start[1] - point_end[1]) / 2.0;
-  double y1_dash = -sin_phi * (point_start[0] - point_end[0]) / 2.0
-                 + cos_phi * (point_start[1] - point_end[1]) / 2.0;
-  double root;
-  double numerator = rx * rx * ry * ry - rx * rx
-                   * y1_dash * y1_dash - ry * ry * x1_dash * x1_dash;
-
-  double radius_x = rx;
-  double radius_y = ry;
-
-  if (numerator < 0.0){
-    double s = std::sqrt(1.0 - numerator / (rx * rx * ry * ry));
-    radius_x *= s;
-    radius_y *= s;
-    root = 0.0;
-  } else{
-    root = ((large_arc_flag == 1 && sweep_flag == 1) || (large_arc_flag == 0 && sweep_flag == 0) ? -1.0 : 1.0) 
-         * std::sqrt(numerator / (rx * rx * y1_dash * y1_dash + ry * ry * x1_dash * x1_dash));
+  double half_dx = (point_start[0] - point_end[0]) / 2.0;
+  double half_dy = (point_start[1] - point_end[1]) / 2.0;
+  double x1_dash = cos_phi * half_dx + sin_phi * half_dy;
+  double y1_dash = -sin_phi * half_dx + cos_phi * half_dy;
+
+  double rx_sq = rx * rx;
+  double ry_sq = ry * ry;
+  double numerator = rx_sq * ry_sq - rx_sq * y1_dash * y1_dash - ry_sq * x1_dash * x1_dash;
+
+  // Radii too small to reach the end are scaled up until they just do,
+  // which puts the center halfway
+  double root = 0;
+  if (numerator < 0) {
+    double s = std::sqrt(1.0 - numerator / (rx_sq * ry_sq));
+    rx *= s;
+    ry *= s;
+  } else {
+    root = (large_arc_flag == sweep_flag ? -1.0 : 1.0)
+         * std::sqrt(numerator / (rx_sq * y1_dash * y1_dash + ry_sq * x1_dash * x1_dash));
   }
 
-  double cx_dash = root * radius_x * y1_dash / radius_y;
-  double cy_dash = -root * radius_y * x1_dash / radius_x;
+  double cx_dash = root * rx * y1_dash / ry;
+  double cy_dash = -root * ry * x1_dash / rx;
+  Point center = {
+    cos_phi * cx_dash - sin_phi * cy_dash + (point_start[0] + point_end[0]) / 2.0,
+    sin_phi * cx_dash + cos_phi * cy_dash + (point_start[1] + point_end[1]) / 2.0,
+  };
 
-  double cx = cos_phi * cx_dash - sin_phi * cy_dash + (point_start[0] + point_end[0]) / 2.0;
-  double cy = sin_phi * cx_dash + cos_phi * cy_dash + (point_start[1] + point_end[1]) / 2.0;
+  // The ends on the unit circle, before the radii and the rotation
+  Point u = {(x1_dash - cx_dash) / rx, (y1_dash - cy_dash) / ry};
+  Point v = {(-x1_dash - cx_dash) / rx, (-y1_dash - cy_dash) / ry};
 
-  double theta1 = get_vector_angle(
-    Point{1.0, 0.0},
-    Point{(x1_dash - cx_dash) / radius_x, (y1_dash - cy_dash) / radius_y}
-  );
-  double dtheta = get_vector_angle(
-    Point{(x1_dash - cx_dash) / radius_x, (y1_dash - cy_dash) / radius_y},
-    Point{(-x1_dash - cx_dash) / radius_x, (-y1_dash - cy_dash) / radius_y}
-  ); 
-
-  if (sweep_flag == 0 && dtheta > 0){
+  double dtheta = std::atan2(u[0] * v[1] - u[1] * v[0], u[0] * v[0] + u[1] * v[1]);
+  if (sweep_flag == 0 && dtheta > 0) {
     dtheta -= 2.0 * PI;
-  } else if (sweep_flag == 1 && dtheta < 0){
+  } else if (sweep_flag != 0 && dtheta < 0) {
     dtheta += 2.0 * PI;
   }
 
-  double segments = (int)std::ceil((double)std::abs(dtheta / (PI / 2.0)));
+  // A quarter turn that rounding put just past 90 degrees stays one segment
+  int segments = std::max((int)std::ceil(std::abs(dtheta) / (PI / 2.0) - 1e-9), 1);
   double delta = dtheta / segments;
-  double t = 8.0 / 3.0 * std::sin(delta / 4.0) * std::sin(delta / 4.0) / std::sin(delta / 2.0);
-
-  double startX = point_start[0];
-  double startY = point_start[1];
-
-  for (int i = 0; i < segments; ++i){
-    double cos_theta1 = std::cos(theta1);
-    double sin_theta1 = std::sin(theta1);
-    double theta2 = theta1 + delta;
-    double cos_theta2 = std::cos(theta2);
-    double sin_theta2 = std::sin(theta2);
-
-    double end_point_X = cos_phi * radius_x * cos_theta2 - sin_phi
-                         * radius_y * sin_theta2 + cx;
-    double end_point_Y = sin_phi * radius_x * cos_theta2 + cos_phi
-                         * radius_y * sin_theta2 + cy;
-                         
-    double dx1 = t * (-cos_phi * radius_x * sin_theta1 - sin_phi * radius_y
-                 * cos_theta1);
-    double dy1 = t * (-sin_phi * radius_x * sin_theta1 + cos_phi * radius_y
-                 * cos_theta1);
-    
-    double dxe = t * (cos_phi * radius_x * sin_theta2 + sin_phi * radius_y
-                 * cos_theta2);
-    double dye = t * (sin_phi * radius_x * sin_theta2 - cos_phi * radius_y
-                 * cos_theta2);
-    if (i == 0) {
-      startX = point_start[0];
-      startY = point_start[1];
-    } else if (i == segments - 1){
-      end_point_X = point_end[0];
-      end_point_Y = point_end[1]; 
-    }
+  double step_cos = std::cos(delta);
+  double step_sin = std::sin(delta);
+
+  // The control arm length, 4/3 tan(delta / 4), from the half angle
+  // identities since the step is at most a quarter turn
+  double cos_half = std::sqrt((1 + step_cos) / 2);
+  double sin_half = std::copysign(std::sqrt((1 - step_cos) / 2), delta);
+  double t = 4.0 / 3.0 * sin_half / (1 + cos_half);
+
+  // Maps a unit circle point onto the ellipse, relative to its center
+  double m00 = cos_phi * rx;
+  double m01 = -sin_phi * ry;
+  double m10 = sin_phi * rx;
+  double m11 = cos_phi * ry;
+
+  Point start = point_start;
+  double cos_theta = u[0];
+  double sin_theta = u[1];
+  for (int i = 0; i < segments; ++i) {
+    double cos_next = cos_theta * step_cos - sin_theta * step_sin;
+    double sin_next = sin_theta * step_cos + cos_theta * step_sin;
+
+    Point end = i == segments - 1 ? point_end : center + Point {
+      m00 * cos_next + m01 * sin_next,
+      m10 * cos_next + m11 * sin_next,
+    };
+
+    // The derivative of the point at angle a is the point at a + 90 degrees
+    Point tangent_start = {
+      -m00 * sin_theta + m01 * cos_theta,
+      -m10 * sin_theta + m11 * cos_theta,
+    };
+    Point tangent_end = {
+      -m00 * sin_next + m01 * cos_next,
+      -m10 * sin_next + m11 * cos_next,
+    };
+
+    path->cubic_to(start + tangent_start * t, end - tangent_end * t, end);
+
+    start = end;
+    cos_theta = cos_next;
+    sin_theta = sin_next;
+  }
+}
+// The path commands, with the relative and absolute forms folded together
+enum PathCommand : uint8_t {
+  PATH_COMMAND_NONE = 0,
+  PATH_COMMAND_MOVE,
+  PATH_COMMAND_LINE,
+  PATH_COMMAND_HORIZONTAL,
+  PATH_COMMAND_VERTICAL,
+  PATH_COMMAND_CUBIC,
+  PATH_COMMAND_SMOOTH_CUBIC,
+  PATH_COMMAND_QUAD,
+  PATH_COMMAND_SMOOTH_QUAD,
+  PATH_COMMAND_ARC,
+  PATH_COMMAND_CLOSE,
+  PATH_COMMAND_COUNT,
+};
+
+// How many numbers one repetition of each command reads
+constexpr uint32_t path_command_args[PATH_COMMAND_COUNT] = {0, 2, 2, 1, 1, 6, 4, 4, 2, 7, 0};
+
+// What a byte of path data means to the tokenizer
+struct PathChar {
+  PathCommand command;
+  bool relative;
+  bool separator;
+};
+
+static constexpr std::array<PathChar, 256> make_path_chars() {
+  std::array<PathChar, 256> chars = {};
+  constexpr std::string_view letters = "MLHVCSQTAZ";
+  constexpr PathCommand commands[] = {
+    PATH_COMMAND_MOVE, PATH_COMMAND_LINE, PATH_COMMAND_HORIZONTAL,
+    PATH_COMMAND_VERTICAL, PATH_COMMAND_CUBIC, PATH_COMMAND_SMOOTH_CUBIC,
+    PATH_COMMAND_QUAD, PATH_COMMAND_SMOOTH_QUAD, PATH_COMMAND_ARC,
+    PATH_COMMAND_CLOSE,
+  };
+  for (size_t i = 0; i < letters.size(); ++i) {
+    chars[(uint8_t)letters[i]] = {commands[i], false, false};
+    chars[(uint8_t)(letters[i] - 'A' + 'a')] = {commands[i], true, false};
+  }
+  for (char chr : std::string_view(" \t\n\v\f\r,")) {
+    chars[(uint8_t)chr].separator = true;
+  }
+  return chars;
+}
 
-    arcs_list.push(BezierCurve {
-      Point{startX, startY},
-      Point{end_point_X, end_point_Y},
-      Point{startX + dx1, startY + dy1},
-      Point{end_point_X + dxe, end_point_Y + dye}
-    });
+constexpr std::array<PathChar, 256> path_chars = make_path_chars();
 
-    theta1 = theta2;
-    startX = end_point_X;
-    startY = end_point_Y;
-  }
-   
-  return arcs_list;
+// Rough sizes of path data per point and per verb, so the path is sized
+// once for typical data. Denser data still grows the lists as needed
+constexpr uint32_t PATH_BYTES_PER_POINT = 8;
+constexpr uint32_t PATH_BYTES_PER_VERB = 16;
+
+static const char *skip_separators(const char *p, const char *end) {
+  while (p != end && path_chars[(uint8_t)*p].separator) ++p;
+  return p;
 }
 
-static bool is_next_command(char chr) {
-  switch (chr) {
-    case 'M': return true;
-    case 'm': return true;
-    case 'L': return true;
-    case 'l': return true;
-    case 'H': return true;
-    case 'h': return true;
-    case 'V': return true;
-    case 'v': return true;
-    case 'C': return true;
-    case 'c': return true;
-    case 'S': return true;
-    case 's': return true;
-    case 'Q': return true;
-    case 'q': return true;
-    case 'T': return true;
-    case 't': return true;
-    case 'A': return true;
-    case 'a': return true;
-    case 'Z': return true;
-    case 'z': return true;
-    default: return false;
+// Reads the numbers of one repetition of `command` into `args`, returns
+// where they end or null if they are not all there. Arc flags are a single
+// digit, so "a1 1 0 01 2 3" needs no separators between them
+static const char *read_args(const char *p, const char *end, PathCommand command, double *args) {
+  for (uint32_t i = 0; i < path_command_args[command]; ++i) {
+    p = skip_separators(p, end);
+    if (command == PATH_COMMAND_ARC && (i == 3 || i == 4)) {
+      if (p == end || (*p != '0' && *p != '1')) return nullptr;
+      args[i] = *p - '0';
+      ++p;
+    } else {
+      size_t len = parse_number(std::string_view(p, end - p), &args[i]);
+      if (len == 0) return nullptr;
+      p += len;
+    }
   }
+  return skip_separators(p, end);
 }
 
-Path::Path(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles)
-  : BaseShape(attrs, attrs_count, parent, styles) {
-
-  for (int i = 0; i < attrs_count; ++i) {
-    std::string_view key = attrs[i].key;
-    std::string_view value = attrs[i].value;
-    if (key == "d") {
-      Point current_point;
-      Point start_point;
-      Point pre_control_point;
-
-      value = trim_start(value);
-      while (!value.empty()) {
-        char command = value[0];
-        value = value.substr(1);
-        switch (command) {
-          case 'M': {
-            // read 2 points 
-            double x = read_double(&value);
-            double y = read_double(&value);
-            current_point = {x, y};
-            pre_control_point = current_point; 
-           
-
-            start_point = current_point;
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              x = read_double(&value);
-              y = read_double(&value);
-              Point des_point = {x, y};
-              Point mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-              current_point = {x, y};
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'm': {
-            double dx = read_double(&value);
-            double dy = read_double(&value);
-            current_point[0] += dx;
-            current_point[1] += dy;
-            start_point = current_point;
-            pre_control_point = current_point; 
-              
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              dx = read_double(&value);
-              dy = read_double(&value);
-              Point des_point = {current_point[0] + dx, current_point[1] + dy};
-              Point mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-              //update current
-              current_point[0] += dx;
-              current_point[1] += dy;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'L': {
-            // read 2 points 
-            double x = read_double(&value);
-            double y = read_double(&value);
-            Point des_point = {x, y};
-            Point mid_point = (current_point + des_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-              //update current
-
-            current_point = des_point;
-            pre_control_point = current_point; 
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              x = read_double(&value);
-              y = read_double(&value);
-              des_point[0] = x;
-              des_point[1] = y;
-              mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-              current_point = des_point;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'l': {
-            double dx = read_double(&value);
-            double dy = read_double(&value);
-            Point des_point = {current_point[0] + dx, current_point[1] + dy};
-            Point mid_point = (current_point + des_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-            current_point = des_point;
-            pre_control_point = current_point; 
-              
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              double dx = read_double(&value);
-              double dy = read_double(&value);
-              Point des_point = {current_point[0] + dx, current_point[1] + dy};
-              mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-              //update current_point
-              current_point = des_point;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'H': {
-            double x = read_double(&value);
-            Point des_point = {x, current_point[1]};
-            Point mid_point = (current_point + des_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-            current_point = des_point;
-            pre_control_point = current_point; 
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              x = read_double(&value);
-              Point des_point = {x, current_point[1]};
-              mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-              current_point = des_point;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'h': {
-            double dx = read_double(&value);
-            Point des_point = {current_point[0] + dx, current_point[1]};
-            Point mid_point = (current_point + des_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-            current_point = des_point;
-            pre_control_point = current_point; 
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              dx = read_double(&value);
-              Point des_point = {current_point[0] + dx, current_point[1]};
-              mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-              current_point = des_point;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'V': {
-            double y = read_double(&value);
-            Point des_point = {current_point[0], y};
-            Point mid_point = (current_point + des_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-            current_point = des_point;
-            pre_control_point = current_point; 
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              y = read_double(&value);
-              Point des_point = {current_point[0], y};
-              mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-              current_point = des_point;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'v': {
-            double dy = read_double(&value);
-            Point des_point = {current_point[0], current_point[1] + dy};
-            Point mid_point = (current_point + des_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-            current_point = des_point;
-            pre_control_point = current_point; 
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              dy = read_double(&value);
-              Point des_point = {current_point[0], current_point[1] + dy};
-              mid_point = (current_point + des_point) / 2;
-              this->bezier_list.push(BezierCurve{current_point, des_point, mid_point, mid_point});
-
-              current_point = des_point;
-              pre_control_point = current_point; 
-            }
-          } break;
-
-          case 'C': {
-            double x[3];
-            double y[3];
-            for (int i = 0; i < 3; ++i) {
-              x[i] = read_double(&value);
-              y[i] = read_double(&value);
-            }
-            Point point_cs = {x[0], y[0]};
-            Point point_ce = {x[1], y[1]};
-            Point point_n = {x[2], y[2]};
-            pre_control_point = point_ce;
-            this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-            current_point = point_n;
-            pre_control_point = point_ce; 
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) ) {
-              for (int i = 0; i < 3; ++i) {
-                x[i] = read_double(&value);
-                y[i] = read_double(&value);
-              }
-
-              Point point_cs = {x[0], y[0]};
-              Point point_ce = {x[1], y[1]};
-              Point point_n = {x[2], y[2]};
-
-              this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-              current_point = point_n;
-              pre_control_point = point_ce;
-            }
-          } break;
-
-          case 'c': {
-            double x[3];
-            double y[3];
-            for (int i = 0; i < 3; ++i) {
-              x[i] = read_double(&value);
-              y[i] = read_double(&value);
-            }
-            Point point_cs = {x[0] + current_point[0], y[0] + current_point[1]};
-            Point point_ce = {x[1] + current_point[0], y[1] + current_point[1]};
-            Point point_n = {x[2] + current_point[0], y[2] + current_point[1]};
-
-            this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-            current_point = point_n;
-            pre_control_point = point_ce;
-            
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              for (int i = 0; i < 3; ++i) {
-                x[i] = read_double(&value);
-                y[i] = read_double(&value);
-              }
-              Point point_cs = {x[0] + current_point[0], y[0] + current_point[1]};
-              Point point_ce = {x[1] + current_point[0], y[1] + current_point[1]};
-              Point point_n = {x[2] + current_point[0], y[2] + current_point[1]};
-
-              this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-              current_point = point_n;
-              pre_control_point = point_ce;
-            }
-          } break;
-
-          case 'S': {
-            double x[2];
-            double y[2];
-            for (int i = 0; i < 2; ++i) {
-              x[i] = read_double(&value);
-              y[i] = read_double(&value);
-            }
-            Point point_ce = {x[0], y[0]};
-            Point point_n = {x[1], y[1]};
-            Point point_cs = {
-              current_point[0] - pre_control_point[0] + current_point[0],
-              current_point[1] - pre_control_point[1] + current_point[1],
-            };
-
-            this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-            current_point = point_n;
-            pre_control_point = point_ce;
-            
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              for (int i = 0; i < 2; ++i) {
-                x[i] = read_double(&value);
-                y[i] = read_double(&value);
-              }
-              Point point_ce = {x[0], y[0]};
-              Point point_n = {x[1], y[1]};
-              Point point_cs = {
-                current_point[0] - pre_control_point[0] + current_point[0],
-                current_point[1] - pre_control_point[1] + current_point[1],
-              };
-
-              this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-              current_point = point_n;
-              pre_control_point = point_ce;
-            }
-          } break;
-
-          case 's': {
-            double x[2];
-            double y[2];
-            for (int i = 0; i < 2; ++i) {
-              x[i] = read_double(&value);
-              y[i] = read_double(&value);
-            }
-            Point point_ce = {x[0] + current_point[0], y[0] + current_point[1]};
-            Point point_n = {x[1] + current_point[0], y[1] + current_point[1]};
-            Point point_cs = {
-              current_point[0] - pre_control_point[0] + current_point[0],
-              current_point[1] - pre_control_point[1] + current_point[1],
-            };
-
-            this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-            current_point = point_n;
-            pre_control_point = point_ce;
-            
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              for (int i = 0; i < 2; ++i) {
-                x[i] = read_double(&value);
-                y[i] = read_double(&value);
-              }
-              Point point_ce = {x[0] + current_point[0], y[0] + current_point[1]};
-              Point point_n = {x[1] + current_point[0], y[1] + current_point[1]};
-              Point point_cs = {
-                current_point[0] - pre_control_point[0] + current_point[0],
-                current_point[1] - pre_control_point[1] + current_point[1],
-              };
-
-              this->bezier_list.push(BezierCurve{current_point, point_n, point_cs, point_ce});
-              current_point = point_n;
-              pre_control_point = point_ce;
-            }
-          } break;
-
-          case 'Q': {
-            double x[2];
-            double y[2];
-            for (int i = 0; i < 2; ++i) {
-              x[i] = read_double(&value);
-              y[i] = read_double(&value);
-            }
-            Point point_c = {x[0], y[0]};
-            Point point_n = {x[1], y[1]};
-            
-            Point c1 = (2 * point_c + current_point) / 3;
-            Point c2 = (2 * point_c + point_n) / 3;
-
-            this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-            current_point = point_n;
-            pre_control_point = point_c;
-            
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0])) {
-              //read next point
-              double x[2];
-              double y[2];
-              for (int i = 0; i < 2; ++i) {
-                x[i] = read_double(&value);
-                y[i] = read_double(&value);
-              }
-              Point point_c = {x[0], y[0]};
-              Point point_n = {x[1], y[1]};
-
-              Point c1 = (2 * point_c + current_point) / 3;
-              Point c2 = (2 * point_c + point_n) / 3;
-
-              this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-              current_point = point_n;
-              pre_control_point = point_c;
-            }
-          } break;
-
-          case 'q': { //d_point_n, d_point_c (from current point)
-            double x[2];
-            double y[2];
-            for (int i = 0; i < 2; ++i) {
-              x[i] = read_double(&value);
-              y[i] = read_double(&value);
-            }
-            Point point_c = {x[0] + current_point[0], y[0] + current_point[1]};
-            Point point_n = {x[1] + current_point[0], y[1] + current_point[1]};
-
-            Point c1 = (2 * point_c + current_point) / 3;
-            Point c2 = (2 * point_c + point_n) / 3;
-
-            this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-            current_point = point_n;
-            pre_control_point = point_c;
-            
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0])) {
-              //read next point
-              double x[2];
-              double y[2];
-              for (int i = 0; i < 2; ++i) {
-                x[i] = read_double(&value);
-                y[i] = read_double(&value);
-              }
-              Point point_c = {x[0] + current_point[0], y[0] + current_point[1]};
-              Point point_n = {x[1] + current_point[0], y[1] + current_point[1]};
-
-              Point c1 = (2 * point_c + current_point) / 3;
-              Point c2 = (2 * point_c + point_n) / 3;
-
-              this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-              current_point = point_n;
-              pre_control_point = point_c;
-            }
-          } break;
-
-          case 'T': {//quadratic abnormal, Input the end of previous bezier curve 
-            double x = read_double(&value);
-            double y = read_double(&value);
-            Point point_n = {x, y};
-            Point point_c = {
-              current_point[0] - pre_control_point[0] + current_point[0],
-              current_point[1] - pre_control_point[1] + current_point[1],
-            };
-
-            Point c1 = (2 * point_c + current_point) / 3;
-            Point c2 = (2 * point_c + point_n) / 3;
-
-            this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-            current_point = {x, y};
-            pre_control_point = point_c;
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              x = read_double(&value);
-              y = read_double(&value);
-              point_n[0] = x;
-              point_n[1] = y;
-              Point point_c = {
-                current_point[0] - pre_control_point[0] + current_point[0],
-                current_point[1] - pre_control_point[1] + current_point[1],
-              };
-
-              Point c1 = (2 * point_c + current_point) / 3;
-              Point c2 = (2 * point_c + point_n) / 3;
-              this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-              current_point = {x, y};
-              pre_control_point = point_c;
-            }
-          } break;
-
-          case 't': {
-            double x = read_double(&value);
-            double y = read_double(&value);
-            Point point_n = {current_point[0] + x, current_point[0] + y};
-            Point point_c = {
-              current_point[0] - pre_control_point[0] + current_point[0],
-              current_point[1] - pre_control_point[1] + current_point[1],
-            };
-
-            Point c1 = (2 * point_c + current_point) / 3;
-            Point c2 = (2 * point_c + point_n) / 3;
-
-            //control point will be the previous control point
-            this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-            current_point[0] += x;
-            current_point[1] += y;
-            pre_control_point = point_c;
-
-            //supsequent parameter
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              x = read_double(&value);
-              y = read_double(&value);
-              Point point_n = {current_point[0] + x, current_point[1] + y};
-              Point point_c = {
-                current_point[0] - pre_control_point[0] + current_point[0],
-                current_point[1] - pre_control_point[1] + current_point[1],
-              };
-
-              Point c1 = (2 * point_c + current_point) / 3;
-              Point c2 = (2 * point_c + point_n) / 3;
-
-              //control point will be the previous control point
-              this->bezier_list.push(BezierCurve{current_point, point_n, c1, c2});
-              current_point[0] += x;
-              current_point[1] += y;
-              pre_control_point = point_c;
-            }
-          } break;
-          case 'A': {
-            double rx, ry;
-            double angle_degree;  
-            int large_arc_flag;   
-            int sweep_flag;       
-            Point point_n;
-
-            rx = read_double(&value);
-            ry = read_double(&value);
-            angle_degree = read_double(&value);  
-            large_arc_flag = (int)read_double(&value);   
-            sweep_flag = (int)read_double(&value);   
-            point_n[0] = read_double(&value);
-            point_n[1] = read_double(&value);
-
-            this->bezier_list.append(arcs_to_curves(current_point, point_n, rx, ry, angle_degree, large_arc_flag, sweep_flag));
-            current_point = this->bezier_list[this->bezier_list.len() - 1].end;
-
-            pre_control_point = current_point;
-
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              rx = read_double(&value);
-              ry = read_double(&value);
-              angle_degree = read_double(&value);  
-              large_arc_flag = (int)read_double(&value);   
-              sweep_flag = (int)read_double(&value);   
-              point_n[0] = read_double(&value);
-              point_n[1] = read_double(&value);
-
-              this->bezier_list.append(arcs_to_curves(current_point, point_n, rx, ry, angle_degree, large_arc_flag, sweep_flag));
-
-              current_point = this->bezier_list[this->bezier_list.len() - 1].end;
-              pre_control_point = current_point;
-            }
-          } break;
-
-          case 'a': {
-            double rx, ry;
-            double angle_degree;  
-            int large_arc_flag;   
-            int sweep_flag;       
-            Point point_n;
-
-            rx = read_double(&value);
-            ry = read_double(&value);
-            angle_degree = read_double(&value);  
-            large_arc_flag = (int)read_double(&value);   
-            sweep_flag = (int)read_double(&value);   
-            point_n[0] = current_point[0] + read_double(&value);
-            point_n[1] = current_point[1] + read_double(&value);
-
-            this->bezier_list.append(arcs_to_curves(current_point, point_n, rx, ry, angle_degree, large_arc_flag, sweep_flag));
-
-            current_point = this->bezier_list[this->bezier_list.len() - 1].end;
-            pre_control_point = current_point;
-
-            while (!value.empty() && !is_next_command(value[0]) )  {
-              rx = read_double(&value);
-              ry = read_double(&value);
-              angle_degree = read_double(&value);  
-              large_arc_flag = (int)read_double(&value);   
-              sweep_flag = (int)read_double(&value);   
-              point_n[0] = current_point[0] + read_double(&value);
-              point_n[1] = current_point[1] + read_double(&value);
-              this->bezier_list.append(arcs_to_curves(current_point, point_n, rx, ry, angle_degree, large_arc_flag, sweep_flag));
-
-              current_point = this->bezier_list[this->bezier_list.len() - 1].end;
-              pre_control_point = current_point;
-            }
-          } break;
-
-          case 'Z': 
-          case 'z': {
-            Point mid_point = (current_point + start_point) / 2;
-            this->bezier_list.push(BezierCurve{current_point, start_point, mid_point, mid_point});
-            while (!value.empty() && (isspace(value[0]) || value[0] == ',')) {
-              value = value.substr(1);
-            }
-            current_point = start_point;
-          } break;
+// Appends the segments of the path data `value` to `path`. Data in error
+// ends the path, keeping the segments before it
+static void parse_path_data(std::string_view value, PathData *path) {
+  const char *p = value.data();
+  const char *end = p + value.size();
+  path->reserve(value.size() / PATH_BYTES_PER_VERB + 1, value.size() / PATH_BYTES_PER_POINT + 1);
+
+  Point current = {0, 0};
+  Point start = {0, 0};
+  // The last control point of the previous command, when it was a curve
+  Point last_control = {0, 0};
+  PathCommand previous = PATH_COMMAND_NONE;
+
+  p = skip_separators(p, end);
+  while (p != end) {
+    PathChar chr = path_chars[(uint8_t)*p];
+    if (chr.command == PATH_COMMAND_NONE) return;
+    ++p;
+
+    PathCommand command = chr.command;
+    if (command == PATH_COMMAND_CLOSE) {
+      path->close();
+      current = start;
+      previous = command;
+      p = skip_separators(p, end);
+      continue;
+    }
+
+    // The command repeats for as long as numbers follow it
+    do {
+      double args[7];
+      p = read_args(p, end, command, args);
+      if (p == nullptr) return;
+
+      Point origin = chr.relative ? current : Point {0, 0};
+      switch (command) {
+        case PATH_COMMAND_MOVE: {
+          current = origin + Point {args[0], args[1]};
+          start = current;
+          path->move_to(current);
+        } break;
+
+        case PATH_COMMAND_LINE: {
+          current = origin + Point {args[0], args[1]};
+          path->line_to(current);
+        } break;
+
+        case PATH_COMMAND_HORIZONTAL: {
+          current[0] = origin[0] + args[0];
+          path->line_to(current);
+        } break;
+
+        case PATH_COMMAND_VERTICAL: {
+          current[1] = origin[1] + args[0];
+          path->line_to(current);
+        } break;
+
+        case PATH_COMMAND_CUBIC: {
+          Point control_start = origin + Point {args[0], args[1]};
+          last_control = origin + Point {args[2], args[3]};
+          current = origin + Point {args[4], args[5]};
+          path->cubic_to(control_start, last_control, current);
+        } break;
+
+        case PATH_COMMAND_SMOOTH_CUBIC: {
+          // The first control point mirrors the last one of a cubic before
+          Point control_start = current;
+          if (previous == PATH_COMMAND_CUBIC || previous == PATH_COMMAND_SMOOTH_CUBIC) {
+            control_start = 2 * current - last_control;
+          }
+          last_control = origin + Point {args[0], args[1]};
+          current = origin + Point {args[2], args[3]};
+          path->cubic_to(control_start, last_control, current);
+        } break;
+
+        case PATH_COMMAND_QUAD: {
+          last_control = origin + Point {args[0], args[1]};
+          current = origin + Point {args[2], args[3]};
+          path->quad_to(last_control, current);
+        } break;
+
+        case PATH_COMMAND_SMOOTH_QUAD: {
+          // The control point mirrors the one of a quadratic before
+          Point control = current;
+          if (previous == PATH_COMMAND_QUAD || previous == PATH_COMMAND_SMOOTH_QUAD) {
+            control = 2 * current - last_control;
+          }
+          last_control = control;
+          current = origin + Point {args[0], args[1]};
+          path->quad_to(control, current);
+        } break;
+
+        case PATH_COMMAND_ARC: {
+          Point point_end = origin + Point {args[5], args[6]};
+          arcs_to_curves(path, current, point_end, args[0], args[1], args[2], (int)args[3], (int)args[4]);
+          current = point_end;
+        } break;
+
+        case PATH_COMMAND_NONE:
+        case PATH_COMMAND_CLOSE:
+        case PATH_COMMAND_COUNT: {
+          __builtin_unreachable();
         }
       }
-    }
+      previous = command;
+
+      // Pairs after the first one of a move draw lines
+      if (command == PATH_COMMAND_MOVE) command = PATH_COMMAND_LINE;
+    } while (p != end && path_chars[(uint8_t)*p].command == PATH_COMMAND_NONE);
   }
 }
 
-ArrayList<BezierCurve> Path::get_beziers() const {
-  return this->bezier_list.clone();
+Path::Path(const AttributeSet *attrs, BaseShape *parent, ParseContext *context)
+  : BaseShape(attrs, parent, context), path_data{context->arena} {
+  this->kind = SHAPE_KIND_PATH;
+
+  if (attrs->has(ELEMENT_ATTR_D)) {
+    parse_path_data((*attrs)[ELEMENT_ATTR_D], &this->path_data);
+  }
+}
+
+
+const PathData &Path::path() const {
+  return this->path_data;
 }
@@ -3,15 +3,22 @@
 
 #include "BaseShape.h"  
 
+// Appends the elliptical arc from `point_start` to `point_end` to `path` as
+// cubic segments of at most a quarter turn each, following the endpoint to
+// center conversion of the SVG implementation notes. The path must already
+// be at `point_start`
+void arcs_to_curves(PathData *path, Point point_start, Point point_end, double rx, double ry, double angle_degree, int large_arc_flag, int sweep_flag);
+
 namespace SVGShapes {
 
 class Path: public BaseShape{
 public:
-  Path(Attribute *attrs, int attrs_countt, BaseShape *parent, StyleSheet *styles);
+  Path(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
 
-  ArrayList<BezierCurve> get_beziers() const override;
+  // The segments are parsed straight into the shape, there is nothing to build
+  const PathData &path() const override;
 private:
-  ArrayList<BezierCurve> bezier_list;
+  PathData path_data;
 };
 
 };
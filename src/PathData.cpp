@@ -0,0 +1,118 @@
+#include "PathData.h"
+
+BezierCurve elevate_quad(Point start, Point control, Point end) {
+  Point control_start = (2 * control + start) / 3;
+  Point control_end = (2 * control + end) / 3;
+  return BezierCurve {start, end, control_start, control_end};
+}
+
+PathData::PathData() :
+  subpath_start{0} {}
+
+PathData::PathData(Arena *arena) :
+  verbs{arena},
+  points{arena},
+  subpath_start{0} {}
+
+void PathData::move_to(Point p) {
+  if (this->verbs.len() && this->verbs[this->verbs.len() - 1] == PATH_VERB_MOVE) {
+    this->points[this->points.len() - 1] = p;
+    return;
+  }
+
+  this->subpath_start = this->points.len();
+  this->verbs.push(PATH_VERB_MOVE);
+  this->points.push(p);
+}
+
+void PathData::begin_segment() {
+  if (this->verbs.len() == 0) {
+    this->move_to(Point {0, 0});
+  } else if (this->verbs[this->verbs.len() - 1] == PATH_VERB_CLOSE) {
+    this->move_to(this->points[this->subpath_start]);
+  }
+}
+
+void PathData::line_to(Point p) {
+  this->begin_segment();
+  this->verbs.push(PATH_VERB_LINE);
+  this->points.push(p);
+}
+
+void PathData::quad_to(Point control, Point p) {
+  this->begin_segment();
+  this->verbs.push(PATH_VERB_QUAD);
+  this->points.push(control);
+  this->points.push(p);
+}
+
+void PathData::cubic_to(Point control_start, Point control_end, Point p) {
+  this->begin_segment();
+  this->verbs.push(PATH_VERB_CUBIC);
+  this->points.push(control_start);
+  this->points.push(control_end);
+  this->points.push(p);
+}
+
+void PathData::close() {
+  if (this->verbs.len() == 0) return;
+
+  PathVerb last = this->verbs[this->verbs.len() - 1];
+  if (last == PATH_VERB_CLOSE) return;
+  this->verbs.push(PATH_VERB_CLOSE);
+}
+
+void PathData::clear() {
+  this->verbs.resize(0);
+  this->points.resize(0);
+  this->subpath_start = 0;
+}
+
+void PathData::reserve(uint32_t verbs, uint32_t points) {
+  this->verbs.reserve(this->verbs.len() + verbs);
+  this->points.reserve(this->points.len() + points);
+}
+
+void PathData::to_beziers(ArrayList<BezierCurve> *out) const {
+  const Point *point = this->points.begin();
+  Point start = {0, 0};
+  Point current = {0, 0};
+
+  for (PathVerb verb : this->verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        start = point[0];
+        current = point[0];
+      } break;
+
+      case PATH_VERB_LINE: {
+        Point mid = (current + point[0]) / 2;
+        out->push(BezierCurve {current, point[0], mid, mid});
+        current = point[0];
+      } break;
+
+      case PATH_VERB_QUAD: {
+        out->push(elevate_quad(current, point[0], point[1]));
+        current = point[1];
+      } break;
+
+      case PATH_VERB_CUBIC: {
+        out->push(BezierCurve {current, point[2], point[0], point[1]});
+        current = point[2];
+      } break;
+
+      case PATH_VERB_CLOSE: {
+        if (current[0] != start[0] || current[1] != start[1]) {
+          Point mid = (current + start) / 2;
+          out->push(BezierCurve {current, start, mid, mid});
+        }
+        current = start;
+      } break;
+
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      }
+    }
+    point += path_verb_points[verb];
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef PATH_DATA_H
+#define PATH_DATA_H
+
+#include <cstdint>
+
+#include "ArrayList.h"
+#include "Arena.h"
+#include "Matrix.h"
+
+class BezierCurve {
+public:
+  Point start;
+  Point end;
+  Point control_start;
+  Point control_end;
+};
+
+enum PathVerb : uint8_t {
+  PATH_VERB_MOVE = 0,
+  PATH_VERB_LINE,
+  PATH_VERB_QUAD,
+  PATH_VERB_CUBIC,
+  PATH_VERB_CLOSE,
+  PATH_VERB_COUNT,
+};
+
+// The number of points each verb consumes, the start of a segment is the
+// last point of the one before it
+constexpr uint32_t path_verb_points[PATH_VERB_COUNT] = {1, 1, 2, 3, 0};
+
+// Returns the cubic that traces the same curve as the quadratic segment
+BezierCurve elevate_quad(Point start, Point control, Point end);
+
+// A path as a stream of verbs and a packed array of the points they consume.
+// Every subpath starts with a move and ends either open or with a close, so
+// figures are explicit. Straight segments cost one verb and one point
+class PathData {
+public:
+  ArrayList<PathVerb> verbs;
+  ArrayList<Point> points;
+
+  PathData();
+
+  // Creates an empty path whose lists are allocated from `arena`
+  explicit PathData(Arena *arena);
+
+  // Starts a new subpath at `p`. Consecutive moves collapse into the last one
+  void move_to(Point p);
+
+  // Adds a segment from the current point. Drawing without a subpath starts
+  // one at the start of the last closed subpath, or at the origin
+  void line_to(Point p);
+  void quad_to(Point control, Point p);
+  void cubic_to(Point control_start, Point control_end, Point p);
+
+  // Closes the current subpath back to its first point
+  void close();
+
+  // Forgets every segment, keeping the storage
+  void clear();
+
+  // Makes room for `verbs` more verbs and `points` more points
+  void reserve(uint32_t verbs, uint32_t points);
+
+  // Appends the path as cubic curves, for code that has not moved to verbs.
+  // Moves are dropped, lines and closes become cubics with both control
+  // points on the middle of the segment, and closes that are already at the
+  // start of their subpath add nothing
+  void to_beziers(ArrayList<BezierCurve> *out) const;
+private:
+  void begin_segment();
+
+  // Index in `points` of the first point of the current subpath
+  uint32_t subpath_start;
+};
+
+#endif
@@ -1,59 +1,48 @@
 #include "Polygon.h"
 #include "common.h"
+#include "Number.h"
 
 using namespace SVGShapes;
 
 
-static ArrayList<Point> read_point(std::string_view str) {
-  ArrayList<Point> point_list;
+static ArrayList<Point> read_point(std::string_view str, Arena *arena) {
+  ArrayList<Point> point_list {arena};
   Point new_point;
   while (str.size()) {
     str = trim_start(str);
-    char *out;
-    new_point[0] = strtod(str.data(), &out);
-    if (out == str.data()) break;
-    str = str.substr(out - str.data());
+    size_t len = parse_number(str, &new_point[0]);
+    if (len == 0) break;
+    str = str.substr(len);
       
     str = trim_start(str);
-    new_point[1] = strtod(str.data(), &out);
-    if (out == str.data()) break;
-    str = str.substr(out - str.data());
+    len = parse_number(str, &new_point[1]);
+    if (len == 0) break;
+    str = str.substr(len);
 
     point_list.push(new_point);
   }
   return point_list;
 }
 
-Polygon::Polygon(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles) :
-  BaseShape(attrs, attrs_count, parent, styles) {
-  for (int i = 0; i < attrs_count; ++i){
-    std::string_view key = attrs[i].key;
-    std::string_view value = attrs[i].value;
+Polygon::Polygon(const AttributeSet *attrs, BaseShape *parent, ParseContext *context) :
+  BaseShape(attrs, parent, context),
+  point_list{context->arena} {
+  this->kind = SHAPE_KIND_POLYGON;
 
-    if (key == "points"){
-      this->point_list = read_point(value);
-    }
+  if (attrs->has(ELEMENT_ATTR_POINTS)) {
+    this->point_list = read_point((*attrs)[ELEMENT_ATTR_POINTS], context->arena);
   }
 }
 
-ArrayList<BezierCurve> Polygon::get_beziers() const {
-  ArrayList<BezierCurve> curves;
+void Polygon::build_path(PathData *out) const {
+  if (this->point_list.len() == 0) return;
 
+  out->move_to(this->point_list[0]);
   for (uint32_t i = 1; i < this->point_list.len(); ++i) {
-    Point start = this->point_list[i - 1];
-    Point end = this->point_list[i];
-    Point mid = (start + end) / 2;
-
-    curves.push(BezierCurve {start, end, mid, mid});
+    out->line_to(this->point_list[i]);
   }
 
   if (this->point_list.len() > 2) {
-    Point start = this->point_list[this->point_list.len() - 1];
-    Point end = this->point_list[0];
-    Point mid = (start + end) / 2;
-
-    curves.push(BezierCurve {start, end, mid, mid});
+    out->close();
   }
-
-  return curves;
 }
@@ -7,9 +7,9 @@ namespace SVGShapes {
 
 class Polygon final : public BaseShape{
 public:
-  Polygon(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-
-  virtual ArrayList<BezierCurve> get_beziers() const override;
+  Polygon(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
+  void build_path(PathData *out) const override;
 private:
   ArrayList<Point> point_list;
 };
@@ -7,9 +7,9 @@ namespace SVGShapes {
 
 class Polyline final : public BaseShape {
 public:
-  Polyline(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-
-  ArrayList<BezierCurve> get_beziers() const override;
+  Polyline(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
+  void build_path(PathData *out) const override;
 private:
   ArrayList<Point> point_list;
 };
@@ -0,0 +1,493 @@
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Flatten.h"
+#include "Stroke.h"
+#include "Transform.h"
+
+// Outlines with more points than this per pixel around their box are
+// simplified after flattening
+constexpr double RASTER_SIMPLIFY_DENSITY = 4;
+
+// Returns `x * 255`, divided by 255 and rounded, for `x` up to 255 * 255
+static uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+// Draws the premultiplied `color` over `pixel`, `coverage` out of 255 of it
+static void blend(uint8_t *pixel, const uint8_t *color, uint32_t coverage) {
+  uint32_t keep = 255 - div255(color[3] * coverage);
+  pixel[0] = (uint8_t)(div255(color[0] * coverage) + div255(pixel[0] * keep));
+  pixel[1] = (uint8_t)(div255(color[1] * coverage) + div255(pixel[1] * keep));
+  pixel[2] = (uint8_t)(div255(color[2] * coverage) + div255(pixel[2] * keep));
+  pixel[3] = (uint8_t)(div255(color[3] * coverage) + div255(pixel[3] * keep));
+}
+
+static void premultiply(const DisplayColor &color, uint8_t *out) {
+  double a = std::clamp(color.a, 0.0, 1.0);
+  out[0] = (uint8_t)(std::clamp(color.r, 0.0, 1.0) * a * 255 + 0.5);
+  out[1] = (uint8_t)(std::clamp(color.g, 0.0, 1.0) * a * 255 + 0.5);
+  out[2] = (uint8_t)(std::clamp(color.b, 0.0, 1.0) * a * 255 + 0.5);
+  out[3] = (uint8_t)(a * 255 + 0.5);
+}
+
+// Turns the winding accumulated at a pixel into how much of it is covered
+static float coverage(float winding, FillRule rule) {
+  float area = std::abs(winding);
+  switch (rule) {
+    case FILL_RULE_NONZERO: {
+      return std::min(area, 1.0f);
+    } break;
+    case FILL_RULE_EVENODD: {
+      area = std::fmod(area, 2.0f);
+      return area > 1 ? 2 - area : area;
+    } break;
+    case FILL_RULE_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+  __builtin_unreachable();
+}
+
+// Returns the index into a ramp of the gradient parameter `t`
+static uint32_t ramp_index(double t, SpreadMethod spread) {
+  switch (spread) {
+    case SPREAD_METHOD_PAD: {
+      t = std::clamp(t, 0.0, 1.0);
+    } break;
+    case SPREAD_METHOD_REFLECT: {
+      t = std::fmod(std::abs(t), 2.0);
+      if (t > 1) t = 2 - t;
+    } break;
+    case SPREAD_METHOD_REPEAT: {
+      t -= std::floor(t);
+    } break;
+    case SPREAD_METHOD_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+
+  if (!(t >= 0 && t <= 1)) t = 0;
+  return (uint32_t)(t * 255 + 0.5);
+}
+
+// Returns the box around the points of `lines`, empty ones have their min
+// above their max
+static AABB lines_box(const PathData &lines) {
+  AABB box = {Point {INFINITY, INFINITY}, Point {-INFINITY, -INFINITY}};
+  for (Point p : lines.points) {
+    box.min = Point {std::min(box.min[0], p[0]), std::min(box.min[1], p[1])};
+    box.max = Point {std::max(box.max[0], p[0]), std::max(box.max[1], p[1])};
+  }
+  return box;
+}
+
+static bool invert(const Transform &transform, Transform *out) {
+  double det = transform.m[0][0] * transform.m[1][1] - transform.m[0][1] * transform.m[1][0];
+  if (!(std::abs(det) > 0) || !std::isfinite(det)) return false;
+
+  out->m[0][0] = transform.m[1][1] / det;
+  out->m[0][1] = -transform.m[0][1] / det;
+  out->m[1][0] = -transform.m[1][0] / det;
+  out->m[1][1] = transform.m[0][0] / det;
+  out->d = -(out->m * transform.d);
+  return true;
+}
+
+// Adds the edge from (`x0`, `y0`) down to (`x1`, `y1`) to the rows of
+// `cells`, `direction` being -1 for edges going up. The edge must lie within
+// the area, which is `width` pixels wide. Each row gets the area on the right
+// of the edge in each pixel it crosses, minus that of the pixel before, so
+// summing a row from the left gives the winding at each pixel. After "How to
+// rasterize font glyphs really fast" by Raph Levien
+static void accumulate(
+  float *cells, uint32_t stride, float width,
+  float x0, float y0, float x1, float y1, float direction
+) {
+  if (!(y0 < y1)) return;
+
+  float dxdy = (x1 - x0) / (y1 - y0);
+  float x = x0;
+  uint32_t y_end = (uint32_t)std::ceil(y1);
+
+  for (uint32_t y = (uint32_t)y0; y < y_end; ++y) {
+    float *row = cells + (size_t)y * stride;
+    float dy = std::min((float)(y + 1), y1) - std::max((float)y, y0);
+
+    // Rounding must not step out of the area
+    float x_next = std::clamp(x + dxdy * dy, 0.0f, width);
+    float d = dy * direction;
+
+    float left = std::min(x, x_next);
+    float right = std::max(x, x_next);
+    float left_floor = std::floor(left);
+    float right_ceil = std::ceil(right);
+    uint32_t left_index = (uint32_t)left_floor;
+    uint32_t right_index = (uint32_t)right_ceil;
+
+    if (right_index <= left_index + 1) {
+      // Within one pixel, the area on the right of the edge is set by the
+      // middle of the edge
+      float middle = 0.5f * (x + x_next) - left_floor;
+      row[left_index] += d - d * middle;
+      row[left_index + 1] += d * middle;
+    } else {
+      // Across pixels, the area grows linearly between the triangles at
+      // both ends
+      float slope = 1 / (right - left);
+      float left_fract = left - left_floor;
+      float first = 0.5f * slope * (1 - left_fract) * (1 - left_fract);
+      float right_fract = right - right_ceil + 1;
+      float last = 0.5f * slope * right_fract * right_fract;
+
+      row[left_index] += d * first;
+      if (right_index == left_index + 2) {
+        row[left_index + 1] += d * (1 - first - last);
+      } else {
+        float second = slope * (1.5f - left_fract);
+        row[left_index + 1] += d * (second - first);
+        for (uint32_t i = left_index + 2; i < right_index - 1; ++i) {
+          row[i] += d * slope;
+        }
+        float before_last = second + (float)(right_index - left_index - 3) * slope;
+        row[right_index - 1] += d * (1 - before_last - last);
+      }
+      row[right_index] += d * last;
+    }
+
+    x = x_next;
+  }
+}
+
+Rasterizer::Rasterizer() :
+  device{},
+  flattened{},
+  dashed{},
+  shape{},
+  cells{},
+  cells_width{0},
+  cells_height{0},
+  cells_stride{0},
+  mask{},
+  ramp{} {}
+
+void Rasterizer::draw(const DisplayList *list, const Transform &view, const RasterTarget &target) {
+  for (const DisplayItem &item : list->items) {
+    this->draw_item(list, item, view, target);
+  }
+}
+
+void Rasterizer::draw_item(const DisplayList *list, const DisplayItem &item, const Transform &view, const RasterTarget &target) {
+  if (item.kind == DISPLAY_ITEM_TEXT) return;
+
+  // Items whose box misses the target are skipped before anything is
+  // flattened
+  AABB box = transform_box(view, item.bounds);
+  if (!(box.max[0] > target.x && box.min[0] < target.x + target.width)) return;
+  if (!(box.max[1] > target.y && box.min[1] < target.y + target.height)) return;
+
+  AABB clip = {
+    Point {(double)target.x, (double)target.y},
+    Point {(double)target.x + target.width, (double)target.y + target.height},
+  };
+  this->prepare(list, item, view, clip, &this->shape);
+  this->paint(list, item, this->shape, view, target);
+}
+
+void Rasterizer::prepare(
+  const DisplayList *list, const DisplayItem &item, const Transform &view, const AABB &clip, RasterShape *out
+) {
+  out->fill.clear();
+  out->stroke.clear();
+  out->stroke_coverage = 1;
+  if (item.kind == DISPLAY_ITEM_TEXT) return;
+
+  this->device.clear();
+  this->device.verbs.extend(list->verbs.begin() + item.geometry.verbs.start, item.geometry.verbs.count);
+  this->device.points.resize(item.geometry.points.count);
+  transform_points(
+    view, list->points.begin() + item.geometry.points.start, this->device.points.begin(), item.geometry.points.count
+  );
+
+  // Dense outlines are simplified as `FlattenCache` does, dropping points
+  // closer together than a pixel can show. Others are flattened to the
+  // whole tolerance, simplifying them costs more than it saves
+  AABB box = transform_box(view, item.bounds);
+  double perimeter = 2 * ((box.max[0] - box.min[0]) + (box.max[1] - box.min[1]));
+  if (item.geometry.points.count > perimeter * RASTER_SIMPLIFY_DENSITY) {
+    this->flattened.clear();
+    flatten_path(this->device, FLATTEN_TOLERANCE * (1 - FLATTEN_SIMPLIFY_SHARE), &this->flattened);
+    simplify_lines(this->flattened, FLATTEN_TOLERANCE * FLATTEN_SIMPLIFY_SHARE, &out->fill);
+  } else {
+    flatten_path(this->device, FLATTEN_TOLERANCE, &out->fill);
+  }
+  out->fill_box = lines_box(out->fill);
+
+  if (item.stroke != DISPLAY_NO_PAINT) {
+    const DisplayStroke &stroke = list->strokes[item.stroke_style];
+    double scale = std::sqrt(std::abs(view.m[0][0] * view.m[1][1] - view.m[0][1] * view.m[1][0]));
+
+    StrokeOutline outline = {stroke.width * scale, stroke.miter_limit, stroke.join, stroke.cap};
+    const PathData *path = &out->fill;
+    if (stroke.dash_count > 0) {
+      double dashes[8];
+      for (int i = 0; i < stroke.dash_count; ++i) dashes[i] = stroke.dash_array[i] * scale;
+
+      // Dashes are only made where their outline can reach the clip, with a
+      // pixel to spare
+      double reach = outline.width / 2 * std::max(outline.miter_limit, std::sqrt(2.0)) + 1;
+      AABB dash_clip = {clip.min - Point {reach, reach}, clip.max + Point {reach, reach}};
+
+      this->dashed.clear();
+      out->stroke_coverage = (float)dash_lines(
+        out->fill, dashes, stroke.dash_count, stroke.dash_offset * scale, dash_clip, &this->dashed
+      );
+      path = &this->dashed;
+    }
+
+    stroke_lines(*path, outline, FLATTEN_TOLERANCE, &out->stroke);
+    out->stroke_box = lines_box(out->stroke);
+  }
+}
+
+void Rasterizer::paint(
+  const DisplayList *list, const DisplayItem &item, const RasterShape &shape,
+  const Transform &view, const RasterTarget &target
+) {
+  if (item.fill != DISPLAY_NO_PAINT) {
+    this->fill(shape.fill, shape.fill_box, item.fill_rule, 1, list, item.fill, view, target);
+  }
+  if (item.stroke != DISPLAY_NO_PAINT) {
+    this->fill(shape.stroke, shape.stroke_box, FILL_RULE_NONZERO, shape.stroke_coverage, list, item.stroke, view, target);
+  }
+}
+
+void Rasterizer::fill(
+  const PathData &lines, const AABB &box, FillRule rule, float opacity,
+  const DisplayList *list, uint32_t index, const Transform &view, const RasterTarget &target
+) {
+  // Only the pixels under the lines are covered
+  double left = target.x;
+  double top = target.y;
+  double right = left + target.width;
+  double bottom = top + target.height;
+  if (!(box.max[0] > left && box.max[1] > top && box.min[0] < right && box.min[1] < bottom)) return;
+
+  uint32_t x0 = (uint32_t)std::max(std::floor(box.min[0]), left);
+  uint32_t y0 = (uint32_t)std::max(std::floor(box.min[1]), top);
+  uint32_t x1 = (uint32_t)std::min(std::ceil(box.max[0]), right);
+  uint32_t y1 = (uint32_t)std::min(std::ceil(box.max[1]), bottom);
+
+  this->cells_width = x1 - x0;
+  this->cells_height = y1 - y0;
+  this->cells_stride = this->cells_width + 2;
+  this->cells.resize(this->cells_stride * this->cells_height);
+  std::fill(this->cells.begin(), this->cells.end(), 0.0f);
+
+  // Every subpath is closed back to its start, as filling asks
+  Point origin = {(double)x0, (double)y0};
+  const Point *point = lines.points.begin();
+  Point start = {};
+  Point current = {};
+  for (PathVerb verb : lines.verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        this->add_edge(current - origin, start - origin);
+        start = current = *point++;
+      } break;
+      case PATH_VERB_LINE:
+      case PATH_VERB_QUAD:
+      case PATH_VERB_CUBIC: {
+        point += path_verb_points[verb];
+        this->add_edge(current - origin, point[-1] - origin);
+        current = point[-1];
+      } break;
+      case PATH_VERB_CLOSE: {
+        this->add_edge(current - origin, start - origin);
+        current = start;
+      } break;
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      } break;
+    }
+  }
+  this->add_edge(current - origin, start - origin);
+
+  const DisplayPaint &paint = list->paints[index];
+  uint8_t color[4] = {};
+  Transform to_paint = Transform::identity();
+  if (paint.kind == DISPLAY_PAINT_SOLID) {
+    premultiply(paint.color, color);
+  } else {
+    if (!invert(view * paint.transform, &to_paint)) return;
+    this->build_ramp(list, index);
+  }
+
+  // The gradient parameter is a function of the pixel in paint space
+  Point start_point = paint.start;
+  Point axis = paint.end - paint.start;
+  double axis_length = axis[0] * axis[0] + axis[1] * axis[1];
+  if (axis_length > 0) axis = axis / axis_length;
+
+  // A focus outside the circle is moved back inside, as SVG 1.1 asks
+  Point focus = paint.end;
+  Point to_focus = paint.end - paint.start;
+  double focus_distance = std::sqrt(to_focus[0] * to_focus[0] + to_focus[1] * to_focus[1]);
+  if (focus_distance > paint.radius * 0.99) {
+    focus = paint.start + to_focus * (paint.radius * 0.99 / focus_distance);
+  }
+  Point center = paint.start - focus;
+  double a = center[0] * center[0] + center[1] * center[1] - paint.radius * paint.radius;
+
+  Point step = {to_paint.m[0][0], to_paint.m[1][0]};
+  bool opaque = color[3] == 255;
+  this->mask.resize(this->cells_width);
+  uint8_t *mask = this->mask.begin();
+
+  for (uint32_t y = 0; y < this->cells_height; ++y) {
+    // The row is summed into coverage first, so painting only visits the
+    // covered pixels
+    const float *row = this->cells.begin() + (size_t)y * this->cells_stride;
+    float winding = 0;
+    for (uint32_t x = 0; x < this->cells_width; ++x) {
+      winding += row[x];
+      mask[x] = (uint8_t)(coverage(winding, rule) * opacity * 255 + 0.5f);
+    }
+
+    uint8_t *pixel = target.pixels + (size_t)(y0 + y - target.y) * target.stride + (size_t)(x0 - target.x) * 4;
+    Point p = to_paint * Point {x0 + 0.5, y0 + y + 0.5};
+    switch (paint.kind) {
+      case DISPLAY_PAINT_SOLID: {
+        for (uint32_t x = 0; x < this->cells_width; ++x, pixel += 4) {
+          if (mask[x] == 255 && opaque) memcpy(pixel, color, 4);
+          else if (mask[x] != 0) blend(pixel, color, mask[x]);
+        }
+      } break;
+      case DISPLAY_PAINT_LINEAR: {
+        for (uint32_t x = 0; x < this->cells_width; ++x, pixel += 4, p = p + step) {
+          if (mask[x] == 0) continue;
+          double t = 1;
+          if (axis_length > 0) t = (p[0] - start_point[0]) * axis[0] + (p[1] - start_point[1]) * axis[1];
+          blend(pixel, this->ramp[ramp_index(t, paint.spread)], mask[x]);
+        }
+      } break;
+      case DISPLAY_PAINT_RADIAL: {
+        for (uint32_t x = 0; x < this->cells_width; ++x, pixel += 4, p = p + step) {
+          if (mask[x] == 0) continue;
+
+          // The circle through `p` between the focus, at 0, and the whole
+          // circle, at 1
+          double t = 1;
+          if (paint.radius > 0) {
+            Point d = p - focus;
+            double b = d[0] * center[0] + d[1] * center[1];
+            double c = d[0] * d[0] + d[1] * d[1];
+            t = (b - std::sqrt(b * b - a * c)) / a;
+          }
+          blend(pixel, this->ramp[ramp_index(t, paint.spread)], mask[x]);
+        }
+      } break;
+      case DISPLAY_PAINT_COUNT: {
+        __builtin_unreachable();
+      } break;
+    }
+  }
+}
+
+void Rasterizer::add_edge(Point p0, Point p1) {
+  if (p0[1] == p1[1]) return;
+
+  double direction = 1;
+  if (p0[1] > p1[1]) {
+    std::swap(p0, p1);
+    direction = -1;
+  }
+
+  // Only the part across the rows of the area adds anything
+  double width = this->cells_width;
+  double height = this->cells_height;
+  if (p1[1] <= 0 || p0[1] >= height) return;
+
+  // Most edges are within the area, only those crossing its sides need
+  // clipping
+  double left = std::min(p0[0], p1[0]);
+  double right = std::max(p0[0], p1[0]);
+  if (p0[1] >= 0 && p1[1] <= height && left >= 0 && right <= width) {
+    accumulate(
+      this->cells.begin(), this->cells_stride, (float)width,
+      (float)p0[0], (float)p0[1], (float)p1[0], (float)p1[1], (float)direction
+    );
+    return;
+  }
+  if (!(std::isfinite(p0[0]) && std::isfinite(p1[0]))) return;
+
+  double dxdy = (p1[0] - p0[0]) / (p1[1] - p0[1]);
+  if (p0[1] < 0) p0 = Point {p0[0] - p0[1] * dxdy, 0};
+  if (p1[1] > height) p1 = Point {p1[0] + (height - p1[1]) * dxdy, height};
+
+  // Split where the edge crosses the sides of the area. A part on the left
+  // covers its whole rows, so it moves onto the left side, one on the right
+  // covers nothing
+  double splits[4] = {0, 1, 1, 1};
+  uint32_t split_count = 1;
+  double dx = p1[0] - p0[0];
+  for (double side : {0.0, width}) {
+    double t = (side - p0[0]) / dx;
+    if (t > 0 && t < 1) splits[split_count++] = t;
+  }
+  if (split_count == 3 && splits[1] > splits[2]) std::swap(splits[1], splits[2]);
+  splits[split_count] = 1;
+
+  for (uint32_t i = 0; i < split_count; ++i) {
+    Point a = p0 + (p1 - p0) * splits[i];
+    Point b = p0 + (p1 - p0) * splits[i + 1];
+    double middle = (a[0] + b[0]) / 2;
+    if (middle >= width) continue;
+
+    a[0] = std::clamp(a[0], 0.0, width);
+    b[0] = std::clamp(b[0], 0.0, width);
+    a[1] = std::clamp(a[1], 0.0, height);
+    b[1] = std::clamp(b[1], 0.0, height);
+    if (!(a[1] < b[1])) continue;
+
+    accumulate(
+      this->cells.begin(), this->cells_stride, (float)width,
+      (float)a[0], (float)a[1], (float)b[0], (float)b[1], (float)direction
+    );
+  }
+}
+
+void Rasterizer::build_ramp(const DisplayList *list, uint32_t index) {
+  const DisplayPaint &paint = list->paints[index];
+  const DisplayStop *stops = list->stops.begin() + paint.stops.start;
+  uint32_t count = paint.stops.count;
+
+  // Colors are blended straight and premultiplied after
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < 256; ++i) {
+    double t = i / 255.0;
+    while (next < count && stops[next].offset <= t) ++next;
+
+    DisplayColor color;
+    if (next == 0) {
+      color = stops[0].color;
+    } else if (next == count) {
+      color = stops[count - 1].color;
+    } else {
+      const DisplayStop &s0 = stops[next - 1];
+      const DisplayStop &s1 = stops[next];
+      double f = (t - s0.offset) / (s1.offset - s0.offset);
+      color = DisplayColor {
+        s0.color.r + (s1.color.r - s0.color.r) * f,
+        s0.color.g + (s1.color.g - s0.color.g) * f,
+        s0.color.b + (s1.color.b - s0.color.b) * f,
+        s0.color.a + (s1.color.a - s0.color.a) * f,
+      };
+    }
+    premultiply(color, this->ramp[i]);
+  }
+}
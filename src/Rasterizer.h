@@ -0,0 +1,101 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bounds.h"
+#include "DisplayList.h"
+#include "PathData.h"
+
+// A premultiplied RGBA8 image owned by the caller, rows are `stride` bytes
+// apart. It shows the device pixels from (`x`, `y`), so a tile of a larger
+// image is drawn like the whole of it
+struct RasterTarget {
+  uint8_t *pixels;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  size_t stride;
+};
+
+// The outlines of an item in device space, ready to be painted into any
+// number of targets
+struct RasterShape {
+  PathData fill;
+  PathData stroke;
+  AABB fill_box;
+  AABB stroke_box;
+
+  // How much of the coverage of `stroke` is painted, less than all for dash
+  // patterns too fine to draw
+  float stroke_coverage;
+};
+
+// Draws display lists into RGBA8 images on the CPU, without any platform
+// library. Each pixel is covered by the exact area of the outline over it,
+// accumulated along the edges and summed across each row. Curves are
+// flattened and strokes outlined in device space, so both are as precise at
+// every zoom. Text is not drawn, laying out glyphs needs a font engine the
+// core does not have
+class Rasterizer {
+public:
+  Rasterizer();
+
+  // Draws every item of `list` over `target`, `view` maps the world onto
+  // its pixels
+  void draw(const DisplayList *list, const Transform &view, const RasterTarget &target);
+
+  // Draws the single `item` of `list`, for callers that pick the items
+  void draw_item(const DisplayList *list, const DisplayItem &item, const Transform &view, const RasterTarget &target);
+
+  // Flattens and strokes `item` of `list` for `view` into `out`, to be
+  // painted within `clip` in device space. Text has no outlines
+  void prepare(
+    const DisplayList *list, const DisplayItem &item, const Transform &view, const AABB &clip, RasterShape *out
+  );
+
+  // Paints `item` of `list` into `target` from the outlines `prepare` made
+  // of it for `view`
+  void paint(
+    const DisplayList *list, const DisplayItem &item, const RasterShape &shape,
+    const Transform &view, const RasterTarget &target
+  );
+private:
+  // Covers `lines`, in device space within `box`, under `rule` and paints
+  // the covered pixels of `target` with `opacity` of the paint at `index`
+  void fill(
+    const PathData &lines, const AABB &box, FillRule rule, float opacity,
+    const DisplayList *list, uint32_t index, const Transform &view, const RasterTarget &target
+  );
+
+  // Adds the edge from `p0` to `p1` to `cells`, in the coordinates of the
+  // area being covered
+  void add_edge(Point p0, Point p1);
+
+  // Fills `ramp` with the colors of the gradient at `index` of `list`
+  void build_ramp(const DisplayList *list, uint32_t index);
+
+  // Scratch kept across items so drawing does not allocate once warm
+  PathData device;
+  PathData flattened;
+  PathData dashed;
+  RasterShape shape;
+
+  // The area covered in each pixel, minus that of the pixel on its left.
+  // Rows are `cells_stride` apart and have room past their last pixel for
+  // edges on its right side
+  ArrayList<float> cells;
+  uint32_t cells_width;
+  uint32_t cells_height;
+  uint32_t cells_stride;
+
+  // The coverage of each pixel of the row being painted, out of 255
+  ArrayList<uint8_t> mask;
+
+  // Premultiplied colors along the current gradient
+  uint8_t ramp[256][4];
+};
+
+#endif
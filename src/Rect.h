@@ -7,9 +7,9 @@ namespace SVGShapes {
 
 class Rect final : public BaseShape {
 public:  
-  Rect(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-
-  ArrayList<BezierCurve> get_beziers() const override;
+  Rect(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
+  void build_path(PathData *out) const override;
 private:
   double x;
   double y;
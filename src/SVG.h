@@ -32,8 +32,8 @@ public:
   AxisAlignType align_x;
   AxisAlignType align_y;
 
-  SVG(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-
+  SVG(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
+protected:
   AABB get_bounding() const override;
 };
 
@@ -0,0 +1,130 @@
+#include "Scanner.h"
+
+#include <bit>
+#include <cstdint>
+
+#include "Cpu.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+static size_t scan_byte_scalar(const char *data, size_t size, char a) {
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] == a) return i;
+  }
+  return size;
+}
+
+static size_t scan_either_scalar(const char *data, size_t size, char a, char b) {
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] == a || data[i] == b) return i;
+  }
+  return size;
+}
+
+#ifdef CPU_X86
+
+static size_t scan_byte_sse2(const char *data, size_t size, char a) {
+  __m128i va = _mm_set1_epi8(a);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, va));
+    if (mask) return i + std::countr_zero(mask);
+  }
+  return i + scan_byte_scalar(data + i, size - i, a);
+}
+
+static size_t scan_either_sse2(const char *data, size_t size, char a, char b) {
+  __m128i va = _mm_set1_epi8(a);
+  __m128i vb = _mm_set1_epi8(b);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+    if (mask) return i + std::countr_zero(mask);
+  }
+  return i + scan_either_scalar(data + i, size - i, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_byte_avx2(const char *data, size_t size, char a) {
+  __m256i va = _mm256_set1_epi8(a);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(data + i));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, va));
+    if (mask) return i + std::countr_zero(mask);
+  }
+  return i + scan_byte_sse2(data + i, size - i, a);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_either_avx2(const char *data, size_t size, char a, char b) {
+  __m256i va = _mm256_set1_epi8(a);
+  __m256i vb = _mm256_set1_epi8(b);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(data + i));
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(block, va), _mm256_cmpeq_epi8(block, vb));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+    if (mask) return i + std::countr_zero(mask);
+  }
+  return i + scan_either_sse2(data + i, size - i, a, b);
+}
+
+#endif
+
+static size_t (*const scan_byte_fns[SCAN_LEVEL_COUNT])(const char*, size_t, char) = {
+  scan_byte_scalar,
+#ifdef CPU_X86
+  scan_byte_sse2,
+  scan_byte_avx2,
+#else
+  scan_byte_scalar,
+  scan_byte_scalar,
+#endif
+};
+
+static size_t (*const scan_either_fns[SCAN_LEVEL_COUNT])(const char*, size_t, char, char) = {
+  scan_either_scalar,
+#ifdef CPU_X86
+  scan_either_sse2,
+  scan_either_avx2,
+#else
+  scan_either_scalar,
+  scan_either_scalar,
+#endif
+};
+
+ScanLevel detect_scan_level() {
+#ifdef CPU_X86
+  if (cpu_has_avx2()) return SCAN_LEVEL_AVX2;
+  return SCAN_LEVEL_SSE2;
+#else
+  return SCAN_LEVEL_SCALAR;
+#endif
+}
+
+static ScanLevel scan_level = detect_scan_level();
+
+void set_scan_level(ScanLevel level) {
+  ScanLevel supported = detect_scan_level();
+  scan_level = level < supported ? level : supported;
+}
+
+ScanLevel get_scan_level() {
+  return scan_level;
+}
+
+size_t scan_byte(std::string_view data, size_t from, char a) {
+  if (from >= data.size()) return data.size();
+  return from + scan_byte_fns[scan_level](data.data() + from, data.size() - from, a);
+}
+
+size_t scan_either(std::string_view data, size_t from, char a, char b) {
+  if (from >= data.size()) return data.size();
+  return from + scan_either_fns[scan_level](data.data() + from, data.size() - from, a, b);
+}
@@ -0,0 +1,29 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <cstddef>
+#include <string_view>
+
+enum ScanLevel {
+  SCAN_LEVEL_SCALAR = 0,
+  SCAN_LEVEL_SSE2,
+  SCAN_LEVEL_AVX2,
+  SCAN_LEVEL_COUNT,
+};
+
+// Returns the best scanning level the running CPU supports
+ScanLevel detect_scan_level();
+
+// Overrides the level chosen at startup, clamped to what the CPU supports
+void set_scan_level(ScanLevel level);
+ScanLevel get_scan_level();
+
+// Returns the index of the first `a` in `data` at or after `from`, or
+// `data.size()` if there is none
+size_t scan_byte(std::string_view data, size_t from, char a);
+
+// Returns the index of the first `a` or `b` in `data` at or after `from`, or
+// `data.size()` if there is none
+size_t scan_either(std::string_view data, size_t from, char a, char b);
+
+#endif
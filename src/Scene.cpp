@@ -0,0 +1,67 @@
+#include "Scene.h"
+
+static bool transform_equal(const Transform &a, const Transform &b) {
+  for (size_t i = 0; i < 4; ++i) {
+    if (a.m.data[i] != b.m.data[i]) return false;
+  }
+  return a.d.data[0] == b.d.data[0] && a.d.data[1] == b.d.data[1];
+}
+
+Scene build_scene(const ParseResult *result) {
+  Scene scene;
+  scene.document = result;
+
+  // Each path is copied in while its shape is at hand, along with the
+  // bounds kept next to it
+  for (const BaseShape *shape = result->shapes; shape; shape = shape->next) {
+    const PathData &path = shape->path();
+    scene.shapes.push(shape);
+    scene.bounds.push(shape->world_bounds());
+    scene.geometry.push(ScenePath {
+      SceneRange {scene.paths.verbs.len(), path.verbs.len()},
+      SceneRange {scene.paths.points.len(), path.points.len()},
+    });
+    scene.paths.verbs.append(path.verbs);
+    scene.paths.points.append(path.points);
+  }
+
+  uint32_t count = scene.shapes.len();
+  scene.kinds.resize(count);
+  scene.parents.resize(count);
+  scene.style_indices.resize(count);
+  scene.transform_indices.resize(count);
+
+  // Children are listed before their parent, so walking backwards is a
+  // depth first walk in which every parent comes before its children. The
+  // stack holds the ancestors of the current node
+  ArrayList<uint32_t> ancestors;
+  for (uint32_t i = count; i-- > 0;) {
+    const BaseShape *shape = scene.shapes[i];
+    scene.kinds[i] = shape->kind;
+
+    while (ancestors.len() && scene.shapes[ancestors[ancestors.len() - 1]] != shape->parent) {
+      ancestors.pop();
+    }
+    uint32_t parent = ancestors.len() ? ancestors[ancestors.len() - 1] : SCENE_NO_PARENT;
+    scene.parents[i] = parent;
+    ancestors.push(i);
+
+    scene.style_indices[i] = shape->style;
+
+    // Most nodes share the transform of their parent or of the node before
+    // them, which is enough to collapse the common cases
+    uint32_t transform_index = scene.transforms.len();
+    if (parent != SCENE_NO_PARENT &&
+        transform_equal(scene.transforms[scene.transform_indices[parent]], shape->transform)) {
+      transform_index = scene.transform_indices[parent];
+    } else if (transform_index &&
+               transform_equal(scene.transforms[transform_index - 1], shape->transform)) {
+      transform_index -= 1;
+    } else {
+      scene.transforms.push(shape->transform);
+    }
+    scene.transform_indices[i] = transform_index;
+  }
+
+  return scene;
+}
@@ -0,0 +1,58 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstdint>
+
+#include "parser.h"
+
+constexpr uint32_t SCENE_NO_PARENT = UINT32_MAX;
+
+// A slice of one of the buffers of a `Scene`
+struct SceneRange {
+  uint32_t start;
+  uint32_t count;
+};
+
+// Where the path of one node lives in `Scene::paths`
+struct ScenePath {
+  SceneRange verbs;
+  SceneRange points;
+};
+
+// A flat copy of a parsed document. Node `i` is described by the `i`th entry
+// of every per-node array, in the same painting order as `ParseResult::shapes`,
+// so traversals walk memory linearly instead of chasing `next` pointers.
+// Styles and transforms are shared between nodes through indices, styles
+// being those of the document's `StylePool`, and the paths of every node
+// live in one segment buffer, in the coordinates of the node
+struct Scene {
+  ArrayList<ShapeKind> kinds;
+  ArrayList<uint32_t> parents;
+  ArrayList<uint32_t> style_indices;
+  ArrayList<uint32_t> transform_indices;
+  ArrayList<ScenePath> geometry;
+
+  // The bounds of each node in world space, strokes left out
+  ArrayList<AABB> bounds;
+
+  // The shapes the nodes were built from, for what only the tree knows
+  // (text content, viewports...)
+  ArrayList<const BaseShape*> shapes;
+
+  const ParseResult *document;
+  ArrayList<Transform> transforms;
+  PathData paths;
+
+  // Returns the number of nodes
+  uint32_t len() const { return this->kinds.len(); }
+
+  const ComputedStyle &style(uint32_t node) const { return this->document->styles[this->style_indices[node]]; }
+  const Transform &transform(uint32_t node) const { return this->transforms[this->transform_indices[node]]; }
+};
+
+// Compiles the shape list of `result` into a `Scene`, reading the paths the
+// shapes keep rather than building new ones. The scene keeps views into
+// `result`, which must outlive it
+Scene build_scene(const ParseResult *result);
+
+#endif
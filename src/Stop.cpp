@@ -69,7 +69,8 @@ Stop read_stop(Attribute *attrs, int attribute_count) {
         result.offset = convert_percent(value);
       } break;
       case STOP_STYLE: {
-        ArrayList<Attribute> attrs_style = process_style(value);
+        ArrayList<Attribute> attrs_style;
+        process_style(value, &attrs_style);
         apply_style(&result, attrs_style.begin(), attrs_style.len());
       } break;
       case STOP_COUNT: {
@@ -0,0 +1,410 @@
+#include "Stroke.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "utils.h"
+
+// Turns sharper than this, in the cross product of the unit directions, get
+// a join, flatter ones are taken as straight
+constexpr double STROKE_STRAIGHT_CROSS = 1e-9;
+
+// Dash patterns repeating within less than this are drawn as an even line,
+// in the units of the lines
+constexpr double DASH_MIN_PERIOD = 0.25;
+
+// Dash boundaries a subpath may have within the clip, the rest of it is left
+// out past them
+constexpr uint32_t DASH_MAX_PER_SUBPATH = 1 << 20;
+
+static bool same_point(Point a, Point b) {
+  return a[0] == b[0] && a[1] == b[1];
+}
+
+static double length(Point v) {
+  return std::sqrt(v[0] * v[0] + v[1] * v[1]);
+}
+
+static double dot(Point a, Point b) {
+  return a[0] * b[0] + a[1] * b[1];
+}
+
+static double cross(Point a, Point b) {
+  return a[0] * b[1] - a[1] * b[0];
+}
+
+// The unit direction turned a quarter towards +y from +x
+static Point normal(Point direction) {
+  return Point {-direction[1], direction[0]};
+}
+
+// Calls `visit` with the points of each subpath of `lines` and whether it is
+// closed. Points repeating the one before are dropped, as is the last point
+// of a closed subpath that repeats its first. Lone moves draw nothing and are
+// skipped, a subpath of one point is a segment of zero length
+template<typename F>
+static void for_each_polyline(const PathData &lines, ArrayList<Point> *polyline, F visit) {
+  const Point *point = lines.points.begin();
+  bool drawn = false;
+  polyline->resize(0);
+
+  auto add = [&](Point p) {
+    if (polyline->len() == 0 || !same_point((*polyline)[polyline->len() - 1], p)) polyline->push(p);
+  };
+
+  for (PathVerb verb : lines.verbs) {
+    switch (verb) {
+      case PATH_VERB_MOVE: {
+        if (drawn) visit(polyline->begin(), polyline->len(), false);
+        polyline->resize(0);
+        drawn = false;
+        add(*point++);
+      } break;
+      case PATH_VERB_LINE:
+      case PATH_VERB_QUAD:
+      case PATH_VERB_CUBIC: {
+        // Only lines are expected, the end of a curve stands for it
+        point += path_verb_points[verb];
+        add(point[-1]);
+        drawn = true;
+      } break;
+      case PATH_VERB_CLOSE: {
+        if (polyline->len() > 1 && same_point((*polyline)[0], (*polyline)[polyline->len() - 1])) {
+          polyline->pop();
+        }
+        visit(polyline->begin(), polyline->len(), true);
+
+        // Drawing on after a close starts from the start of the subpath
+        Point start = (*polyline)[0];
+        polyline->resize(0);
+        polyline->push(start);
+        drawn = false;
+      } break;
+      case PATH_VERB_COUNT: {
+        __builtin_unreachable();
+      } break;
+    }
+  }
+
+  if (drawn) visit(polyline->begin(), polyline->len(), false);
+}
+
+// Clips the segment from `a` to `b` to `clip`, returns whether any of it is
+// left and the share of the segment at which that part starts and ends
+static bool clip_segment(Point a, Point b, const AABB &clip, double *enter, double *exit) {
+  double lo = 0;
+  double hi = 1;
+  for (int axis = 0; axis < 2; ++axis) {
+    double delta = b[axis] - a[axis];
+    double min = clip.min[axis] - a[axis];
+    double max = clip.max[axis] - a[axis];
+    if (delta == 0) {
+      if (min > 0 || max < 0) return false;
+      continue;
+    }
+
+    double t0 = min / delta;
+    double t1 = max / delta;
+    if (t0 > t1) std::swap(t0, t1);
+    lo = std::max(lo, t0);
+    hi = std::min(hi, t1);
+  }
+
+  *enter = lo;
+  *exit = hi;
+  return lo <= hi;
+}
+
+double dash_lines(
+  const PathData &lines, const double *dashes, int count, double offset, const AABB &clip, PathData *out
+) {
+  double pattern[16];
+  int pattern_count = count % 2 == 1 ? count * 2 : count;
+  double total = 0;
+  double drawn = 0;
+  bool drawable = count > 0 && count <= 8;
+  for (int i = 0; drawable && i < pattern_count; ++i) {
+    pattern[i] = dashes[i % count];
+    drawable = pattern[i] >= 0;
+    total += pattern[i];
+    if (i % 2 == 0) drawn += pattern[i];
+  }
+
+  if (!drawable || !(total > 0)) {
+    out->verbs.append(lines.verbs);
+    out->points.append(lines.points);
+    return 1;
+  }
+
+  // Finer than pixels can show, the dashes blend into an even line
+  if (total < DASH_MIN_PERIOD) {
+    out->verbs.append(lines.verbs);
+    out->points.append(lines.points);
+    return drawn / total;
+  }
+
+  double phase = std::fmod(offset, total);
+  if (phase < 0) phase += total;
+
+  ArrayList<Point> polyline;
+  for_each_polyline(lines, &polyline, [&](const Point *points, uint32_t point_count, bool closed) {
+    // Every subpath starts the pattern over
+    int index = 0;
+    double left = 0;
+    bool on = true;
+
+    // Moves `distance` along the pattern without drawing, whole periods at
+    // once
+    auto skip = [&](double distance) {
+      if (distance < left) {
+        left -= distance;
+        return;
+      }
+
+      distance = std::fmod(distance - left, total);
+      index = (index + 1) % pattern_count;
+      while (distance >= pattern[index]) {
+        distance -= pattern[index];
+        index = (index + 1) % pattern_count;
+      }
+      left = pattern[index] - distance;
+      on = index % 2 == 0;
+    };
+
+    left = pattern[0];
+    skip(phase);
+
+    if (point_count == 1) {
+      double enter, exit;
+      if (on && clip_segment(points[0], points[0], clip, &enter, &exit)) {
+        out->move_to(points[0]);
+        out->line_to(points[0]);
+      }
+      return;
+    }
+
+    // Whether the last dash reaches the end of the segment before, so the
+    // next segment goes on with it
+    bool drawing = false;
+    uint32_t boundaries = 0;
+    uint32_t segment_count = closed ? point_count : point_count - 1;
+    for (uint32_t i = 0; i < segment_count; ++i) {
+      Point a = points[i];
+      Point b = points[(i + 1) % point_count];
+      double segment = length(b - a);
+      if (!(segment > 0)) continue;
+
+      // Dashes outside the clip are never seen, only the pattern moves on
+      // along them
+      double enter, exit;
+      if (!clip_segment(a, b, clip, &enter, &exit)) {
+        skip(segment);
+        drawing = false;
+        continue;
+      }
+      if (enter > 0) {
+        skip(segment * enter);
+        drawing = false;
+      }
+
+      // Distances are taken from where the segment enters, so they stay as
+      // precise as the clip is small
+      Point direction = (b - a) * (1 / segment);
+      Point start = enter > 0 ? a + (b - a) * enter : a;
+      Point end = exit < 1 ? a + (b - a) * exit : b;
+      double span = segment * (exit - enter);
+      double t = 0;
+      if (on && !drawing) out->move_to(start);
+
+      // Each dash boundary on the segment ends or starts a dash
+      while (span - t > left) {
+        if (++boundaries > DASH_MAX_PER_SUBPATH) return;
+
+        t += left;
+        Point p = start + direction * t;
+        if (on) out->line_to(p);
+        else out->move_to(p);
+
+        on = !on;
+        index = (index + 1) % pattern_count;
+        left = pattern[index];
+      }
+
+      left -= span - t;
+      if (on) out->line_to(end);
+      drawing = on && exit >= 1;
+      if (exit < 1) skip(segment * (1 - exit));
+    }
+  });
+
+  return 1;
+}
+
+// Appends the convex polygon of the `count` points to `out` as a closed
+// subpath, wound so its signed area is positive. Flat polygons add nothing
+static void add_convex(PathData *out, const Point *points, uint32_t count) {
+  double area = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    area += cross(points[i], points[(i + 1) % count]);
+  }
+  if (area == 0 || std::isnan(area)) return;
+
+  if (area > 0) {
+    out->move_to(points[0]);
+    for (uint32_t i = 1; i < count; ++i) out->line_to(points[i]);
+  } else {
+    out->move_to(points[count - 1]);
+    for (uint32_t i = count - 1; i-- > 0;) out->line_to(points[i]);
+  }
+  out->close();
+}
+
+// Appends to `polygon` the points strictly between the start and the end of
+// the arc around `center` that starts at `center + from` and turns by
+// `angle`, close enough to the circle for `tolerance`
+static void add_arc(ArrayList<Point> *polygon, Point center, Point from, double angle, double tolerance) {
+  double radius = length(from);
+  double step = radius > tolerance ? 2 * std::acos(1 - tolerance / radius) : PI;
+  uint32_t steps = (uint32_t)std::ceil(std::abs(angle) / step);
+  if (steps < 2) return;
+
+  double c = std::cos(angle / steps);
+  double s = std::sin(angle / steps);
+  Point v = from;
+  for (uint32_t i = 1; i < steps; ++i) {
+    v = Point {v[0] * c - v[1] * s, v[0] * s + v[1] * c};
+    polygon->push(center + v);
+  }
+}
+
+// Appends the join at `p` between the segment coming in along the unit
+// direction `d0` and the one leaving along `d1`. Only the outer side needs
+// filling, the inner side is under the segments
+static void add_join(
+  PathData *out, ArrayList<Point> *polygon,
+  const StrokeOutline &outline, double tolerance, Point p, Point d0, Point d1
+) {
+  double turn = cross(d0, d1);
+  double straight = dot(d0, d1);
+  if (std::abs(turn) < STROKE_STRAIGHT_CROSS && straight > 0) return;
+
+  double half = outline.width / 2;
+  double side = turn > 0 ? -half : half;
+  Point u0 = normal(d0) * side;
+  Point u1 = normal(d1) * side;
+  Point a = p + u0;
+  Point b = p + u1;
+
+  polygon->resize(0);
+  polygon->push(p);
+  polygon->push(a);
+
+  // The miter is this many half widths long, infinite for a full turn back
+  double miter = 1 + straight > 0 ? std::sqrt(2 / (1 + straight)) : INFINITY;
+
+  switch (outline.join) {
+    case LINE_JOIN_ARCS:
+    case LINE_JOIN_MITER: {
+      if (miter <= outline.miter_limit) polygon->push(p + (u0 + u1) / (1 + straight));
+    } break;
+    case LINE_JOIN_MITER_CLIP: {
+      if (miter <= outline.miter_limit) {
+        polygon->push(p + (u0 + u1) / (1 + straight));
+        break;
+      }
+
+      // Cut across the miter where it passes the limit, the edges are
+      // followed out along the segments
+      Point tip = u0 + u1;
+      double tip_length = length(tip);
+      Point w = tip_length > 0 ? tip / tip_length : d0;
+      double limit = outline.miter_limit * half;
+      polygon->push(a + d0 * ((limit - dot(u0, w)) / dot(d0, w)));
+      polygon->push(b - d1 * ((limit - dot(u1, w)) / -dot(d1, w)));
+    } break;
+    case LINE_JOIN_ROUND: {
+      add_arc(polygon, p, u0, std::atan2(turn, straight), tolerance);
+    } break;
+    case LINE_JOIN_BEVEL: {
+    } break;
+    case LINE_JOIN_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+
+  polygon->push(b);
+  add_convex(out, polygon->begin(), polygon->len());
+}
+
+// Appends the cap at `p`, the end of a subpath leaving along the unit
+// direction `d`
+static void add_cap(
+  PathData *out, ArrayList<Point> *polygon,
+  const StrokeOutline &outline, double tolerance, Point p, Point d
+) {
+  double half = outline.width / 2;
+  Point u = normal(d) * half;
+
+  polygon->resize(0);
+  switch (outline.cap) {
+    case LINE_CAP_BUTT: {
+      return;
+    } break;
+    case LINE_CAP_ROUND: {
+      polygon->push(p - u);
+      add_arc(polygon, p, -u, PI, tolerance);
+      polygon->push(p + u);
+    } break;
+    case LINE_CAP_SQUARE: {
+      polygon->push(p - u);
+      polygon->push(p - u + d * half);
+      polygon->push(p + u + d * half);
+      polygon->push(p + u);
+    } break;
+    case LINE_CAP_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
+  add_convex(out, polygon->begin(), polygon->len());
+}
+
+void stroke_lines(const PathData &lines, const StrokeOutline &outline, double tolerance, PathData *out) {
+  double half = outline.width / 2;
+  if (!(half > 0)) return;
+
+  ArrayList<Point> polyline;
+  ArrayList<Point> polygon;
+  for_each_polyline(lines, &polyline, [&](const Point *points, uint32_t count, bool closed) {
+    // A segment of zero length has no direction, its caps are drawn as if
+    // it ran along +x
+    if (count == 1) {
+      add_cap(out, &polygon, outline, tolerance, points[0], Point {1, 0});
+      add_cap(out, &polygon, outline, tolerance, points[0], Point {-1, 0});
+      return;
+    }
+
+    uint32_t segment_count = closed ? count : count - 1;
+    Point first = {};
+    Point previous = {};
+    for (uint32_t i = 0; i < segment_count; ++i) {
+      Point a = points[i];
+      Point b = points[(i + 1) % count];
+      Point d = (b - a) / length(b - a);
+      Point u = normal(d) * half;
+
+      Point quad[4] = {a + u, b + u, b - u, a - u};
+      add_convex(out, quad, 4);
+
+      if (i == 0) first = d;
+      else add_join(out, &polygon, outline, tolerance, a, previous, d);
+      previous = d;
+    }
+
+    if (closed) {
+      add_join(out, &polygon, outline, tolerance, points[0], previous, first);
+    } else {
+      add_cap(out, &polygon, outline, tolerance, points[0], -first);
+      add_cap(out, &polygon, outline, tolerance, points[count - 1], previous);
+    }
+  });
+}
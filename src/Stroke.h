@@ -0,0 +1,34 @@
+#ifndef STROKE_H
+#define STROKE_H
+
+#include "Bounds.h"
+#include "PathData.h"
+#include "Style.h"
+
+// How a line is outlined, lengths in the units of the lines
+struct StrokeOutline {
+  double width;
+  double miter_limit;
+  StrokeLineJoin join;
+  StrokeLineCap cap;
+};
+
+// Appends to `out` the dashes of `lines`, a path of moves, lines and closes,
+// as open subpaths. `dashes` alternate between drawn and skipped lengths and
+// are repeated twice when `count` is odd, `offset` is how far into the
+// pattern each subpath starts. Only dashes within `clip` are made, and past
+// a bound on their number the rest of a subpath is left out. Without a
+// drawable pattern, or with one too fine to tell apart, `lines` is appended
+// as it is. Returns the share of the coverage of the result to paint, which
+// is that of the drawn lengths for patterns too fine
+double dash_lines(
+  const PathData &lines, const double *dashes, int count, double offset, const AABB &clip, PathData *out
+);
+
+// Appends to `out` the area `outline` covers along `lines`, a path of moves,
+// lines and closes, with round parts followed to within `tolerance`. The
+// area is made of convex closed pieces that overlap and are all wound the
+// same way, so filling them under the nonzero rule fills their union
+void stroke_lines(const PathData &lines, const StrokeOutline &outline, double tolerance, PathData *out);
+
+#endif
@@ -0,0 +1,188 @@
+#include "Style.h"
+
+#include <cstring>
+#include <functional>
+
+bool paint_equal(const Paint &a, const Paint &b) {
+  if (a.type != b.type) return false;
+  switch (a.type) {
+    case PAINT_TRANSPARENT: {
+      return true;
+    } break;
+    case PAINT_RGB: {
+      return a.variants.rgb_paint.r == b.variants.rgb_paint.r &&
+             a.variants.rgb_paint.g == b.variants.rgb_paint.g &&
+             a.variants.rgb_paint.b == b.variants.rgb_paint.b;
+    } break;
+    case PAINT_URL: {
+      std::string_view url_a {a.variants.url_paint.data, (size_t)a.variants.url_paint.len};
+      std::string_view url_b {b.variants.url_paint.data, (size_t)b.variants.url_paint.len};
+      return url_a == url_b;
+    } break;
+  }
+  return false;
+}
+
+bool style_equal(const ComputedStyle &a, const ComputedStyle &b) {
+  if (a.stroke_dash_count != b.stroke_dash_count) return false;
+  for (int i = 0; i < a.stroke_dash_count; ++i) {
+    if (a.stroke_dash_array[i] != b.stroke_dash_array[i]) return false;
+  }
+
+  return a.visible == b.visible &&
+         paint_equal(a.fill, b.fill) &&
+         paint_equal(a.stroke, b.stroke) &&
+         a.font_size == b.font_size &&
+         a.font_style == b.font_style &&
+         a.font_weight == b.font_weight &&
+         a.font_family == b.font_family &&
+         a.opacity == b.opacity &&
+         a.fill_opacity == b.fill_opacity &&
+         a.stroke_opacity == b.stroke_opacity &&
+         a.stroke_width == b.stroke_width &&
+         a.stroke_dash_offset == b.stroke_dash_offset &&
+         a.stroke_line_join == b.stroke_line_join &&
+         a.stroke_line_cap == b.stroke_line_cap &&
+         a.miter_limit == b.miter_limit &&
+         a.fill_rule == b.fill_rule &&
+         a.xml_space == b.xml_space;
+}
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+  hash ^= value;
+  hash *= 0x100000001b3;
+  return hash ^ (hash >> 29);
+}
+
+// -0.0 and 0.0 compare equal, so they must hash the same
+static uint64_t double_bits(double value) {
+  if (value == 0) return 0;
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static uint64_t mix_paint(uint64_t hash, const Paint &paint) {
+  hash = mix(hash, paint.type);
+  switch (paint.type) {
+    case PAINT_TRANSPARENT: {
+    } break;
+    case PAINT_RGB: {
+      hash = mix(hash, double_bits(paint.variants.rgb_paint.r));
+      hash = mix(hash, double_bits(paint.variants.rgb_paint.g));
+      hash = mix(hash, double_bits(paint.variants.rgb_paint.b));
+    } break;
+    case PAINT_URL: {
+      std::string_view url {paint.variants.url_paint.data, (size_t)paint.variants.url_paint.len};
+      hash = mix(hash, std::hash<std::string_view> {}(url));
+    } break;
+  }
+  return hash;
+}
+
+uint64_t style_hash(const ComputedStyle &style) {
+  uint64_t hash = 0xcbf29ce484222325;
+  hash = mix(hash, style.visible);
+  hash = mix_paint(hash, style.fill);
+  hash = mix_paint(hash, style.stroke);
+  hash = mix(hash, double_bits(style.font_size));
+  hash = mix(hash, style.font_style);
+  hash = mix(hash, (uint64_t)style.font_weight);
+  hash = mix(hash, std::hash<std::string_view> {}(style.font_family));
+  hash = mix(hash, double_bits(style.opacity));
+  hash = mix(hash, double_bits(style.fill_opacity));
+  hash = mix(hash, double_bits(style.stroke_opacity));
+  hash = mix(hash, double_bits(style.stroke_width));
+  hash = mix(hash, double_bits(style.stroke_dash_offset));
+  hash = mix(hash, (uint64_t)style.stroke_dash_count);
+  for (int i = 0; i < style.stroke_dash_count; ++i) {
+    hash = mix(hash, double_bits(style.stroke_dash_array[i]));
+  }
+  hash = mix(hash, style.stroke_line_join);
+  hash = mix(hash, style.stroke_line_cap);
+  hash = mix(hash, double_bits(style.miter_limit));
+  hash = mix(hash, style.fill_rule);
+  hash = mix(hash, style.xml_space);
+  return hash;
+}
+
+ComputedStyle initial_style() {
+  ComputedStyle style;
+  style.visible = true;
+  style.fill = Paint::new_rgb(0, 0, 0);
+  style.stroke = Paint::new_transparent();
+  style.font_size = 16;
+  style.font_style = FONTSTYLE_NORMAL;
+  style.font_weight = 400;
+  style.font_family = "serif";
+  style.opacity = 1.0;
+  style.fill_opacity = 1.0;
+  style.stroke_opacity = 1.0;
+  style.stroke_width = 1.0;
+  style.stroke_dash_offset = 0.0;
+  for (double &dash : style.stroke_dash_array) dash = 0;
+  style.stroke_dash_count = 0;
+  style.stroke_line_join = LINE_JOIN_MITER;
+  style.stroke_line_cap = LINE_CAP_BUTT;
+  style.miter_limit = 4;
+  style.fill_rule = FILL_RULE_NONZERO;
+  style.xml_space = true;
+  return style;
+}
+
+constexpr uint32_t STYLE_POOL_EMPTY = UINT32_MAX;
+
+StylePool::StylePool() {
+  this->rehash(16);
+  this->intern(initial_style());
+}
+
+void StylePool::rehash(uint32_t slot_count) {
+  this->slots.resize(slot_count);
+  for (uint32_t &slot : this->slots) slot = STYLE_POOL_EMPTY;
+
+  uint32_t mask = slot_count - 1;
+  for (uint32_t idx = 0; idx < this->styles.len(); ++idx) {
+    uint32_t slot = (uint32_t)this->hashes[idx] & mask;
+    while (this->slots[slot] != STYLE_POOL_EMPTY) slot = (slot + 1) & mask;
+    this->slots[slot] = idx;
+  }
+}
+
+std::string_view StylePool::retain(std::string_view value) {
+  if (value.empty()) return std::string_view {};
+  char *copy = this->strings.alloc_array<char>(value.size());
+  memcpy(copy, value.data(), value.size());
+  return std::string_view {copy, value.size()};
+}
+
+Paint StylePool::retain(const Paint &paint) {
+  if (paint.type != PAINT_URL) return paint;
+  return Paint::new_url(this->retain(std::string_view {paint.variants.url_paint.data, (size_t)paint.variants.url_paint.len}));
+}
+
+uint32_t StylePool::intern(const ComputedStyle &style) {
+  uint64_t hash = style_hash(style);
+  uint32_t mask = this->slots.len() - 1;
+  uint32_t slot = (uint32_t)hash & mask;
+
+  while (this->slots[slot] != STYLE_POOL_EMPTY) {
+    uint32_t idx = this->slots[slot];
+    if (this->hashes[idx] == hash && style_equal(this->styles[idx], style)) return idx;
+    slot = (slot + 1) & mask;
+  }
+
+  ComputedStyle entry = style;
+  entry.fill = this->retain(style.fill);
+  entry.stroke = this->retain(style.stroke);
+  entry.font_family = this->retain(style.font_family);
+
+  uint32_t idx = this->styles.len();
+  this->styles.push(entry);
+  this->hashes.push(hash);
+  this->slots[slot] = idx;
+
+  // Keeps the table at most half full
+  if (this->styles.len() * 2 > this->slots.len()) this->rehash(this->slots.len() * 2);
+  return idx;
+}
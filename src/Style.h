@@ -0,0 +1,120 @@
+#ifndef STYLE_H
+#define STYLE_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "Arena.h"
+#include "ArrayList.h"
+#include "Paint.h"
+
+enum StrokeLineJoin {
+  LINE_JOIN_ARCS = 0,
+  LINE_JOIN_BEVEL,
+  LINE_JOIN_MITER,
+  LINE_JOIN_MITER_CLIP,
+  LINE_JOIN_ROUND,
+  LINE_JOIN_COUNT,
+};
+
+enum StrokeLineCap {
+  LINE_CAP_BUTT = 0,
+  LINE_CAP_ROUND,
+  LINE_CAP_SQUARE,
+  LINE_CAP_COUNT,
+};
+
+enum FillRule {
+  FILL_RULE_NONZERO = 0,
+  FILL_RULE_EVENODD,
+  FILL_RULE_COUNT
+};
+
+enum FontStyle {
+  FONTSTYLE_NORMAL = 0,
+  FONTSTYLE_ITALIC,
+  FONTSTYLE_OBLIQUE,
+  FONTSTYLE_COUNT,
+};
+
+// The inherited presentation attributes of a shape, resolved against its
+// ancestors. Plain data, so it can be copied and compared freely
+struct ComputedStyle {
+  bool visible;
+
+  Paint fill;
+  Paint stroke;
+
+  double font_size;
+  FontStyle font_style;
+  int font_weight;
+  std::string_view font_family;
+
+  double opacity;
+  double fill_opacity;
+  double stroke_opacity;
+
+  double stroke_width;
+  double stroke_dash_offset;
+  double stroke_dash_array[8];
+  int stroke_dash_count;
+
+  StrokeLineJoin stroke_line_join;
+  StrokeLineCap stroke_line_cap;
+
+  double miter_limit;
+  FillRule fill_rule;
+
+  bool xml_space;
+};
+
+// Returns whether two paints draw the same thing
+bool paint_equal(const Paint &a, const Paint &b);
+
+// Returns whether two styles are equal field by field
+bool style_equal(const ComputedStyle &a, const ComputedStyle &b);
+
+// Returns a hash that agrees with `style_equal`
+uint64_t style_hash(const ComputedStyle &style);
+
+// Returns the style of an element without ancestors
+ComputedStyle initial_style();
+
+// The distinct computed styles of a document. Elements sharing a style share
+// one entry and refer to it by index, `STYLE_INITIAL` is always present.
+// Entries own copies of the text they refer to, so they outlive the
+// elements they came from
+class StylePool {
+public:
+  StylePool();
+
+  // Returns the index of the entry equal to `style`, adding a copy of it if
+  // needed. The views of `style` only have to last for the call
+  uint32_t intern(const ComputedStyle &style);
+
+  // Returns the number of distinct styles
+  uint32_t len() const { return this->styles.len(); }
+
+  const ComputedStyle &operator[](uint32_t idx) const { return this->styles[idx]; }
+private:
+  void rehash(uint32_t slot_count);
+
+  // Copies `value` into `strings`
+  std::string_view retain(std::string_view value);
+
+  // Copies the url of `paint` into `strings`
+  Paint retain(const Paint &paint);
+
+  ArrayList<ComputedStyle> styles;
+  ArrayList<uint64_t> hashes;
+
+  // Open addressed table of indices into `styles`
+  ArrayList<uint32_t> slots;
+
+  // The text the entries refer to
+  Arena strings;
+};
+
+constexpr uint32_t STYLE_INITIAL = 0;
+
+#endif
@@ -16,15 +16,21 @@ namespace SVGShapes {
 
 class Text : public BaseShape {
 public:
-  std::string content;
+  std::string_view content;
   Point pos;
   Point d;
   TextAnchor text_anchor;
 
-  Text(Attribute *attrs, int attrs_count, BaseShape *parent, StyleSheet *styles);
-  AABB get_bounding() const override;
+  // Copied out of the computed style, which the shape can't reach on its own
+  double font_size;
+  bool xml_space;
+
+  Text(const AttributeSet *attrs, BaseShape *parent, ParseContext *context);
 
-  void set_text(std::string_view text);
+  // Stores the decoded `text` in `arena`
+  void set_text(std::string_view text, Arena *arena);
+protected:
+  AABB get_bounding() const override;
 };
 
 };
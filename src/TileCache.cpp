@@ -0,0 +1,137 @@
+#include "TileCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Ends the recency order
+constexpr uint32_t TILE_NONE = UINT32_MAX;
+
+int64_t tile_level(double scale) {
+  return std::llround(std::log2(scale) * TILE_LEVELS_PER_OCTAVE);
+}
+
+double tile_level_scale(int64_t level) {
+  return std::exp2((double)level / TILE_LEVELS_PER_OCTAVE);
+}
+
+TileRange tile_range(const AABB &area, uint32_t tile_size) {
+  // Clamped to what the keys can count, far past any window
+  auto count = [&](double tiles) {
+    return (int32_t)std::clamp(tiles, (double)INT32_MIN / 2, (double)INT32_MAX / 2);
+  };
+
+  return TileRange {
+    count(std::floor(area.min[0] / tile_size)),
+    count(std::floor(area.min[1] / tile_size)),
+    count(std::ceil(area.max[0] / tile_size)),
+    count(std::ceil(area.max[1] / tile_size)),
+  };
+}
+
+size_t TileCache::KeyHash::operator()(const TileKey &key) const {
+  uint64_t h = (uint64_t)key.level * 0x9e3779b97f4a7c15;
+  h = (h ^ ((uint64_t)(uint32_t)key.x << 32 | (uint32_t)key.y)) * 0xbf58476d1ce4e5b9;
+  return (size_t)(h ^ (h >> 31));
+}
+
+bool TileCache::KeyEqual::operator()(const TileKey &a, const TileKey &b) const {
+  return a.level == b.level && a.x == b.x && a.y == b.y;
+}
+
+TileCache::TileCache(uint32_t tile_size, size_t byte_limit) :
+  size{tile_size},
+  tile_bytes{(size_t)tile_size * tile_size * 4},
+  capacity{(uint32_t)std::clamp(byte_limit / tile_bytes, (size_t)1, (size_t)UINT32_MAX - 1)},
+  tiles{},
+  index{},
+  levels{},
+  newest{TILE_NONE},
+  oldest{TILE_NONE} {}
+
+uint8_t *TileCache::find(TileKey key) {
+  auto found = this->index.find(key);
+  if (found == this->index.end()) return nullptr;
+
+  uint32_t slot = found->second;
+  if (slot != this->newest) {
+    this->unlink(slot);
+    this->link_newest(slot);
+  }
+  return this->tiles[slot].pixels.get();
+}
+
+uint8_t *TileCache::insert(TileKey key) {
+  if (uint8_t *pixels = this->find(key)) return pixels;
+
+  uint32_t slot;
+  if (this->tiles.size() < this->capacity) {
+    slot = (uint32_t)this->tiles.size();
+    this->tiles.push_back(Tile {key, std::unique_ptr<uint8_t[]> {new uint8_t[this->tile_bytes]}, TILE_NONE, TILE_NONE});
+  } else {
+    // The oldest tile gives its pixels to the new one
+    slot = this->oldest;
+    this->unlink(slot);
+
+    const TileKey &old = this->tiles[slot].key;
+    this->index.erase(old);
+    auto level = this->levels.find(old.level);
+    if (--level->second == 0) this->levels.erase(level);
+    this->tiles[slot].key = key;
+  }
+
+  this->index.emplace(key, slot);
+  this->levels[key.level] += 1;
+  this->link_newest(slot);
+  return this->tiles[slot].pixels.get();
+}
+
+Optional<int64_t> TileCache::nearest_level(int64_t level, int64_t max_distance) const {
+  // The closest levels are the first above and the last below. On a tie the
+  // one above wins, shrinking a tile keeps it sharper than enlarging one
+  Optional<int64_t> nearest = Optional<int64_t>::none();
+  int64_t nearest_distance = max_distance;
+
+  auto above = this->levels.upper_bound(level);
+  if (above != this->levels.end() && above->first - level <= nearest_distance) {
+    nearest = Optional<int64_t>::some(above->first);
+    nearest_distance = above->first - level;
+  }
+
+  auto below = this->levels.lower_bound(level);
+  if (below != this->levels.begin()) {
+    --below;
+    int64_t distance = level - below->first;
+    if (distance < nearest_distance || (!nearest.has_value && distance == nearest_distance)) {
+      nearest = Optional<int64_t>::some(below->first);
+    }
+  }
+
+  return nearest;
+}
+
+void TileCache::clear() {
+  this->tiles.clear();
+  this->index.clear();
+  this->levels.clear();
+  this->newest = TILE_NONE;
+  this->oldest = TILE_NONE;
+}
+
+void TileCache::unlink(uint32_t slot) {
+  Tile &tile = this->tiles[slot];
+  if (tile.newer != TILE_NONE) this->tiles[tile.newer].older = tile.older;
+  else this->newest = tile.older;
+  if (tile.older != TILE_NONE) this->tiles[tile.older].newer = tile.newer;
+  else this->oldest = tile.newer;
+  tile.newer = TILE_NONE;
+  tile.older = TILE_NONE;
+}
+
+void TileCache::link_newest(uint32_t slot) {
+  Tile &tile = this->tiles[slot];
+  tile.newer = TILE_NONE;
+  tile.older = this->newest;
+  if (this->newest != TILE_NONE) this->tiles[this->newest].newer = slot;
+  else this->oldest = slot;
+  this->newest = slot;
+}
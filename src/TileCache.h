@@ -0,0 +1,112 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include "Bounds.h"
+#include "utils.h"
+
+// Scale levels are this many per doubling of the scale. Scales closer than
+// a level share their tiles, which absorbs the rounding left by zooming in
+// and back out, while tiles of one level still line up to far below a pixel
+constexpr double TILE_LEVELS_PER_OCTAVE = 4294967296.0;
+
+// Returns the level of `scale`, the number of device pixels per unit
+int64_t tile_level(double scale);
+
+// Returns the scale of `level`
+double tile_level_scale(int64_t level);
+
+// A tile of a level, counted from the world origin. Tile (x, y) covers the
+// device pixels from (x, y) times the tile size
+struct TileKey {
+  int64_t level;
+  int32_t x;
+  int32_t y;
+};
+
+// The tiles from (`x0`, `y0`) to before (`x1`, `y1`)
+struct TileRange {
+  int32_t x0;
+  int32_t y0;
+  int32_t x1;
+  int32_t y1;
+};
+
+// Returns the tiles of `tile_size` pixels that the device pixels of `area`
+// touch
+TileRange tile_range(const AABB &area, uint32_t tile_size);
+
+// Rendered tiles of a view, kept across frames so panning only renders the
+// tiles it exposes. Tiles are square premultiplied 32-bit images in the
+// channel order of whoever renders them. Once the memory limit is reached,
+// the tile used the longest ago makes room for the new one and its pixels
+// are reused
+class TileCache {
+public:
+  // Keeps tiles of `tile_size` pixels in at most `byte_limit` bytes, always
+  // room for one tile
+  TileCache(uint32_t tile_size, size_t byte_limit);
+
+  // Returns the pixels of the tile at `key` and marks it as used, or null
+  // when it is not cached. The pointer is valid until the next `insert`
+  uint8_t *find(TileKey key);
+
+  // Returns the pixels for the tile at `key`, for the caller to render into,
+  // as the most recently used tile. Their content is left undefined
+  uint8_t *insert(TileKey key);
+
+  // Returns the cached level closest to `level` other than itself, within
+  // `max_distance` levels
+  Optional<int64_t> nearest_level(int64_t level, int64_t max_distance) const;
+
+  // Drops every tile, for when what they show has changed
+  void clear();
+
+  uint32_t tile_size() const { return this->size; }
+  uint32_t len() const { return (uint32_t)this->index.size(); }
+  size_t bytes() const { return this->tiles.size() * this->tile_bytes; }
+private:
+  struct KeyHash {
+    size_t operator()(const TileKey &key) const;
+  };
+
+  struct KeyEqual {
+    bool operator()(const TileKey &a, const TileKey &b) const;
+  };
+
+  struct Tile {
+    TileKey key;
+    std::unique_ptr<uint8_t[]> pixels;
+
+    // The tiles used just after and just before this one
+    uint32_t newer;
+    uint32_t older;
+  };
+
+  // Takes the tile at `slot` out of the recency order
+  void unlink(uint32_t slot);
+
+  // Puts the tile at `slot` first in the recency order
+  void link_newest(uint32_t slot);
+
+  uint32_t size;
+  size_t tile_bytes;
+  uint32_t capacity;
+
+  std::deque<Tile> tiles;
+  std::unordered_map<TileKey, uint32_t, KeyHash, KeyEqual> index;
+
+  // How many tiles each level has
+  std::map<int64_t, uint32_t> levels;
+
+  uint32_t newest;
+  uint32_t oldest;
+};
+
+#endif
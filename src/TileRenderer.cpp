@@ -0,0 +1,177 @@
+#include "TileRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+// The tasks a worker starts with. Workers that run out of their own take
+// from the front of the others', on a cache line of its own so taking one
+// does not slow the owner down
+struct alignas(64) WorkRange {
+  std::atomic<uint32_t> next;
+  uint32_t end;
+};
+
+// Every worker is given an even share of the indices and steals from the
+// others once its own are done, so uneven tasks still keep every thread busy
+template<typename F>
+void TileRenderer::run_parallel(uint32_t count, F task) {
+  uint32_t thread_count = std::max(std::min(this->threads, count), 1u);
+  std::unique_ptr<WorkRange[]> ranges {new WorkRange[thread_count]};
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    ranges[i].next.store((uint32_t)((uint64_t)count * i / thread_count), std::memory_order_relaxed);
+    ranges[i].end = (uint32_t)((uint64_t)count * (i + 1) / thread_count);
+  }
+
+  auto work = [&](uint32_t worker) {
+    for (uint32_t k = 0; k < thread_count; ++k) {
+      WorkRange &range = ranges[(worker + k) % thread_count];
+      uint32_t index;
+      while ((index = range.next.fetch_add(1, std::memory_order_relaxed)) < range.end) {
+        task(worker, index);
+      }
+    }
+  };
+
+  if (thread_count == 1) {
+    work(0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard {this->lock};
+    this->phase_task = [](void *state, uint32_t worker) {
+      (*(decltype(work) *)state)(worker);
+    };
+    this->phase_state = &work;
+    this->phase_workers = thread_count;
+    this->pending = thread_count - 1;
+    this->phase += 1;
+  }
+  this->wake.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> guard {this->lock};
+  this->finished.wait(guard, [&] { return this->pending == 0; });
+}
+
+void TileRenderer::work(uint32_t worker) {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> guard {this->lock};
+  while (true) {
+    this->wake.wait(guard, [&] { return this->stopping || this->phase != seen; });
+    if (this->stopping) return;
+    seen = this->phase;
+
+    // Phases with fewer tasks than threads leave the last workers out
+    if (worker >= this->phase_workers) continue;
+
+    guard.unlock();
+    this->phase_task(this->phase_state, worker);
+    guard.lock();
+    if (--this->pending == 0) this->finished.notify_one();
+  }
+}
+
+TileRenderer::TileRenderer(uint32_t thread_count, uint32_t tile_size) :
+  threads{thread_count ? thread_count : std::max(std::thread::hardware_concurrency(), 1u)},
+  size{tile_size ? tile_size : TILE_DEFAULT_SIZE},
+  rasterizers{},
+  shapes{},
+  visible{},
+  bins{},
+  lock{},
+  wake{},
+  finished{},
+  phase_task{nullptr},
+  phase_state{nullptr},
+  phase_workers{0},
+  phase{0},
+  pending{0},
+  stopping{false},
+  helpers{} {
+  this->rasterizers.resize(this->threads);
+  for (uint32_t worker = 1; worker < this->threads; ++worker) {
+    this->helpers.emplace_back(&TileRenderer::work, this, worker);
+  }
+}
+
+TileRenderer::~TileRenderer() {
+  {
+    std::lock_guard<std::mutex> guard {this->lock};
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for (std::thread &helper : this->helpers) {
+    helper.join();
+  }
+}
+
+void TileRenderer::render(const DisplayList *list, const Transform &view, const RasterTarget &target) {
+  uint32_t columns = (target.width + this->size - 1) / this->size;
+  uint32_t rows = (target.height + this->size - 1) / this->size;
+  if (columns == 0 || rows == 0) return;
+
+  this->bins.resize(columns * rows);
+  for (ArrayList<uint32_t> &bin : this->bins) {
+    bin.resize(0);
+  }
+  // Bins follow the boxes of the items, in tiles counted from the corner of
+  // the target
+  this->visible.resize(0);
+  for (uint32_t i = 0; i < list->len(); ++i) {
+    const DisplayItem &item = list->items[i];
+    if (item.kind == DISPLAY_ITEM_TEXT) continue;
+
+    AABB box = transform_box(view, item.bounds);
+    double left = (box.min[0] - target.x) / this->size;
+    double top = (box.min[1] - target.y) / this->size;
+    double right = (box.max[0] - target.x) / this->size;
+    double bottom = (box.max[1] - target.y) / this->size;
+    if (!(right >= 0 && bottom >= 0 && left < columns && top < rows)) continue;
+
+    uint32_t column_start = (uint32_t)std::max(std::floor(left), 0.0);
+    uint32_t row_start = (uint32_t)std::max(std::floor(top), 0.0);
+    uint32_t column_end = (uint32_t)std::min(std::floor(right), columns - 1.0);
+    uint32_t row_end = (uint32_t)std::min(std::floor(bottom), rows - 1.0);
+    for (uint32_t row = row_start; row <= row_end; ++row) {
+      for (uint32_t column = column_start; column <= column_end; ++column) {
+        this->bins[row * columns + column].push(this->visible.len());
+      }
+    }
+    this->visible.push(i);
+  }
+
+  // Outlines are kept for as many items as are in view, the scratch of the
+  // others is freed
+  this->shapes.resize(this->visible.len());
+
+  // Every item is flattened once, however many tiles it is painted in
+  AABB clip = {
+    Point {(double)target.x, (double)target.y},
+    Point {(double)target.x + target.width, (double)target.y + target.height},
+  };
+  this->run_parallel(this->visible.len(), [&](uint32_t worker, uint32_t index) {
+    uint32_t item = this->visible[index];
+    this->rasterizers[worker].prepare(list, list->items[item], view, clip, &this->shapes[index]);
+  });
+
+  this->run_parallel(columns * rows, [&](uint32_t worker, uint32_t index) {
+    uint32_t column = index % columns;
+    uint32_t row = index / columns;
+    RasterTarget tile = {
+      target.pixels + (size_t)row * this->size * target.stride + (size_t)column * this->size * 4,
+      target.x + column * this->size,
+      target.y + row * this->size,
+      std::min(this->size, target.width - column * this->size),
+      std::min(this->size, target.height - row * this->size),
+      target.stride,
+    };
+
+    for (uint32_t shape : this->bins[index]) {
+      this->rasterizers[worker].paint(list, list->items[this->visible[shape]], this->shapes[shape], view, tile);
+    }
+  });
+}
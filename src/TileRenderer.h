@@ -0,0 +1,79 @@
+#ifndef TILE_RENDERER_H
+#define TILE_RENDERER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Rasterizer.h"
+
+// The side of a tile when none is asked for, in pixels
+constexpr uint32_t TILE_DEFAULT_SIZE = 256;
+
+// Renders display lists with the CPU rasterizer on several threads. The
+// target is cut into square tiles and every item is binned into the tiles
+// its box touches. Items are flattened and stroked once, then each tile
+// paints its items in document order into pixels no other tile touches, so
+// the image is the same whatever the number of threads. The threads are
+// started once and wait between renders
+class TileRenderer {
+public:
+  // A `thread_count` of 0 uses every hardware thread, a `tile_size` of 0
+  // uses `TILE_DEFAULT_SIZE`
+  TileRenderer(uint32_t thread_count, uint32_t tile_size);
+  ~TileRenderer();
+
+  TileRenderer(const TileRenderer&) = delete;
+  TileRenderer &operator=(const TileRenderer&) = delete;
+
+  // Draws every item of `list` over `target`, `view` maps the world onto
+  // its pixels
+  void render(const DisplayList *list, const Transform &view, const RasterTarget &target);
+
+  uint32_t thread_count() const { return this->threads; }
+  uint32_t tile_size() const { return this->size; }
+private:
+  // Runs `task(worker, index)` for every index below `count` on the workers,
+  // the calling thread among them, and returns once all are done
+  template<typename F>
+  void run_parallel(uint32_t count, F task);
+
+  // Waits for each phase `run_parallel` starts and does its share of it,
+  // until the renderer is destroyed
+  void work(uint32_t worker);
+
+  uint32_t threads;
+  uint32_t size;
+
+  // One per thread, each keeps its scratch across frames
+  std::deque<Rasterizer> rasterizers;
+
+  // The outlines of the items in `visible`, in the same order. Items that
+  // leave the view give their outlines up
+  std::deque<RasterShape> shapes;
+  ArrayList<uint32_t> visible;
+
+  // The indices into `visible` of the items of each tile, in document order,
+  // row by row
+  std::deque<ArrayList<uint32_t>> bins;
+
+  // The phase being run, as a function of its state and the worker. Every
+  // new phase bumps `phase`, and `pending` counts the workers still in it
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  void (*phase_task)(void *state, uint32_t worker);
+  void *phase_state;
+  uint32_t phase_workers;
+  uint64_t phase;
+  uint32_t pending;
+  bool stopping;
+
+  // Worker 0 is the thread calling `render`, these are the others
+  std::vector<std::thread> helpers;
+};
+
+#endif
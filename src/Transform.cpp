@@ -1,9 +1,15 @@
 #include "Transform.h"
 #include "common.h"
+#include "Number.h"
 #include <string_view>
 #include <cmath>
 #include <cctype>
 #include "InverseIndex.h"
+#include "Cpu.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
 
 struct Array {
   double a[6];
@@ -13,12 +19,11 @@ struct Array {
 static Array split_number(std::string_view inf) {
   Array arr;
   arr.n = 0;
-  while (inf.size() > 0) {
+  while (inf.size() > 0 && arr.n < 6) {
     inf = trim_start(inf);
-    while(isspace(inf[0]) != (inf[0] == ',')) inf = inf.substr(1);
-    char *out;
-    arr.a[arr.n] = strtod(inf.data(), &out);
-    inf = inf.substr(out - inf.data());
+    size_t len = parse_number(inf, &arr.a[arr.n]);
+    if (len == 0) break;
+    inf = inf.substr(len);
     arr.n++;
   }
 
@@ -157,4 +162,78 @@ Transform convert_transform(std::string_view value) {
     value = value.substr(end + 1);
   }
   return transform;
-}
\ No newline at end of file
+}
+static_assert(sizeof(Point) == 2 * sizeof(double), "points are packed x, y pairs");
+static_assert(sizeof(BezierCurve) == 4 * sizeof(Point), "curves are packed points");
+
+#ifdef CPU_X86
+
+// One point per register, the x and y of the result in its two lanes
+static void transform_points_sse2(const Transform &transform, const Point *in, Point *out, uint32_t count) {
+  __m128d column_x = _mm_set_pd(transform.m[1][0], transform.m[0][0]);
+  __m128d column_y = _mm_set_pd(transform.m[1][1], transform.m[0][1]);
+  __m128d offset = _mm_set_pd(transform.d[1], transform.d[0]);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    __m128d p = _mm_loadu_pd(in[i].data);
+    __m128d x = _mm_unpacklo_pd(p, p);
+    __m128d y = _mm_unpackhi_pd(p, p);
+    __m128d r = _mm_add_pd(_mm_mul_pd(x, column_x), _mm_mul_pd(y, column_y));
+    _mm_storeu_pd(out[i].data, _mm_add_pd(r, offset));
+  }
+}
+
+// Two points per register and two registers per iteration
+__attribute__((target("avx2,fma")))
+static void transform_points_avx2(const Transform &transform, const Point *in, Point *out, uint32_t count) {
+  __m256d column_x = _mm256_set_pd(transform.m[1][0], transform.m[0][0], transform.m[1][0], transform.m[0][0]);
+  __m256d column_y = _mm256_set_pd(transform.m[1][1], transform.m[0][1], transform.m[1][1], transform.m[0][1]);
+  __m256d offset = _mm256_set_pd(transform.d[1], transform.d[0], transform.d[1], transform.d[0]);
+
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256d p0 = _mm256_loadu_pd(in[i].data);
+    __m256d p1 = _mm256_loadu_pd(in[i + 2].data);
+    __m256d r0 = _mm256_fmadd_pd(
+      _mm256_unpackhi_pd(p0, p0), column_y, _mm256_mul_pd(_mm256_unpacklo_pd(p0, p0), column_x)
+    );
+    __m256d r1 = _mm256_fmadd_pd(
+      _mm256_unpackhi_pd(p1, p1), column_y, _mm256_mul_pd(_mm256_unpacklo_pd(p1, p1), column_x)
+    );
+    _mm256_storeu_pd(out[i].data, _mm256_add_pd(r0, offset));
+    _mm256_storeu_pd(out[i + 2].data, _mm256_add_pd(r1, offset));
+  }
+
+  transform_points_sse2(transform, in + i, out + i, count - i);
+}
+
+#else
+
+// Computes each point the same way as `Transform::operator*`
+static void transform_points_scalar(const Transform &transform, const Point *in, Point *out, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = transform * in[i];
+  }
+}
+
+#endif
+
+using TransformPointsFn = void (*)(const Transform &transform, const Point *in, Point *out, uint32_t count);
+
+static TransformPointsFn select_transform_points() {
+#ifdef CPU_X86
+  if (cpu_has_avx2_fma()) return transform_points_avx2;
+  return transform_points_sse2;
+#else
+  return transform_points_scalar;
+#endif
+}
+
+void transform_points(const Transform &transform, const Point *in, Point *out, uint32_t count) {
+  static const TransformPointsFn kernel = select_transform_points();
+  kernel(transform, in, out, count);
+}
+
+void transform_beziers(const Transform &transform, const BezierCurve *in, BezierCurve *out, uint32_t count) {
+  transform_points(transform, &in->start, &out->start, count * 4);
+}
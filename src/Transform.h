@@ -2,8 +2,18 @@
 #define TRANSFORM_H
 
 #include "Matrix.h"
+#include "PathData.h"
+#include <cstdint>
 #include <string_view>
 
 Transform convert_transform(std::string_view value);
 
+// Maps the `count` points of `in` through `transform` into `out`, which may
+// be `in` itself. Uses AVX2 and FMA when the processor has them, SSE2
+// otherwise, so results may differ from `transform * point` in the last bit
+void transform_points(const Transform &transform, const Point *in, Point *out, uint32_t count);
+
+// Maps the four points of each of the `count` curves of `in` into `out`
+void transform_beziers(const Transform &transform, const BezierCurve *in, BezierCurve *out, uint32_t count);
+
 #endif
\ No newline at end of file
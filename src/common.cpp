@@ -1,9 +1,10 @@
 #include "common.h"
+#include "Number.h"
 #include <cctype>
 #include <cmath>
 
 double convert_percent(std::string_view value) {
-  double opacity = strtod(value.data(), nullptr);
+  double opacity = to_number(value);
   if (value[value.size() - 1] == '%') {
     opacity /= 100;
   }
@@ -19,24 +20,13 @@ std::string_view trim_start(std::string_view sv) {
 void convert_array(std::string_view value, double *a, int *count) {
   while (value.size() > 0 && (*count) < 8) {
     value = trim_start(value);
-    char *end;
-    a[*count] = strtod(value.data(), &end);
-    if (end != value.data()) ++*count;
-    value = value.substr(end - value.data());
+    size_t len = parse_number(value, &a[*count]);
+    if (len == 0) break;
+    ++*count;
+    value = value.substr(len);
   }
 }
 
-double read_double(std::string_view *str) {
-  *str = trim_start(*str);
-
-  char *out;
-  double num = strtod(str->data(), &out);
-  *str = str->substr(out - str->data());
-
-  *str = trim_start(*str);
-  return num;
-}
-
 std::string_view trim_end(std::string_view data) {
   while (isspace(data[0])) data = data.substr(1);
   while (data.size() && isspace(data[data.size() - 1])) data = data.substr(0, data.size() - 1);
@@ -44,8 +34,8 @@ std::string_view trim_end(std::string_view data) {
   return data;
 }
 
-ArrayList<Attribute> process_style(std::string_view value) {
-  ArrayList<Attribute> arr;
+void process_style(std::string_view value, ArrayList<Attribute> *out) {
+  out->resize(0);
   while (value.size() > 0) {
     value = trim_start(value);
     size_t end = value.find(';');
@@ -59,19 +49,17 @@ ArrayList<Attribute> process_style(std::string_view value) {
 
     attr.value = str.substr(pos + 1);
     attr.value = trim_end(attr.value);
-    arr.push(attr);
+    out->push(attr);
 
     if (end != value.size()) value = value.substr(end + 1);
     else value = value.substr(end);
   }
-
-  return arr;
 }
 
 
 PercentUnit read_percent_unit(std::string_view value) {
   PercentUnit result;
-  result.val = strtod(value.data(), nullptr);
+  result.val = to_number(value);
   result.percent = false;
   if (value.size() && value[value.size() - 1] == '%') {
     result.percent = true;
@@ -25,11 +25,11 @@ std::string_view trim_start(std::string_view sv);
 
 void convert_array(std::string_view value, double *a, int *count);
 
-double read_double(std::string_view *str);
-
 std::string_view trim_end(std::string_view data);
 
-ArrayList<Attribute> process_style(std::string_view value);
+// Splits the declarations of an inline style into `out`, replacing its
+// content. The keys and values are views into `value`
+void process_style(std::string_view value, ArrayList<Attribute> *out);
 
 PercentUnit read_percent_unit(std::string_view value);
 
@@ -140,9 +140,12 @@ private:
         FillRect(hdc, &rc, background);
         DeleteObject(background);
 
+        Gdiplus::Color color;
+        color.SetFromCOLORREF(GetSysColor(COLOR_WINDOW));
+
         Gdiplus::Graphics graphics {hdc};
         graphics.SetSmoothingMode(Gdiplus::SmoothingModeHighQuality);
-        renderer->render(&graphics);
+        bool finished = renderer->render(&graphics, color);
 
         BitBlt(
           ps.hdc, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top,
@@ -154,6 +157,9 @@ private:
         DeleteDC(hdc);
 
         EndPaint(hWnd, &ps);
+
+        // The tiles left are rendered once pending input is handled
+        if (!finished) InvalidateRect(hWnd, NULL, FALSE);
       } break;
       case WM_DESTROY: {
         SetWindowLongPtr(hWnd, GWLP_USERDATA, 0);
@@ -1,6 +1,7 @@
 #include "parser.h"
 #include "Gradient.h"
 #include "InverseIndex.h"
+#include "Scanner.h"
 
 #include "Path.h"
 #include "Rect.h"
@@ -12,19 +13,8 @@
 #include "Text.h"
 #include "Group.h"
 
-enum ShapeTags {
-  SHAPE_TAG_G = 0,
-  SHAPE_TAG_PATH,
-  SHAPE_TAG_RECT,
-  SHAPE_TAG_CIRCLE,
-  SHAPE_TAG_ELLIPSE,
-  SHAPE_TAG_LINE,
-  SHAPE_TAG_POLYLINE,
-  SHAPE_TAG_POLYGON,
-  SHAPE_TAG_TEXT,
-  SHAPE_TAG_SVG,
-  SHAPE_TAG_COUNT
-};
+#include <cstring>
+#include <vector>
 
 enum OtherTags {
   OTHER_TAG_DEFS = 0,
@@ -35,7 +25,7 @@ enum OtherTags {
   OTHER_TAG_COUNT
 };
 
-constexpr std::string_view shape_tags_str[SHAPE_TAG_COUNT] = {
+constexpr std::string_view shape_tags_str[SHAPE_KIND_COUNT] = {
   "g",
   "path",
   "rect",
@@ -56,7 +46,7 @@ constexpr std::string_view other_tags_str[OTHER_TAG_COUNT] = {
   "style",
 };
 
-constexpr InverseIndex<SHAPE_TAG_COUNT> inv_shape_tags {&shape_tags_str};
+constexpr InverseIndex<SHAPE_KIND_COUNT> inv_shape_tags {&shape_tags_str};
 constexpr InverseIndex<OTHER_TAG_COUNT> inv_other_tags {&other_tags_str};
 
 void parse_stylesheet(std::string_view data, StyleSheet *styles) {
@@ -71,7 +61,8 @@ void parse_stylesheet(std::string_view data, StyleSheet *styles) {
     size_t pos_end = data.find('}');
     std::string_view value = data.substr(0, pos_end - 1);
 
-    ArrayList<Attribute> attrs = process_style(value);
+    ArrayList<Attribute> attrs;
+    process_style(value, &attrs);
    
     data = data.substr(pos_end + 1);
 
@@ -93,209 +84,410 @@ GradientMap link_gradients(GradientMap gradients) {
   return gradients;
 }
 
-ParseResult parse_xml(std::string_view content) {
-  int cursor = 0;
-  int end = content.size();
-  int mark = 0;
 
-  std::unique_ptr<BaseShape> stack;
+// Builds the shape tree out of the tags and text of a document. Without
+// callbacks it collects everything for a `ParseResult`, the views pointing
+// into the document. With callbacks the document only exists in chunks, so
+// anything that outlives a tag is copied: the tags of the open elements
+// (their children inherit views from them), gradient ids and stylesheets.
+// Shapes are allocated from `arena`, which callbacks use as a stack: an
+// element and everything after it are released once it is reported
+class TreeBuilder {
+public:
+  TreeBuilder(const PushCallbacks *callbacks);
+
+  // Returns whether the text up to the next tag is used
+  bool wants_text() const;
 
-  std::unique_ptr<BaseShape> head;
-  std::unique_ptr<BaseShape> *tail = &head;
+  // Handles the content between two tags
+  void handle_text(std::string_view text);
 
+  // Handles a tag without its `<` and `>`, returns true once the root closes
+  bool handle_tag(std::string_view tag_content);
+
+  std::unique_ptr<Arena> arena;
+  BaseShape *head;
   GradientMap gradient_map;
   StyleSheet stylesheet;
+  StylePool styles;
+  SVGShapes::SVG *root;
+private:
+  std::string_view retain(std::string_view value);
+  bool close_shape();
+  void close_gradient();
 
-  std::string_view current_gradient = "";
-
-  bool reading_style = false;
+  const PushCallbacks *callbacks;
+  ParseContext context;
 
-  // TODO: Add states
-  // - Parsing element
-  // - Parsing defs
-  // - Parsing gradient
+  BaseShape *stack;
+  BaseShape **tail;
 
-  bool is_parsing_tag = false;
-  while (cursor < end) {
-    if (!is_parsing_tag && content[cursor] == '<') {
-      if (SVGShapes::Text* text = dynamic_cast<SVGShapes::Text*>(stack.get())) {
-        text->set_text(content.substr(mark, cursor - mark));
-      }
+  std::string_view current_gradient;
+  bool reading_style;
 
-      if (reading_style) {
-        reading_style = false;
-        parse_stylesheet(content.substr(mark, cursor - mark), &stylesheet);
-      }
-      ++cursor;
-      mark = cursor;
-      is_parsing_tag = true;
-    } else if (is_parsing_tag && content[cursor] == '>') {
-      std::string_view tag_content = content.substr(mark, cursor - mark);
-      ++cursor;
-      mark = cursor;
-      is_parsing_tag = false;
+  ArrayList<Attribute> attrs;
+  AttributeSet attr_set;
+  ArrayList<Attribute> style_scratch;
 
-      while (tag_content.size() && isspace(tag_content[0])) tag_content = tag_content.substr(1);
-      if (tag_content[0] == '!' || tag_content[0] == '?') continue;
+  std::vector<ArenaMark> open_marks;
+  Arena retained;
+};
 
-      while (tag_content.size() && isspace(tag_content[0])) tag_content = tag_content.substr(1);
-      size_t name_end = 0;
+TreeBuilder::TreeBuilder(const PushCallbacks *callbacks) :
+  arena{std::make_unique<Arena>()},
+  head{nullptr},
+  root{nullptr},
+  callbacks{callbacks},
+  context{&this->stylesheet, &this->styles, this->arena.get(), &this->style_scratch},
+  stack{nullptr},
+  tail{&head},
+  current_gradient{""},
+  reading_style{false} {}
+
+std::string_view TreeBuilder::retain(std::string_view value) {
+  if (value.empty()) return std::string_view {};
+  char *copy = this->retained.alloc_array<char>(value.size());
+  memcpy(copy, value.data(), value.size());
+  return std::string_view {copy, value.size()};
+}
 
-      while (name_end < tag_content.size() && !isspace(tag_content[name_end])) ++name_end;
+bool TreeBuilder::wants_text() const {
+  return this->reading_style || dynamic_cast<SVGShapes::Text*>(this->stack);
+}
 
-      std::string_view tag_name = tag_content.substr(0, name_end);
-      if (tag_name[0] == '/') {
-        tag_name = tag_name.substr(1);
-        if (inv_shape_tags[tag_name] == -1) {
-          if (tag_name == other_tags_str[OTHER_TAG_LINEAR_GRADIENT] ||
-              tag_name == other_tags_str[OTHER_TAG_RADIAL_GRADIENT]) {
-            current_gradient = "";
-          }
-          continue;
-        }
-        if (stack) {
-          std::unique_ptr<BaseShape> node = std::move(stack);
-          stack = std::move(node->next);
-
-          *tail = std::move(node);
-          if (stack.get() == nullptr) {
-            if (SVGShapes::SVG *svg = dynamic_cast<SVGShapes::SVG*>(tail->get())) {
-              return ParseResult {
-                std::move(head),
-                link_gradients(std::move(gradient_map)),
-                std::move(stylesheet),
-                svg
-              };
-            }
-          }
+void TreeBuilder::handle_text(std::string_view text) {
+  if (SVGShapes::Text* text_shape = dynamic_cast<SVGShapes::Text*>(this->stack)) {
+    text_shape->set_text(text, this->arena.get());
+  }
 
-          tail = &(*tail)->next;
-        }
-        continue;
+  if (this->reading_style) {
+    this->reading_style = false;
+    if (this->callbacks) {
+      StyleSheet rules;
+      parse_stylesheet(this->retain(text), &rules);
+      for (StyleSheet::iterator it = rules.begin(); it != rules.end(); ++it) {
+        if (this->callbacks->on_style) this->callbacks->on_style(it->first, &it->second);
+        this->stylesheet.emplace(it->first, std::move(it->second));
       }
+    } else {
+      parse_stylesheet(text, &this->stylesheet);
+    }
+  }
+}
 
-      tag_content = tag_content.substr(name_end);
+bool TreeBuilder::close_shape() {
+  BaseShape *node = this->stack;
+  this->stack = node->next;
+  node->next = nullptr;
+
+  if (this->callbacks) {
+    if (this->callbacks->on_shape) this->callbacks->on_shape(node);
+    bool is_root = this->stack == nullptr && dynamic_cast<SVGShapes::SVG*>(node);
+    this->arena->rewind(this->open_marks.back());
+    this->open_marks.pop_back();
+    return is_root;
+  }
+
+  *this->tail = node;
+  this->tail = &node->next;
+  if (this->stack == nullptr) {
+    if (SVGShapes::SVG *svg = dynamic_cast<SVGShapes::SVG*>(node)) {
+      this->root = svg;
+      return true;
+    }
+  }
 
-      ArrayList<Attribute> attrs;
+  return false;
+}
 
-      while (tag_content.size() && tag_content[0] != '/') {
-        while (tag_content.size() && isspace(tag_content[0])) tag_content = tag_content.substr(1);
-        size_t eq = tag_content.find('=');
-        if (eq == tag_content.npos) break;
-        std::string_view attr_key = tag_content.substr(0, eq);
-        tag_content = tag_content.substr(eq + 1);
-        while (tag_content.size() && tag_content[0] != '\'' && tag_content[0] != '"') {
-          tag_content = tag_content.substr(1);
-        }
-        if (tag_content.size() == 0) break;
-        char quote = tag_content[0];
-        tag_content = tag_content.substr(1);
-        size_t quote_end = tag_content.find(quote);
-        if (quote_end == tag_content.npos) break;
-        std::string_view attr_value = tag_content.substr(0, quote_end);
-        tag_content = tag_content.substr(quote_end + 1);
-        attr_key = trim_start(attr_key);
-        attr_key = trim_end(attr_key);
-        attrs.push(Attribute {attr_key, attr_value});
+void TreeBuilder::close_gradient() {
+  if (this->callbacks && this->current_gradient != "") {
+    GradientMap::iterator it = this->gradient_map.find(this->current_gradient);
+    std::string_view href = it->second.href;
+    if (href.size() && href[0] == '#') {
+      GradientMap::iterator found = this->gradient_map.find(href.substr(1));
+      if (found != this->gradient_map.end() && found != it) {
+        it->second.stops.append(found->second.stops);
       }
+    }
+    if (this->callbacks->on_gradient) this->callbacks->on_gradient(it->first, &it->second);
+  }
+  this->current_gradient = "";
+}
 
-      std::unique_ptr<BaseShape> new_shape;
- 
-
-      switch ((ShapeTags)inv_shape_tags[tag_name]) {
-        case SHAPE_TAG_G: {
-          new_shape = std::make_unique<SVGShapes::Group>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_PATH: {
-          new_shape = std::make_unique<SVGShapes::Path>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_RECT: {
-          new_shape = std::make_unique<SVGShapes::Rect>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_CIRCLE: {
-          new_shape = std::make_unique<SVGShapes::Circle>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_ELLIPSE: {
-          new_shape = std::make_unique<SVGShapes::Ellipse>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_LINE: {
-          new_shape = std::make_unique<SVGShapes::Line>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_POLYLINE: {
-          new_shape = std::make_unique<SVGShapes::Polyline>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_POLYGON: {
-          new_shape = std::make_unique<SVGShapes::Polygon>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_TEXT: {
-          new_shape = std::make_unique<SVGShapes::Text>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_SVG: {
-          new_shape = std::make_unique<SVGShapes::SVG>(attrs.begin(), attrs.len(), stack.get(), &stylesheet);
-        } break;
-        case SHAPE_TAG_COUNT: {
-          __builtin_unreachable();
-        }
+bool TreeBuilder::handle_tag(std::string_view tag_content) {
+  while (tag_content.size() && isspace(tag_content[0])) tag_content = tag_content.substr(1);
+  if (tag_content[0] == '!' || tag_content[0] == '?') return false;
+
+  while (tag_content.size() && isspace(tag_content[0])) tag_content = tag_content.substr(1);
+  size_t name_end = 0;
+
+  while (name_end < tag_content.size() && !isspace(tag_content[name_end])) ++name_end;
+
+  std::string_view tag_name = tag_content.substr(0, name_end);
+  if (tag_name[0] == '/') {
+    tag_name = tag_name.substr(1);
+    if (inv_shape_tags[tag_name] == -1) {
+      if (tag_name == other_tags_str[OTHER_TAG_LINEAR_GRADIENT] ||
+          tag_name == other_tags_str[OTHER_TAG_RADIAL_GRADIENT]) {
+        this->close_gradient();
       }
+      return false;
+    }
+    if (this->stack) {
+      return this->close_shape();
+    }
+    return false;
+  }
 
-      switch ((OtherTags)inv_other_tags[tag_name]) {
-        case OTHER_TAG_LINEAR_GRADIENT: {
-          if (current_gradient == "") {
-            Gradient gradient = read_gradient(GRADIENT_TYPE_LINEAR, attrs.begin(), attrs.len());
-            if (gradient.id != "") {
-              gradient_map.emplace(gradient.id, std::move(gradient));
-              current_gradient = gradient.id;
-            }
-          }
-        } break;
-        case OTHER_TAG_RADIAL_GRADIENT: {
-          if (current_gradient == "") {
-            Gradient gradient = read_gradient(GRADIENT_TYPE_RADIAL, attrs.begin(), attrs.len());
-            if (gradient.id != "") {
-              gradient_map.emplace(gradient.id, std::move(gradient));
-              current_gradient = gradient.id;
-            }
+  tag_content = tag_content.substr(name_end);
+
+  // The callbacks of children may read the geometry of their parent, which
+  // is cached in the arena on first use. All of it is computed before the
+  // mark, a cache built later would be released with the child
+  if (this->callbacks && this->stack) this->stack->prepare_geometry();
+
+  // The children of an open element inherit views into its attributes, so
+  // they must survive the chunk the tag arrived in. The copy is released
+  // together with the element
+  ArenaMark mark = this->arena->mark();
+  if (this->callbacks && inv_shape_tags[tag_name] != -1) {
+    char *tag_copy = this->arena->alloc_array<char>(tag_content.size());
+    memcpy(tag_copy, tag_content.data(), tag_content.size());
+    tag_content = std::string_view {tag_copy, tag_content.size()};
+  }
+
+  this->attrs.resize(0);
+  this->attr_set.clear();
+
+  while (tag_content.size() && tag_content[0] != '/') {
+    while (tag_content.size() && isspace(tag_content[0])) tag_content = tag_content.substr(1);
+    size_t eq = scan_byte(tag_content, 0, '=');
+    if (eq == tag_content.size()) break;
+    std::string_view attr_key = tag_content.substr(0, eq);
+    tag_content = tag_content.substr(eq + 1);
+    tag_content = tag_content.substr(scan_either(tag_content, 0, '\'', '"'));
+    if (tag_content.size() == 0) break;
+    char quote = tag_content[0];
+    tag_content = tag_content.substr(1);
+    size_t quote_end = scan_byte(tag_content, 0, quote);
+    if (quote_end == tag_content.size()) break;
+    std::string_view attr_value = tag_content.substr(0, quote_end);
+    tag_content = tag_content.substr(quote_end + 1);
+    attr_key = trim_start(attr_key);
+    attr_key = trim_end(attr_key);
+    this->attrs.push(Attribute {attr_key, attr_value});
+    this->attr_set.add(attr_key, attr_value);
+  }
+
+  Attribute *attrs = this->attrs.begin();
+  int attrs_count = this->attrs.len();
+  const AttributeSet *attr_set = &this->attr_set;
+  BaseShape *parent = this->stack;
+  ParseContext *context = &this->context;
+  Arena *arena = this->arena.get();
+
+  BaseShape *new_shape = nullptr;
+
+  switch ((ShapeKind)inv_shape_tags[tag_name]) {
+    case SHAPE_KIND_GROUP: {
+      new_shape = arena->make<SVGShapes::Group>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_PATH: {
+      new_shape = arena->make<SVGShapes::Path>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_RECT: {
+      new_shape = arena->make<SVGShapes::Rect>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_CIRCLE: {
+      new_shape = arena->make<SVGShapes::Circle>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_ELLIPSE: {
+      new_shape = arena->make<SVGShapes::Ellipse>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_LINE: {
+      new_shape = arena->make<SVGShapes::Line>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_POLYLINE: {
+      new_shape = arena->make<SVGShapes::Polyline>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_POLYGON: {
+      new_shape = arena->make<SVGShapes::Polygon>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_TEXT: {
+      new_shape = arena->make<SVGShapes::Text>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_SVG: {
+      new_shape = arena->make<SVGShapes::SVG>(attr_set, parent, context);
+    } break;
+    case SHAPE_KIND_COUNT: {
+      __builtin_unreachable();
+    }
+  }
+
+  switch ((OtherTags)inv_other_tags[tag_name]) {
+    case OTHER_TAG_LINEAR_GRADIENT: {
+      if (this->current_gradient == "") {
+        Gradient gradient = read_gradient(GRADIENT_TYPE_LINEAR, attrs, attrs_count);
+        if (gradient.id != "") {
+          if (this->callbacks) {
+            gradient.id = this->retain(gradient.id);
+            gradient.href = this->retain(gradient.href);
           }
-        } break;
-        case OTHER_TAG_STOP: {
-          if (current_gradient != "") {
-            gradient_map[current_gradient].stops.push(read_stop(attrs.begin(), attrs.len()));
+          this->current_gradient = gradient.id;
+          this->gradient_map.emplace(gradient.id, std::move(gradient));
+        }
+      }
+    } break;
+    case OTHER_TAG_RADIAL_GRADIENT: {
+      if (this->current_gradient == "") {
+        Gradient gradient = read_gradient(GRADIENT_TYPE_RADIAL, attrs, attrs_count);
+        if (gradient.id != "") {
+          if (this->callbacks) {
+            gradient.id = this->retain(gradient.id);
+            gradient.href = this->retain(gradient.href);
           }
-        } break;
-        case OTHER_TAG_DEFS: {
-        } break;
-        case OTHER_TAG_STYLE: {
-          reading_style = true;
-        } break;
-        case OTHER_TAG_COUNT: {
-          __builtin_unreachable();
-        } break;
+          this->current_gradient = gradient.id;
+          this->gradient_map.emplace(gradient.id, std::move(gradient));
+        }
       }
+    } break;
+    case OTHER_TAG_STOP: {
+      if (this->current_gradient != "") {
+        this->gradient_map[this->current_gradient].stops.push(read_stop(attrs, attrs_count));
+      }
+    } break;
+    case OTHER_TAG_DEFS: {
+    } break;
+    case OTHER_TAG_STYLE: {
+      this->reading_style = true;
+    } break;
+    case OTHER_TAG_COUNT: {
+      __builtin_unreachable();
+    } break;
+  }
 
-      bool inline_end = tag_content.size() && tag_content[0] == '/';
-      if (new_shape) {
-        if (inline_end) {
-          *tail = std::move(new_shape);
-          tail = &(*tail)->next;
-        } else {
-          new_shape->next = std::move(stack);
-          stack = std::move(new_shape);
-        }
-      } else if (inline_end) {
-        if (tag_name == other_tags_str[OTHER_TAG_LINEAR_GRADIENT] ||
-            tag_name == other_tags_str[OTHER_TAG_RADIAL_GRADIENT]) {
-          current_gradient = "";
-        }
+  bool inline_end = tag_content.size() && tag_content[0] == '/';
+  if (new_shape) {
+    if (inline_end) {
+      if (this->callbacks) {
+        if (this->callbacks->on_shape) this->callbacks->on_shape(new_shape);
+        this->arena->rewind(mark);
+      } else {
+        *this->tail = new_shape;
+        this->tail = &new_shape->next;
       }
     } else {
-      ++cursor;
+      if (this->callbacks) this->open_marks.push_back(mark);
+      new_shape->next = this->stack;
+      this->stack = new_shape;
+    }
+  } else if (inline_end) {
+    if (tag_name == other_tags_str[OTHER_TAG_LINEAR_GRADIENT] ||
+        tag_name == other_tags_str[OTHER_TAG_RADIAL_GRADIENT]) {
+      this->close_gradient();
+    }
+  }
+
+  return false;
+}
+
+ParseResult parse_xml(DocumentSource source) {
+  std::string_view content = source.view();
+  size_t cursor = 0;
+  size_t end = content.size();
+  size_t mark = 0;
+
+  TreeBuilder builder {nullptr};
+
+  bool is_parsing_tag = false;
+  while (cursor < end) {
+    cursor = scan_byte(content, cursor, is_parsing_tag ? '>' : '<');
+    if (cursor == end) break;
+
+    std::string_view piece = content.substr(mark, cursor - mark);
+    ++cursor;
+    mark = cursor;
+
+    if (!is_parsing_tag) {
+      builder.handle_text(piece);
+      is_parsing_tag = true;
+    } else {
+      is_parsing_tag = false;
+      if (builder.handle_tag(piece)) break;
     }
   }
 
   return ParseResult {
-    std::move(head),
-    link_gradients(std::move(gradient_map)),
-    std::move(stylesheet),
-    nullptr
+    std::move(source),
+    std::move(builder.arena),
+    builder.head,
+    link_gradients(std::move(builder.gradient_map)),
+    std::move(builder.stylesheet),
+    std::move(builder.styles),
+    builder.root
   };
 }
+
+ParseResult parse_xml(std::string_view content) {
+  return parse_xml(DocumentSource::borrow(content));
+}
+
+PushParser::PushParser(PushCallbacks callbacks) :
+  callbacks{std::move(callbacks)},
+  builder{std::make_unique<TreeBuilder>(&this->callbacks)},
+  pending{},
+  is_parsing_tag{false},
+  finished{false} {}
+
+PushParser::~PushParser() = default;
+
+void PushParser::feed(std::string_view bytes) {
+  if (this->finished) return;
+
+  size_t cursor = 0;
+  while (cursor < bytes.size()) {
+    size_t found = scan_byte(bytes, cursor, this->is_parsing_tag ? '>' : '<');
+    if (found == bytes.size()) {
+      // The rest of the tag or text arrives with the next chunk
+      if (this->is_parsing_tag || this->builder->wants_text()) {
+        this->pending.append(bytes.substr(cursor));
+      }
+      return;
+    }
+
+    std::string_view piece = bytes.substr(cursor, found - cursor);
+    if (this->pending.size()) {
+      this->pending.append(piece);
+      piece = this->pending;
+    }
+    cursor = found + 1;
+
+    if (!this->is_parsing_tag) {
+      this->builder->handle_text(piece);
+      this->is_parsing_tag = true;
+    } else {
+      this->is_parsing_tag = false;
+      if (this->builder->handle_tag(piece)) {
+        this->finished = true;
+        this->pending.clear();
+        return;
+      }
+    }
+    this->pending.clear();
+  }
+}
+
+void PushParser::finish() {
+  this->finished = true;
+  this->pending.clear();
+  this->pending.shrink_to_fit();
+}
+
+bool PushParser::done() const {
+  return this->finished;
+}
+
+const StylePool *PushParser::styles() const {
+  return &this->builder->styles;
+}
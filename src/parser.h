@@ -1,19 +1,76 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <functional>
+#include <string>
+
 #include "SVG.h"
 #include "Gradient.h"
 #include "BaseShape.h"
+#include "DocumentSource.h"
 
 using GradientMap = std::unordered_map<std::string_view, Gradient>;
 
+// The views stored in the shapes, gradients and stylesheet point into
+// `source` and the shapes are allocated from `arena`, they stay valid for as
+// long as the `ParseResult` is alive. Destroying it releases every shape at
+// once, without visiting them
 struct ParseResult {
-  std::unique_ptr<BaseShape> shapes;
+  DocumentSource source;
+  std::unique_ptr<Arena> arena;
+  BaseShape *shapes;
   GradientMap gradient_map;
   StyleSheet stylesheet;
+  StylePool styles;
   SVGShapes::SVG *root;
 };
 
+ParseResult parse_xml(DocumentSource source);
+
+// Parses a buffer owned by the caller, which must outlive the result
 ParseResult parse_xml(std::string_view content);
 
+// Receives the elements of a document as a `PushParser` completes them. The
+// views inside a reported shape, gradient or rule are only guaranteed to be
+// valid until the callback returns, and so is the shape itself
+struct PushCallbacks {
+  std::function<void(const BaseShape *shape)> on_shape;
+  std::function<void(std::string_view id, const Gradient *gradient)> on_gradient;
+  std::function<void(std::string_view selector, const ArrayList<Attribute> *rule)> on_style;
+};
+
+class TreeBuilder;
+
+// A resumable parser that accepts a document in chunks of any size. Shapes
+// are reported when their closing tag arrives and released afterwards, so
+// memory stays proportional to the nesting depth rather than the file size.
+// Gradients may only reference gradients that appear before them
+class PushParser {
+public:
+  PushParser(PushCallbacks callbacks);
+  ~PushParser();
+
+  PushParser(const PushParser&) = delete;
+  PushParser &operator=(const PushParser&) = delete;
+
+  // Consumes the next chunk, tags and text may be split across chunks
+  void feed(std::string_view bytes);
+
+  // Ends the document, an unterminated tag and unclosed elements are dropped
+  void finish();
+
+  // Returns whether the root element has been closed
+  bool done() const;
+
+  // Returns the computed styles the reported shapes refer to, which stay
+  // valid for as long as the parser
+  const StylePool *styles() const;
+private:
+  PushCallbacks callbacks;
+  std::unique_ptr<TreeBuilder> builder;
+  std::string pending;
+  bool is_parsing_tag;
+  bool finished;
+};
+
 #endif